@@ -0,0 +1,1267 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_bench.c
+ *
+ * FILE DESCRIPTION:
+ * Benchmark suite of the EWFS runtime: mount time against the number of
+ * files, lookup of existing and missing files, sequential read throughput
+ * against the read buffer size and the cost of generated files.
+ *
+ * FILE NOTES:
+ * Usage: ewfs_bench [-t MS] [-f FLASH] [-g GENERATOR] [-o JSON FILE] [IMAGE FILE [FILE ...]]
+ *
+ * Without an image the benchmarks run on synthetic images: a tree of
+ * numbered files in sub-directories is written to the temporary directory
+ * and built with the image generator (ewfs_generator of the build, or -g),
+ * so the images are the ones a device gets.  With an image, mount is
+ * measured on it, lookups and reads are done on the given files.
+ *
+ * Every benchmark repeats its operation until -t milliseconds have passed so
+ * results have the same resolution on fast and slow hosts.  Results are
+ * written as JSON with the host time per operation and, with -f, the time
+ * the simulated flash device would spend in the reads.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "ewfs.h"
+#include "ewfs_crc.h"
+#include "host_media.h"
+#include "host_port.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define BENCH_DISK              0
+#define BENCH_TIME_MS           200
+#define BENCH_FILE_SIZE         1024        //size of the small synthetic files
+#define BENCH_LARGE_FILE_SIZE   (1024u * 1024u)
+#define BENCH_LOOKUP_FILES      4096        //files in the lookup and read image
+#define BENCH_LOOKUP_NAMES      256         //different names looked up
+#define BENCH_BUFFER_MIN        64
+#define BENCH_BUFFER_MAX        16384
+#define BENCH_GENERATED_FILE    "largefile.json"
+#define BENCH_GENERATED_LIST    "ewfslist.txt"  //list of the generated files of a tree
+#define BENCH_LARGE_FILE        "large.bin"     //name of the large stored file
+#define BENCH_NAME_MAX          64
+#define BENCH_PATH_MAX          (BENCH_NAME_MAX + 8)
+#define BENCH_TREE_PATH_MAX     (BENCH_NAME_MAX + 64)
+#define BENCH_FILES_PER_DIR     64
+#define BENCH_ALIGN_FILES       1024        //small files of the alignment images
+#define BENCH_ALIGN_BUFFER      4096        //read size of the alignment benchmark
+#define BENCH_OPTIONS_MAX       4           //generator options of an image
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//measurement of one benchmark
+typedef struct{
+    const char *name;
+    const char *backend;
+    const char *file;       //file read, NULL if the benchmark is not about one file
+    uint32_t files;         //files in the image
+    uint32_t buffer_size;   //read buffer size, 0 if there are no reads
+    uint64_t operations;
+    uint64_t bytes;
+    uint64_t nanoseconds;
+    uint64_t device_ns;
+    uint32_t collisions;    //missing names whose hash is in the image
+    uint32_t align;         //page the stored files start on, 0 if packed
+    uint32_t align_min;     //only files of at least this size are aligned
+    uint64_t image_bytes;   //size of the image, 0 if not reported
+}bench_result_t;
+
+//state shared by the benchmarks
+typedef struct{
+    FILE *json;
+    uint64_t time_ns;       //minimum run time of each benchmark
+    const host_flash_t *flash;
+    const char *generator;  //image generator, NULL if there is none
+    uint32_t results;       //results written
+    uint8_t *buffer;
+}bench_context_t;
+
+//input tree of the synthetic images, in a temporary directory
+typedef struct{
+    char dir[32];           //the tree is in dir/tree, the image is dir/image.bin
+    char image[48];
+    uint32_t file_count;    //small files in the tree
+    bool large;             //BENCH_LARGE_FILE is in the tree
+    bool generated;         //BENCH_GENERATED_FILE is in the tree
+}bench_tree_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static void CmdLineUsage(void);
+static bool BenchAttach(bench_context_t *context, const char *image_path,
+        host_media_backend_e backend);
+static void BenchDetach(void);
+static void BenchMount(bench_context_t *context, const char *image_path, uint32_t files);
+static void BenchLookup(bench_context_t *context, const char *name, const char **names,
+        uint32_t count, uint32_t files);
+static int BenchReadFile(bench_context_t *context, const char *name, uint32_t buffer_size,
+        uint64_t *bytes);
+static void BenchRead(bench_context_t *context, const char *backend, const char *name,
+        uint32_t buffer_size, uint32_t files);
+static void BenchOpen(bench_context_t *context, const char *name, uint32_t files);
+static void BenchSynthetic(bench_context_t *context);
+static void BenchAlign(bench_context_t *context, bench_tree_t *tree);
+static void BenchAlignRead(bench_context_t *context, const char *name, const uint32_t *setting,
+        uint32_t files, uint64_t image_bytes);
+#if defined(EWFS_CHECKSUM_ENABLE)
+static void BenchChecksum(bench_context_t *context, bench_tree_t *tree);
+static void BenchCrc(bench_context_t *context, const char *backend, uint32_t buffer_size);
+static void BenchScrub(bench_context_t *context, const char *backend, uint32_t files);
+#endif
+static void BenchImage(bench_context_t *context, const char *image_path, char **names,
+        uint32_t count);
+static void BenchReport(bench_context_t *context, const bench_result_t *result);
+static void BenchPath(const char *name, char *path, size_t path_size);
+static void BenchFileName(uint32_t file, char *name, size_t name_size);
+static bool BenchTreeCreate(bench_tree_t *tree);
+static bool BenchTreeSet(bench_tree_t *tree, uint32_t file_count, bool large, bool generated);
+static bool BenchTreeWrite(const bench_tree_t *tree, const char *name, uint32_t seed, uint32_t size);
+static void BenchTreePath(const bench_tree_t *tree, const char *name, char *path, size_t path_size);
+static void BenchTreeRemove(bench_tree_t *tree);
+static bool BenchGenerate(bench_context_t *context, bench_tree_t *tree, const char *options[],
+        uint32_t *files);
+
+/******************************************************************************
+ * FUNCTION:  main
+ *
+ * DESCRIPTION:
+ * Run the benchmark suite and write the results as JSON.
+ *
+ * PARAMETERS:
+ * argc         int         number of command line arguments
+ * argv[]       char *      array of command line arguments
+ *
+ * RETURN VALUE:
+ * int      0 if successful, otherwise 1
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[]){
+    bench_context_t context = {stdout, (uint64_t) BENCH_TIME_MS * 1000000u, NULL, NULL, 0, NULL};
+    const char *json_path = NULL;
+    uint32_t index;
+    int arg = 1;
+
+#if defined(BENCH_GENERATOR)
+    context.generator = BENCH_GENERATOR;
+#endif
+    while ((arg < argc) && (argv[arg][0] == '-')){
+        if ((strcmp(argv[arg], "-t") == 0) && (arg + 1 < argc)){
+            context.time_ns = strtoull(argv[++arg], NULL, 0) * 1000000u;
+        }else if ((strcmp(argv[arg], "-o") == 0) && (arg + 1 < argc)){
+            json_path = argv[++arg];
+        }else if ((strcmp(argv[arg], "-g") == 0) && (arg + 1 < argc)){
+            context.generator = argv[++arg];
+        }else if ((strcmp(argv[arg], "-f") == 0) && (arg + 1 < argc)){
+            context.flash = HOST_FLASH_PresetFind(argv[++arg]);
+            if (context.flash == NULL){
+                fprintf(stderr, "Unknown flash '%s', use one of:", argv[arg]);
+                for (index = 0; HOST_FLASH_PresetGet(index) != NULL; index ++){
+                    fprintf(stderr, " %s", HOST_FLASH_PresetGet(index)->name);
+                }
+                fprintf(stderr, "\n");
+                return 1;
+            }
+        }else{
+            CmdLineUsage();
+            return 1;
+        }
+        arg ++;
+    }
+    if ((argc - arg == 1) || (context.time_ns == 0)){
+        CmdLineUsage();
+        return 1;
+    }
+    if (json_path != NULL){
+        context.json = fopen(json_path, "w");
+        if (context.json == NULL){
+            fprintf(stderr, "Can't create '%s'.\n", json_path);
+            return 1;
+        }
+    }
+    context.buffer = malloc(BENCH_BUFFER_MAX);
+
+    fprintf(context.json, "{\n  \"benchmark\": \"ewfs\",\n  \"time_ms\": %llu,\n  \"flash\": ",
+            (unsigned long long) (context.time_ns / 1000000u));
+    if (context.flash != NULL){
+        fprintf(context.json, "\"%s\",\n", context.flash->name);
+    }else{
+        fprintf(context.json, "null,\n");
+    }
+    fprintf(context.json, "  \"results\": [");
+    if (arg < argc){
+        BenchImage(&context, argv[arg], &argv[arg + 1], (uint32_t) (argc - arg - 1));
+    }else{
+        BenchSynthetic(&context);
+    }
+    fprintf(context.json, "\n  ]\n}\n");
+
+    free(context.buffer);
+    if (context.json != stdout){
+        fclose(context.json);
+    }
+    return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:  CmdLineUsage
+ *
+ * DESCRIPTION:
+ * Display the command line usage for this application.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void CmdLineUsage(void){
+    fprintf(stderr, "Usage: ewfs_bench [-t MS] [-f FLASH] [-g GENERATOR] [-o JSON FILE] [IMAGE FILE [FILE ...]]\n");
+    fprintf(stderr, "    -t    Minimum run time of each benchmark in ms (default %u).\n", BENCH_TIME_MS);
+    fprintf(stderr, "    -f    Report the time of a simulated flash device.\n");
+    fprintf(stderr, "    -g    Image generator that builds the synthetic images.\n");
+    fprintf(stderr, "    -o    Write the results to a file instead of stdout.\n");
+    fprintf(stderr, "Without an image the benchmarks run on synthetic images built by the generator.\n");
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchSynthetic
+ *
+ * DESCRIPTION:
+ * Run the benchmarks on synthetic images.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Misses are looked up with names of the same shape as the files in the
+ * image so the hash of some of them is in the index.  The tree grows for
+ * the mount images and then shrinks, so each file is written once.
+ *
+ *****************************************************************************/
+static void BenchSynthetic(bench_context_t *context){
+    static const uint32_t mount_files[] = {16, 256, 4096, 16384};
+    static char hit_names[BENCH_LOOKUP_NAMES][BENCH_NAME_MAX];
+    static char miss_names[BENCH_LOOKUP_NAMES][BENCH_NAME_MAX];
+    const char *hits[BENCH_LOOKUP_NAMES];
+    const char *misses[BENCH_LOOKUP_NAMES];
+    const char *options[] = {NULL};
+    bench_tree_t tree;
+    uint32_t buffer_size;
+    uint32_t files;
+    uint32_t index;
+
+    if (context->generator == NULL){
+        fprintf(stderr, "The synthetic images need the image generator, give it with -g.\n");
+        return;
+    }
+    if (BenchTreeCreate(&tree) == false){
+        fprintf(stderr, "Can't create a temporary directory.\n");
+        return;
+    }
+
+    for (index = 0; index < sizeof(mount_files) / sizeof(mount_files[0]); index ++){
+        if (BenchTreeSet(&tree, mount_files[index], false, false) &&
+                BenchGenerate(context, &tree, options, &files)){
+            BenchMount(context, tree.image, files);
+        }
+    }
+
+    if ((BenchTreeSet(&tree, BENCH_LOOKUP_FILES, true, true) == false) ||
+            (BenchGenerate(context, &tree, options, &files) == false)){
+        BenchTreeRemove(&tree);
+        return;
+    }
+    for (index = 0; index < BENCH_LOOKUP_NAMES; index ++){
+        //spread the names over the image
+        BenchFileName(index * (BENCH_LOOKUP_FILES / BENCH_LOOKUP_NAMES), hit_names[index],
+                BENCH_NAME_MAX);
+        BenchFileName(BENCH_LOOKUP_FILES + index, miss_names[index], BENCH_NAME_MAX);
+        hits[index] = hit_names[index];
+        misses[index] = miss_names[index];
+    }
+    if (BenchAttach(context, tree.image, HOST_MEDIA_PREAD)){
+        BenchLookup(context, "lookup_hit", hits, BENCH_LOOKUP_NAMES, files);
+        BenchLookup(context, "lookup_miss", misses, BENCH_LOOKUP_NAMES, files);
+        for (buffer_size = BENCH_BUFFER_MIN; buffer_size <= BENCH_BUFFER_MAX; buffer_size *= 4){
+            BenchRead(context, "pread", BENCH_LARGE_FILE, buffer_size, files);
+        }
+        BenchOpen(context, BENCH_GENERATED_FILE, files);
+        for (buffer_size = BENCH_BUFFER_MIN; buffer_size <= BENCH_BUFFER_MAX; buffer_size *= 4){
+            BenchRead(context, "generated", BENCH_GENERATED_FILE, buffer_size, files);
+        }
+#if defined(EWFS_GEN_CACHE_ENABLE)
+        //the output is generated by the first read of each buffer size, then copied
+        EWFS_SetGeneratedFileCache(BENCH_GENERATED_FILE, EWFS_INVALID);
+        for (buffer_size = BENCH_BUFFER_MIN; buffer_size <= BENCH_BUFFER_MAX; buffer_size *= 4){
+            EWFS_InvalidateGeneratedFile(BENCH_GENERATED_FILE);
+            BenchRead(context, "generated_cached", BENCH_GENERATED_FILE, buffer_size, files);
+        }
+        EWFS_SetGeneratedFileCache(BENCH_GENERATED_FILE, 0);
+#endif
+        BenchDetach();
+    }
+    if (BenchAttach(context, tree.image, HOST_MEDIA_MMAP)){
+        for (buffer_size = BENCH_BUFFER_MIN; buffer_size <= BENCH_BUFFER_MAX; buffer_size *= 4){
+            BenchRead(context, "mmap", BENCH_LARGE_FILE, buffer_size, files);
+        }
+        BenchDetach();
+    }
+    if (BenchTreeSet(&tree, BENCH_ALIGN_FILES, true, false)){
+        BenchAlign(context, &tree);
+#if defined(EWFS_CHECKSUM_ENABLE)
+        BenchChecksum(context, &tree);
+#endif
+    }
+    BenchTreeRemove(&tree);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchAlign
+ *
+ * DESCRIPTION:
+ * Measure reading files of images with the stored files packed and aligned
+ * to flash pages.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * tree         bench_tree_t *      tree of BENCH_ALIGN_FILES small files and
+ *                                  the large file
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The images are built with the -a and -s options of the generator.  Each
+ * setting reports the image size (the flash cost of the padding) and, with
+ * -f, the device time of reading each small file and the large file, so the
+ * settings can be compared.  The gain shows with a flash that charges for
+ * page boundaries (sst26vf032b_paged).
+ *
+ *****************************************************************************/
+static void BenchAlign(bench_context_t *context, bench_tree_t *tree){
+    //page size and least size of the aligned files
+    static const uint32_t settings[][2] = {{0, 0}, {256, 0}, {256, 4096}, {4096, 0}};
+    char page[12];
+    char page_min[12];
+    const char *options[BENCH_OPTIONS_MAX + 1];
+    struct stat image_info;
+    uint32_t files;
+    uint32_t index;
+
+    for (index = 0; index < sizeof(settings) / sizeof(settings[0]); index ++){
+        snprintf(page, sizeof(page), "%u", settings[index][0]);
+        snprintf(page_min, sizeof(page_min), "%u", settings[index][1]);
+        options[0] = NULL;
+        if (settings[index][0] > 0){
+            options[0] = "-a";
+            options[1] = page;
+            options[2] = "-s";
+            options[3] = page_min;
+            options[4] = NULL;
+        }
+        if ((BenchGenerate(context, tree, options, &files) == false) ||
+                (stat(tree->image, &image_info) != 0)){
+            return;
+        }
+        if (BenchAttach(context, tree->image, HOST_MEDIA_PREAD)){
+            BenchAlignRead(context, "align_small", settings[index], files, (uint64_t) image_info.st_size);
+            BenchAlignRead(context, "align_large", settings[index], files, (uint64_t) image_info.st_size);
+            BenchDetach();
+        }
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchAlignRead
+ *
+ * DESCRIPTION:
+ * Measure reading the small files one after another, or the large file, of
+ * an alignment image.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * name         const char *        "align_small" or "align_large"
+ * setting      const uint32_t *    page size and least size of the aligned files
+ * files        uint32_t            number of files in the image
+ * image_bytes  uint64_t            size of the image
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchAlignRead(bench_context_t *context, const char *name, const uint32_t *setting,
+        uint32_t files, uint64_t image_bytes){
+    bench_result_t result = {name, "pread", NULL, files, BENCH_ALIGN_BUFFER,
+            0, 0, 0, 0, 0, setting[0], setting[1], image_bytes};
+    char file_name[BENCH_NAME_MAX];
+    host_media_stats_t stats;
+    uint64_t bytes;
+    uint64_t start;
+    uint32_t file = 0;
+
+    if (strcmp(name, "align_large") == 0){
+        result.file = BENCH_LARGE_FILE;
+    }
+    HOST_MEDIA_StatsClear(BENCH_DISK);
+    start = HOST_TimeNanoseconds();
+    do{
+        if (result.file == NULL){
+            BenchFileName(file, file_name, sizeof(file_name));
+            file = (file + 1) % BENCH_ALIGN_FILES;
+        }
+        if (BenchReadFile(context, (result.file != NULL) ? result.file : file_name,
+                BENCH_ALIGN_BUFFER, &bytes) != EWFS_OK){
+            fprintf(stderr, "Can't read the files of the alignment image.\n");
+            return;
+        }
+        result.bytes += bytes;
+        result.operations ++;
+        result.nanoseconds = HOST_TimeNanoseconds() - start;
+    }while (result.nanoseconds < context->time_ns);
+    HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+    result.device_ns = stats.device_ns;
+    BenchReport(context, &result);
+}
+
+#if defined(EWFS_CHECKSUM_ENABLE)
+/******************************************************************************
+ * FUNCTION:  BenchChecksum
+ *
+ * DESCRIPTION:
+ * Measure the CRC32C, reading the large file of an image with checksums and
+ * scrubbing the image.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * tree         bench_tree_t *      tree of BENCH_ALIGN_FILES small files and
+ *                                  the large file
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The image is built with the -c option of the generator.  The "hardware"
+ * results use the CRC32C instruction of the host (the CRC unit of an MCU),
+ * the "software" results the slicing-by-8 table of the runtime.  The checked
+ * reads compare with the "pread" reads of the unchecked image, the hardware
+ * results are left out if the host has no CRC32C instruction.
+ *
+ *****************************************************************************/
+static void BenchChecksum(bench_context_t *context, bench_tree_t *tree){
+    const char *options[] = {"-c", NULL};
+    uint32_t buffer_size;
+    uint32_t crc = EWFS_CRC_START;
+    uint32_t files;
+    bool hardware;
+
+    hardware = HOST_Crc32c(&crc, context->buffer, 0);
+    for (buffer_size = BENCH_BUFFER_MIN; buffer_size <= BENCH_BUFFER_MAX; buffer_size *= 4){
+        if (hardware){
+            BenchCrc(context, "hardware", buffer_size);
+        }
+        BenchCrc(context, "software", buffer_size);
+    }
+    if (BenchGenerate(context, tree, options, &files) == false){
+        return;
+    }
+    if (BenchAttach(context, tree->image, HOST_MEDIA_PREAD) == false){
+        return;
+    }
+    for (buffer_size = BENCH_BUFFER_MIN; buffer_size <= BENCH_BUFFER_MAX; buffer_size *= 4){
+        if (hardware){
+            BenchRead(context, "checked", BENCH_LARGE_FILE, buffer_size, files);
+        }
+        HOST_Crc32cEnable(false);
+        BenchRead(context, "checked_software", BENCH_LARGE_FILE, buffer_size, files);
+        HOST_Crc32cEnable(true);
+    }
+    if (hardware){
+        BenchScrub(context, "hardware", files);
+    }
+    HOST_Crc32cEnable(false);
+    BenchScrub(context, "software", files);
+    HOST_Crc32cEnable(true);
+    BenchDetach();
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchCrc
+ *
+ * DESCRIPTION:
+ * Measure the CRC32C of a buffer in memory.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * backend      const char *        "hardware" or "software"
+ * buffer_size  uint32_t            bytes added to the CRC by each call
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchCrc(bench_context_t *context, const char *backend, uint32_t buffer_size){
+    bench_result_t result = {"crc", backend, NULL, 0, buffer_size, 0, 0, 0, 0, 0, 0, 0, 0};
+    bool software = (strcmp(backend, "software") == 0);
+    volatile uint32_t crc = EWFS_CRC_START;
+    uint64_t start;
+    uint32_t count;
+
+    memset(context->buffer, 0x5A, buffer_size);
+    start = HOST_TimeNanoseconds();
+    do{
+        //enough calls between the clock reads that reading the clock doesn't count
+        for (count = 0; count < 64; count ++){
+            crc = software ? EWFS_Crc32cSoftware(crc, context->buffer, buffer_size) :
+                    EWFS_Crc32c(crc, context->buffer, buffer_size);
+        }
+        result.bytes += (uint64_t) buffer_size * count;
+        result.operations += count;
+        result.nanoseconds = HOST_TimeNanoseconds() - start;
+    }while (result.nanoseconds < context->time_ns);
+    BenchReport(context, &result);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchScrub
+ *
+ * DESCRIPTION:
+ * Measure passes of EWFS_Scrub() over the mounted image.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * backend      const char *        "hardware" or "software"
+ * files        uint32_t            number of files in the image
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * An operation is a whole pass, the buffer size is the chunk the scrub reads.
+ *
+ *****************************************************************************/
+static void BenchScrub(bench_context_t *context, const char *backend, uint32_t files){
+    bench_result_t result = {"scrub", backend, NULL, files, EWFS_SCRUB_CHUNK, 0, 0, 0, 0, 0, 0, 0, 0};
+    host_media_stats_t stats;
+    ewfs_scrub_t status;
+    uint64_t start;
+
+    EWFS_GetScrubStatus(NULL, true);
+    HOST_MEDIA_StatsClear(BENCH_DISK);
+    start = HOST_TimeNanoseconds();
+    do{
+        if (EWFS_Scrub(EWFS_INVALID) != EWFS_OK){
+            fprintf(stderr, "The scrub of the image failed.\n");
+            return;
+        }
+        result.operations ++;
+        result.nanoseconds = HOST_TimeNanoseconds() - start;
+    }while (result.nanoseconds < context->time_ns);
+    HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+    EWFS_GetScrubStatus(&status, true);
+    result.bytes = status.bytes;
+    result.device_ns = stats.device_ns;
+    BenchReport(context, &result);
+}
+#endif
+
+/******************************************************************************
+ * FUNCTION:  BenchImage
+ *
+ * DESCRIPTION:
+ * Run the benchmarks on an image built by the generator.
+ *
+ * PARAMETERS:
+ * image_path   const char *    path of the image
+ * names        char **         files to look up and read
+ * count        uint32_t        number of files
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The number of files in the image is not known here, it is reported as 0.
+ *
+ *****************************************************************************/
+static void BenchImage(bench_context_t *context, const char *image_path, char **names,
+        uint32_t count){
+    uint32_t buffer_size;
+    uint32_t index;
+
+    BenchMount(context, image_path, 0);
+    if (BenchAttach(context, image_path, HOST_MEDIA_PREAD) == false){
+        return;
+    }
+    BenchLookup(context, "lookup_hit", (const char **) names, count, 0);
+    for (index = 0; index < count; index ++){
+        BenchOpen(context, names[index], 0);
+        for (buffer_size = BENCH_BUFFER_MIN; buffer_size <= BENCH_BUFFER_MAX; buffer_size *= 4){
+            BenchRead(context, "pread", names[index], buffer_size, 0);
+        }
+    }
+    BenchDetach();
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchAttach
+ *
+ * DESCRIPTION:
+ * Attach and mount an image.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *       benchmark state
+ * image_path   const char *            path of the image
+ * backend      host_media_backend_e    media backend
+ *
+ * RETURN VALUE:
+ * bool     true if the image is mounted, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static bool BenchAttach(bench_context_t *context, const char *image_path,
+        host_media_backend_e backend){
+    if (HOST_MEDIA_Attach(BENCH_DISK, image_path, backend) == false){
+        fprintf(stderr, "Can't open image '%s'.\n", image_path);
+        return false;
+    }
+    HOST_MEDIA_FlashSet(BENCH_DISK, context->flash);
+    if (EWFS_Mount(BENCH_DISK) != EWFS_OK){
+        fprintf(stderr, "Can't mount image '%s'.\n", image_path);
+        HOST_MEDIA_Detach(BENCH_DISK);
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchDetach
+ *
+ * DESCRIPTION:
+ * Unmount and detach the image.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchDetach(void){
+    EWFS_Unmount(BENCH_DISK);
+    HOST_MEDIA_Detach(BENCH_DISK);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchMount
+ *
+ * DESCRIPTION:
+ * Measure mounting and unmounting an image.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * image_path   const char *        path of the image
+ * files        uint32_t            number of files in the image
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchMount(bench_context_t *context, const char *image_path, uint32_t files){
+    bench_result_t result = {"mount", "pread", NULL, files, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    host_media_stats_t stats;
+    uint64_t start;
+
+    if (BenchAttach(context, image_path, HOST_MEDIA_PREAD) == false){
+        return;
+    }
+    EWFS_Unmount(BENCH_DISK);
+    HOST_MEDIA_StatsClear(BENCH_DISK);
+    start = HOST_TimeNanoseconds();
+    do{
+        if (EWFS_Mount(BENCH_DISK) != EWFS_OK){
+            fprintf(stderr, "Can't mount image '%s'.\n", image_path);
+            HOST_MEDIA_Detach(BENCH_DISK);
+            return;
+        }
+        EWFS_Unmount(BENCH_DISK);
+        result.operations ++;
+        result.nanoseconds = HOST_TimeNanoseconds() - start;
+    }while (result.nanoseconds < context->time_ns);
+    HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+    result.device_ns = stats.device_ns;
+    HOST_MEDIA_Detach(BENCH_DISK);
+    BenchReport(context, &result);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchLookup
+ *
+ * DESCRIPTION:
+ * Measure opening and closing files on the mounted image.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * name         const char *        name of the benchmark
+ * names        const char **       files to open
+ * count        uint32_t            number of files
+ * files        uint32_t            number of files in the image
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The file search of the runtime is private, open and close measure it with
+ * the least extra work.  A missing name is a collision when its hash matches
+ * a file in the image, the open then also reads the name from the media.
+ *
+ *****************************************************************************/
+static void BenchLookup(bench_context_t *context, const char *name, const char **names,
+        uint32_t count, uint32_t files){
+    bench_result_t result = {name, "pread", NULL, files, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    char path[BENCH_PATH_MAX];
+    host_media_stats_t stats;
+    uintptr_t handle;
+    uint64_t start;
+    uint32_t index = 0;
+
+    if (count == 0){
+        return;
+    }
+    HOST_MEDIA_StatsClear(BENCH_DISK);
+    start = HOST_TimeNanoseconds();
+    do{
+        BenchPath(names[index], path, sizeof(path));
+        if (EWFS_Open((uintptr_t) &handle, path, 0) == EWFS_OK){
+            EWFS_Close(handle);
+        }
+        if (++ index == count){
+            index = 0;
+        }
+        result.operations ++;
+        result.nanoseconds = HOST_TimeNanoseconds() - start;
+    }while (result.nanoseconds < context->time_ns);
+    HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+    result.device_ns = stats.device_ns;
+    for (index = 0; index < count; index ++){
+        HOST_MEDIA_StatsClear(BENCH_DISK);
+        BenchPath(names[index], path, sizeof(path));
+        if (EWFS_Open((uintptr_t) &handle, path, 0) == EWFS_OK){
+            EWFS_Close(handle);
+            continue;
+        }
+        //a miss that reads the media found the hash in the index
+        HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+        if (stats.commands > 0){
+            result.collisions ++;
+        }
+    }
+    BenchReport(context, &result);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchReadFile
+ *
+ * DESCRIPTION:
+ * Open a file, read it to the end and close it.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * name         const char *        file to read
+ * buffer_size  uint32_t            size of each read
+ * bytes        uint64_t *          returns the number of bytes read
+ *
+ * RETURN VALUE:
+ * int      EWFS_OK if the file was read, otherwise the EWFS error
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static int BenchReadFile(bench_context_t *context, const char *name, uint32_t buffer_size,
+        uint64_t *bytes){
+    char path[BENCH_PATH_MAX];
+    uintptr_t handle;
+    uint32_t bytes_read;
+    int result;
+
+    *bytes = 0;
+    BenchPath(name, path, sizeof(path));
+    result = EWFS_Open((uintptr_t) &handle, path, 0);
+    if (result != EWFS_OK){
+        return result;
+    }
+    do{
+        result = EWFS_Read(handle, context->buffer, buffer_size, &bytes_read);
+        *bytes += bytes_read;
+    }while ((result == EWFS_OK) && (bytes_read > 0));
+    EWFS_Close(handle);
+    return result;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchRead
+ *
+ * DESCRIPTION:
+ * Measure reading a file sequentially.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * backend      const char *        name of the media backend
+ * name         const char *        file to read
+ * buffer_size  uint32_t            size of each read
+ * files        uint32_t            number of files in the image
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchRead(bench_context_t *context, const char *backend, const char *name,
+        uint32_t buffer_size, uint32_t files){
+    bench_result_t result = {"read", backend, name, files, buffer_size, 0, 0, 0, 0, 0, 0, 0, 0};
+    host_media_stats_t stats;
+    uint64_t bytes;
+    uint64_t start;
+
+    HOST_MEDIA_StatsClear(BENCH_DISK);
+    start = HOST_TimeNanoseconds();
+    do{
+        if (BenchReadFile(context, name, buffer_size, &bytes) != EWFS_OK){
+            fprintf(stderr, "Can't read '%s'.\n", name);
+            return;
+        }
+        result.bytes += bytes;
+        result.operations ++;
+        result.nanoseconds = HOST_TimeNanoseconds() - start;
+    }while (result.nanoseconds < context->time_ns);
+    HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+    result.device_ns = stats.device_ns;
+    BenchReport(context, &result);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchOpen
+ *
+ * DESCRIPTION:
+ * Measure opening and closing one file.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * name         const char *        file to open
+ * files        uint32_t            number of files in the image
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * For generated files this is the cost of computing the file size.
+ *
+ *****************************************************************************/
+static void BenchOpen(bench_context_t *context, const char *name, uint32_t files){
+    bench_result_t result = {"open", "pread", name, files, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    char path[BENCH_PATH_MAX];
+    host_media_stats_t stats;
+    uintptr_t handle;
+    uint64_t start;
+
+    BenchPath(name, path, sizeof(path));
+    HOST_MEDIA_StatsClear(BENCH_DISK);
+    start = HOST_TimeNanoseconds();
+    do{
+        if (EWFS_Open((uintptr_t) &handle, path, 0) != EWFS_OK){
+            fprintf(stderr, "Can't open '%s'.\n", name);
+            return;
+        }
+        EWFS_Close(handle);
+        result.operations ++;
+        result.nanoseconds = HOST_TimeNanoseconds() - start;
+    }while (result.nanoseconds < context->time_ns);
+    HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+    result.device_ns = stats.device_ns;
+    BenchReport(context, &result);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchReport
+ *
+ * DESCRIPTION:
+ * Write one result to the JSON results array.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *       benchmark state
+ * result       const bench_result_t *  measurement
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Times are per operation, MB/s is only written for reads.
+ *
+ *****************************************************************************/
+static void BenchReport(bench_context_t *context, const bench_result_t *result){
+    FILE *json = context->json;
+
+    fprintf(json, "%s\n    {\"name\": \"%s\", \"backend\": \"%s\"", (context->results > 0) ? "," : "",
+            result->name, result->backend);
+    if (result->file != NULL){
+        fprintf(json, ", \"file\": \"%s\"", result->file);
+    }
+    fprintf(json, ", \"files\": %u", result->files);
+    if (result->buffer_size > 0){
+        fprintf(json, ", \"buffer_size\": %u", result->buffer_size);
+    }
+    fprintf(json, ", \"operations\": %llu, \"ns_per_op\": %.1f",
+            (unsigned long long) result->operations,
+            (double) result->nanoseconds / (double) result->operations);
+    if (context->flash != NULL){
+        fprintf(json, ", \"device_ns_per_op\": %.1f",
+                (double) result->device_ns / (double) result->operations);
+    }
+    if (result->buffer_size > 0){
+        fprintf(json, ", \"bytes_per_op\": %llu, \"mb_per_s\": %.2f",
+                (unsigned long long) (result->bytes / result->operations),
+                ((double) result->bytes * 1000.0) / (double) result->nanoseconds);
+        if ((context->flash != NULL) && (result->device_ns > 0)){
+            fprintf(json, ", \"device_mb_per_s\": %.2f",
+                    ((double) result->bytes * 1000.0) / (double) result->device_ns);
+        }
+    }
+    if (strcmp(result->name, "lookup_miss") == 0){
+        fprintf(json, ", \"collisions\": %u", result->collisions);
+    }
+    if (result->image_bytes > 0){
+        fprintf(json, ", \"align\": %u, \"align_min\": %u, \"image_bytes\": %llu", result->align,
+                result->align_min, (unsigned long long) result->image_bytes);
+    }
+    fprintf(json, "}");
+    fflush(json);
+    context->results ++;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchPath
+ *
+ * DESCRIPTION:
+ * Return the path of a file with the disk prefix used by SYS_FS.
+ *
+ * PARAMETERS:
+ * name         const char *    file path within the image
+ * path         char *          buffer for the path
+ * path_size    size_t          size of the buffer
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchPath(const char *name, char *path, size_t path_size){
+    snprintf(path, path_size, "%u:/%s", BENCH_DISK, name);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchFileName
+ *
+ * DESCRIPTION:
+ * Return the path of a small file of a synthetic image.
+ *
+ * PARAMETERS:
+ * file         uint32_t    number of the file
+ * name         char *      buffer for the path
+ * name_size    size_t      size of the buffer
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Small files are named dNNN/fNNNNNN.htm with BENCH_FILES_PER_DIR files per
+ * directory.
+ *
+ *****************************************************************************/
+static void BenchFileName(uint32_t file, char *name, size_t name_size){
+    snprintf(name, name_size, "d%03u/f%06u.htm", file / BENCH_FILES_PER_DIR, file);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchTreeCreate
+ *
+ * DESCRIPTION:
+ * Create an empty input tree in the temporary directory.
+ *
+ * PARAMETERS:
+ * tree         bench_tree_t *  returns the tree
+ *
+ * RETURN VALUE:
+ * bool     true if the tree was created, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static bool BenchTreeCreate(bench_tree_t *tree){
+    char path[BENCH_TREE_PATH_MAX];
+
+    memset(tree, 0, sizeof(bench_tree_t));
+    strcpy(tree->dir, "/tmp/ewfs_bench_XXXXXX");
+    if (mkdtemp(tree->dir) == NULL){
+        return false;
+    }
+    snprintf(tree->image, sizeof(tree->image), "%s/image.bin", tree->dir);
+    BenchTreePath(tree, "", path, sizeof(path));
+    if (mkdir(path, 0755) != 0){
+        rmdir(tree->dir);
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchTreeSet
+ *
+ * DESCRIPTION:
+ * Write or remove files so the tree has the given content.
+ *
+ * PARAMETERS:
+ * tree         bench_tree_t *  tree to change
+ * file_count   uint32_t        number of small files of BENCH_FILE_SIZE bytes
+ * large        bool            BENCH_LARGE_FILE of BENCH_LARGE_FILE_SIZE bytes
+ * generated    bool            BENCH_GENERATED_FILE, listed in
+ *                              BENCH_GENERATED_LIST with an empty placeholder
+ *
+ * RETURN VALUE:
+ * bool     true if the tree has the content, otherwise false
+ *
+ * NOTES:
+ * Files already in the tree are kept, so a tree that grows and shrinks
+ * writes each file once.  The content is printable text that differs
+ * between files.
+ *
+ *****************************************************************************/
+static bool BenchTreeSet(bench_tree_t *tree, uint32_t file_count, bool large, bool generated){
+    static const char list[] = BENCH_GENERATED_FILE "\r\n";
+    char name[BENCH_NAME_MAX];
+    char path[BENCH_TREE_PATH_MAX];
+    FILE *list_file;
+    bool result = true;
+
+    while (result && (tree->file_count < file_count)){
+        BenchFileName(tree->file_count, name, sizeof(name));
+        BenchTreePath(tree, name, path, sizeof(path));
+        if ((tree->file_count % BENCH_FILES_PER_DIR) == 0){
+            *strrchr(path, '/') = '\0';
+            result = mkdir(path, 0755) == 0;
+        }
+        result = result && BenchTreeWrite(tree, name, tree->file_count, BENCH_FILE_SIZE);
+        tree->file_count += result ? 1 : 0;
+    }
+    //the last file of a directory is its first
+    while (tree->file_count > file_count){
+        tree->file_count --;
+        BenchFileName(tree->file_count, name, sizeof(name));
+        BenchTreePath(tree, name, path, sizeof(path));
+        unlink(path);
+        if ((tree->file_count % BENCH_FILES_PER_DIR) == 0){
+            *strrchr(path, '/') = '\0';
+            rmdir(path);
+        }
+    }
+    if (result && (tree->large != large)){
+        BenchTreePath(tree, BENCH_LARGE_FILE, path, sizeof(path));
+        result = large ? BenchTreeWrite(tree, BENCH_LARGE_FILE, 0, BENCH_LARGE_FILE_SIZE) :
+                (unlink(path) == 0);
+        tree->large = large;
+    }
+    if (result && (tree->generated != generated)){
+        if (generated){
+            BenchTreePath(tree, BENCH_GENERATED_LIST, path, sizeof(path));
+            list_file = fopen(path, "wb");
+            result = (list_file != NULL) && (fwrite(list, 1, sizeof(list) - 1, list_file) == sizeof(list) - 1);
+            result = (list_file != NULL) && (fclose(list_file) == 0) && result;
+            result = result && BenchTreeWrite(tree, BENCH_GENERATED_FILE, 0, 0);
+        }else{
+            BenchTreePath(tree, BENCH_GENERATED_LIST, path, sizeof(path));
+            unlink(path);
+            BenchTreePath(tree, BENCH_GENERATED_FILE, path, sizeof(path));
+            unlink(path);
+        }
+        tree->generated = generated;
+    }
+    if (result == false){
+        fprintf(stderr, "Can't write the tree '%s'.\n", tree->dir);
+    }
+    return result;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchTreeWrite
+ *
+ * DESCRIPTION:
+ * Write a file of the tree.
+ *
+ * PARAMETERS:
+ * tree         const bench_tree_t *    tree of the file
+ * name         const char *            path of the file in the tree
+ * seed         uint32_t                seed of the file content
+ * size         uint32_t                size of the file
+ *
+ * RETURN VALUE:
+ * bool     true if the file was written, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static bool BenchTreeWrite(const bench_tree_t *tree, const char *name, uint32_t seed, uint32_t size){
+    char path[BENCH_TREE_PATH_MAX];
+    uint32_t count;
+    bool result = true;
+    FILE *file;
+
+    BenchTreePath(tree, name, path, sizeof(path));
+    file = fopen(path, "wb");
+    if (file == NULL){
+        return false;
+    }
+    for (count = 0; result && (count < size); count ++){
+        result = fputc('a' + (int) ((seed + count) % 26), file) != EOF;
+    }
+    return (fclose(file) == 0) && result;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchTreePath
+ *
+ * DESCRIPTION:
+ * Return the host path of a file of the tree.
+ *
+ * PARAMETERS:
+ * tree         const bench_tree_t *    tree of the file
+ * name         const char *            path of the file in the tree
+ * path         char *                  buffer for the path
+ * path_size    size_t                  size of the buffer
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchTreePath(const bench_tree_t *tree, const char *name, char *path, size_t path_size){
+    snprintf(path, path_size, "%s/tree/%s", tree->dir, name);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchTreeRemove
+ *
+ * DESCRIPTION:
+ * Remove the tree, the image and the temporary directory.
+ *
+ * PARAMETERS:
+ * tree         bench_tree_t *  tree to remove
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchTreeRemove(bench_tree_t *tree){
+    char path[BENCH_TREE_PATH_MAX];
+
+    BenchTreeSet(tree, 0, false, false);
+    BenchTreePath(tree, "", path, sizeof(path));
+    rmdir(path);
+    unlink(tree->image);
+    rmdir(tree->dir);
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchGenerate
+ *
+ * DESCRIPTION:
+ * Build the image of the tree with the image generator.
+ *
+ * PARAMETERS:
+ * context      bench_context_t *   benchmark state
+ * tree         bench_tree_t *      tree to build
+ * options      const char *[]      generator options, NULL terminated
+ * files        uint32_t *          returns the number of files in the image
+ *
+ * RETURN VALUE:
+ * bool     true if the image was built, otherwise false
+ *
+ * NOTES:
+ * The output of the generator is dropped, the results go to stdout.
+ *
+ *****************************************************************************/
+static bool BenchGenerate(bench_context_t *context, bench_tree_t *tree, const char *options[],
+        uint32_t *files){
+    const char *argv[BENCH_OPTIONS_MAX + 7];
+    char input[BENCH_TREE_PATH_MAX];
+    uint8_t count[2];
+    uint32_t arg = 0;
+    FILE *image_file;
+    pid_t child;
+    int status = -1;
+    int null_fd;
+
+    BenchTreePath(tree, "", input, sizeof(input));
+    argv[arg ++] = context->generator;
+    argv[arg ++] = "-f";
+    while ((*options != NULL) && (arg < BENCH_OPTIONS_MAX + 2)){
+        argv[arg ++] = *options ++;
+    }
+    argv[arg ++] = "-i";
+    argv[arg ++] = input;
+    argv[arg ++] = "-o";
+    argv[arg ++] = tree->image;
+    argv[arg] = NULL;
+
+    fflush(NULL);
+    child = fork();
+    if (child == 0){
+        null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0){
+            dup2(null_fd, STDOUT_FILENO);
+        }
+        execv(context->generator, (char * const *) argv);
+        _exit(127);
+    }
+    if ((child < 0) || (waitpid(child, &status, 0) != child) || (WIFEXITED(status) == false) ||
+            (WEXITSTATUS(status) != 0)){
+        fprintf(stderr, "Can't build the image '%s' with '%s'.\n", tree->image, context->generator);
+        return false;
+    }
+    //the number of files of the header
+    image_file = fopen(tree->image, "rb");
+    if (image_file == NULL){
+        return false;
+    }
+    status = (fseek(image_file, 5, SEEK_SET) == 0) && (fread(count, 1, sizeof(count), image_file) == sizeof(count));
+    fclose(image_file);
+    *files = (uint32_t) count[0] | ((uint32_t) count[1] << 8);
+    return status != 0;
+}
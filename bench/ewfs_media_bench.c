@@ -0,0 +1,310 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_media_bench.c
+ *
+ * FILE DESCRIPTION:
+ * Benchmark of the host media backends.  Random reads of the image are done
+ * with plain pread() and through the media manager stand-in with the io_uring
+ * backends at queue depths from 1 to HOST_MEDIA_QUEUE_DEPTH.
+ *
+ * FILE NOTES:
+ * Usage: ewfs_media_bench [-s READ SIZE] [-n READS] [-f FLASH] IMAGE
+ *
+ * The offsets come from a fixed seed so every backend reads the same blocks.
+ * Buffered results depend on the page cache, the O_DIRECT results measure the
+ * device.  With -f the simulated flash device time of the reads is reported
+ * next to the host wall time.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "host_media.h"
+#include "host_port.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define BENCH_DISK          0
+#define BENCH_READ_SIZE     4096
+#define BENCH_READS         20000
+#define BENCH_SEED          0x45574653u     //"EWFS"
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static uint32_t BenchOffset(uint32_t *seed, uint32_t image_size, uint32_t read_size);
+static uint64_t BenchPread(const char *image_path, uint32_t image_size, uint32_t read_size,
+        uint32_t reads, const host_flash_t *flash, uint64_t *device_ns);
+static uint64_t BenchMediaManager(uint32_t image_size, uint32_t read_size, uint32_t reads,
+        uint32_t queue_depth);
+static void BenchReport(const char *backend, uint32_t queue_depth, uint32_t read_size,
+        uint32_t reads, uint64_t nanoseconds, uint64_t device_ns);
+
+/******************************************************************************
+ * FUNCTION:  main
+ *
+ * DESCRIPTION:
+ * Run the media benchmark and print one line per backend and queue depth.
+ *
+ * PARAMETERS:
+ * argc         int         number of command line arguments
+ * argv[]       char *      array of command line arguments
+ *
+ * RETURN VALUE:
+ * int      0 if successful, otherwise 1
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[]){
+    static const host_media_backend_e backends[] = {HOST_MEDIA_URING, HOST_MEDIA_URING_DIRECT};
+    static const char *backend_names[] = {"uring", "uring_direct"};
+    uint32_t read_size = BENCH_READ_SIZE;
+    uint32_t reads = BENCH_READS;
+    const host_flash_t *flash = NULL;
+    host_media_stats_t stats;
+    uint64_t device_ns = 0;
+    uint32_t image_size;
+    uint32_t queue_depth;
+    uint32_t backend;
+    uint64_t nanoseconds;
+    int arg = 1;
+
+    while ((arg + 1 < argc) && (argv[arg][0] == '-')){
+        if (strcmp(argv[arg], "-s") == 0){
+            read_size = (uint32_t) strtoul(argv[arg + 1], NULL, 0);
+        }else if (strcmp(argv[arg], "-n") == 0){
+            reads = (uint32_t) strtoul(argv[arg + 1], NULL, 0);
+        }else if (strcmp(argv[arg], "-f") == 0){
+            flash = HOST_FLASH_PresetFind(argv[arg + 1]);
+            if (flash == NULL){
+                fprintf(stderr, "Unknown flash '%s', use one of:", argv[arg + 1]);
+                for (backend = 0; HOST_FLASH_PresetGet(backend) != NULL; backend ++){
+                    fprintf(stderr, " %s", HOST_FLASH_PresetGet(backend)->name);
+                }
+                fprintf(stderr, "\n");
+                return 1;
+            }
+        }
+        arg += 2;
+    }
+    if ((arg >= argc) || (read_size == 0) || (reads == 0)){
+        fprintf(stderr, "Usage: ewfs_media_bench [-s READ SIZE] [-n READS] [-f FLASH] IMAGE\n");
+        return 1;
+    }
+    if (HOST_MEDIA_Attach(BENCH_DISK, argv[arg], HOST_MEDIA_PREAD) == false){
+        fprintf(stderr, "Can't open image '%s'.\n", argv[arg]);
+        return 1;
+    }
+    image_size = HOST_MEDIA_SizeGet(BENCH_DISK);
+    HOST_MEDIA_Detach(BENCH_DISK);
+    if (image_size < read_size){
+        fprintf(stderr, "The image is smaller than the read size.\n");
+        return 1;
+    }
+
+    fprintf(stdout, "backend\t\tqd\tread\treads\tMB/s\tIOPS\tdevice ms\tdevice MB/s\n");
+    nanoseconds = BenchPread(argv[arg], image_size, read_size, reads, flash, &device_ns);
+    BenchReport("pread", 1, read_size, reads, nanoseconds, device_ns);
+    for (backend = 0; backend < sizeof(backends) / sizeof(backends[0]); backend ++){
+        if (HOST_MEDIA_Attach(BENCH_DISK, argv[arg], backends[backend]) == false){
+            fprintf(stdout, "%s\tnot supported for this file\n", backend_names[backend]);
+            continue;
+        }
+        HOST_MEDIA_FlashSet(BENCH_DISK, flash);
+        for (queue_depth = 1; queue_depth <= HOST_MEDIA_QUEUE_DEPTH; queue_depth *= 2){
+            HOST_MEDIA_StatsClear(BENCH_DISK);
+            nanoseconds = BenchMediaManager(image_size, read_size, reads, queue_depth);
+            HOST_MEDIA_StatsGet(BENCH_DISK, &stats);
+            BenchReport(backend_names[backend], queue_depth, read_size, reads, nanoseconds,
+                    stats.device_ns);
+        }
+        HOST_MEDIA_Detach(BENCH_DISK);
+    }
+    return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchOffset
+ *
+ * DESCRIPTION:
+ * Return the next pseudo random read offset, aligned to the read size.
+ *
+ * PARAMETERS:
+ * seed         uint32_t *  generator state
+ * image_size   uint32_t    size of the image
+ * read_size    uint32_t    size of each read
+ *
+ * RETURN VALUE:
+ * uint32_t     offset of the read
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static uint32_t BenchOffset(uint32_t *seed, uint32_t image_size, uint32_t read_size){
+    *seed = (*seed * 1103515245u) + 12345u;
+    return ((*seed >> 8) % (image_size / read_size)) * read_size;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchPread
+ *
+ * DESCRIPTION:
+ * Time random reads of the image done with plain pread().
+ *
+ * PARAMETERS:
+ * image_path   const char *    path to the image
+ * image_size   uint32_t        size of the image
+ * read_size    uint32_t        size of each read
+ * reads        uint32_t        number of reads
+ * flash        const host_flash_t *    flash timing, NULL if not simulated
+ * device_ns    uint64_t *      simulated flash device time of the reads
+ *
+ * RETURN VALUE:
+ * uint64_t     elapsed time in nanoseconds
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static uint64_t BenchPread(const char *image_path, uint32_t image_size, uint32_t read_size,
+        uint32_t reads, const host_flash_t *flash, uint64_t *device_ns){
+    uint8_t *buffer = malloc(read_size);
+    uint32_t seed = BENCH_SEED;
+    uint32_t offset;
+    uint64_t start;
+    uint32_t count;
+    int fd;
+
+    *device_ns = 0;
+    fd = open(image_path, O_RDONLY);
+    start = HOST_TimeNanoseconds();
+    for (count = 0; count < reads; count ++){
+        offset = BenchOffset(&seed, image_size, read_size);
+        if (pread(fd, buffer, read_size, offset) != (ssize_t) read_size){
+            break;
+        }
+        if (flash != NULL){
+            *device_ns += HOST_FLASH_ReadTime(flash, offset, read_size);
+        }
+    }
+    start = HOST_TimeNanoseconds() - start;
+    close(fd);
+    free(buffer);
+    return start;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchMediaManager
+ *
+ * DESCRIPTION:
+ * Time random reads of the image done through the media manager, keeping
+ * queue_depth commands outstanding the way that many open files would.
+ *
+ * PARAMETERS:
+ * image_size   uint32_t    size of the image
+ * read_size    uint32_t    size of each read
+ * reads        uint32_t    number of reads
+ * queue_depth  uint32_t    number of commands kept outstanding
+ *
+ * RETURN VALUE:
+ * uint64_t     elapsed time in nanoseconds
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static uint64_t BenchMediaManager(uint32_t image_size, uint32_t read_size, uint32_t reads,
+        uint32_t queue_depth){
+    SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE handles[HOST_MEDIA_QUEUE_DEPTH];
+    SYS_FS_MEDIA_COMMAND_STATUS status;
+    uint8_t *buffers = malloc((size_t) read_size * queue_depth);
+    uint32_t seed = BENCH_SEED;
+    uint32_t issued = 0;
+    uint32_t completed = 0;
+    uint32_t slot;
+    uint64_t start;
+
+    for (slot = 0; slot < queue_depth; slot ++){
+        handles[slot] = SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+    }
+    start = HOST_TimeNanoseconds();
+    while (completed < reads){
+        for (slot = 0; slot < queue_depth; slot ++){
+            if ((handles[slot] == SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID) && (issued < reads)){
+                handles[slot] = SYS_FS_MEDIA_MANAGER_Read(BENCH_DISK,
+                        buffers + ((size_t) slot * read_size),
+                        (uint8_t *) (uintptr_t) BenchOffset(&seed, image_size, read_size), read_size);
+                issued ++;
+            }
+        }
+        SYS_FS_MEDIA_MANAGER_TransferTask(BENCH_DISK);
+        for (slot = 0; slot < queue_depth; slot ++){
+            if (handles[slot] == SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID){
+                continue;
+            }
+            status = SYS_FS_MEDIA_MANAGER_CommandStatusGet(BENCH_DISK, handles[slot]);
+            if ((status != SYS_FS_MEDIA_COMMAND_QUEUED) && (status != SYS_FS_MEDIA_COMMAND_IN_PROGRESS)){
+                handles[slot] = SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+                completed ++;
+            }
+        }
+    }
+    start = HOST_TimeNanoseconds() - start;
+    free(buffers);
+    return start;
+}
+
+/******************************************************************************
+ * FUNCTION:  BenchReport
+ *
+ * DESCRIPTION:
+ * Print the throughput of one benchmark run.
+ *
+ * PARAMETERS:
+ * backend      const char *    name of the backend
+ * queue_depth  uint32_t        queue depth of the run
+ * read_size    uint32_t        size of each read
+ * reads        uint32_t        number of reads
+ * nanoseconds  uint64_t        elapsed time
+ * device_ns    uint64_t        simulated flash device time, 0 if not simulated
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void BenchReport(const char *backend, uint32_t queue_depth, uint32_t read_size,
+        uint32_t reads, uint64_t nanoseconds, uint64_t device_ns){
+    double seconds = (double) nanoseconds / 1e9;
+
+    if (seconds <= 0){
+        seconds = 1e-9;
+    }
+    fprintf(stdout, "%-12s\t%u\t%u\t%u\t%.1f\t%.0f", backend, queue_depth, read_size, reads,
+            ((double) read_size * reads) / (seconds * 1e6), reads / seconds);
+    if (device_ns > 0){
+        fprintf(stdout, "\t%.3f\t\t%.1f", (double) device_ns / 1e6,
+                ((double) read_size * reads * 1e3) / (double) device_ns);
+    }
+    fprintf(stdout, "\n");
+}
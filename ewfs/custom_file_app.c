@@ -27,6 +27,8 @@
  *                              FILE INCLUDES
  *****************************************************************************/
 #include "custom_file_app.h"
+#include "ewfs.h"
+#include "ewfs_json.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -37,34 +39,23 @@
 /******************************************************************************
  *                          DEFINITIONS
  *****************************************************************************/
-#define FILE_LIST_COUNT     2
-
-/******************************************************************************
- *                              TYPE DEFINES
- *****************************************************************************/
-typedef struct{
-    uint8_t *file_name;
-    uint8_t file_name_length;
-    uint16_t hash;
-}gen_file_list_t;
-
-//the user must fill in this list with the file name and size of file name and 0
-gen_file_list_t my_file_list[FILE_LIST_COUNT] = {
-    {"me.json",7,0},
-    {"largefile.json",14,0}
-};
+#define LARGE_FILE_LINES        26      //one line for each letter
+#define LARGE_FILE_TEXT_SIZE    448     //letters in the text of a line
 
 /******************************************************************************
  *                          FUNCTION PROTOTYPES
  *****************************************************************************/
-uint32_t GenerateLargeFileJson(uint16_t *index, uint32_t max_size, uint8_t *buffer);
+static uint32_t GenerateLargeFileJson(void *context, void *state, uint32_t max_size,
+        uint8_t *buffer);
+static uint32_t GenerateCounterVariable(void *context, void *state, uint32_t offset,
+        uint32_t max_size, uint8_t *buffer);
 
 /******************************************************************************
  * FUNCTION:  InitGeneratedFiles
  * 
  * DESCRIPTION:
- * Initialize the generated file list (my_file_list[]) array with additional 
- * data.  
+ * Register the generators of the files listed as generated in the image and
+ * the variables of the template files.
  * 
  * PARAMETERS:
  * none   
@@ -73,117 +64,63 @@ uint32_t GenerateLargeFileJson(uint16_t *index, uint32_t max_size, uint8_t *buff
  * none
  * 
  * NOTES:
- * The user must setup the FILE_LIST_COUNT with correct number of files.  The
- * varialbe my_file_list also needs to be updated with the file names.
+ * The user adds an EWFS_RegisterGeneratedFile() call for every generated 
+ * file.  The path is the same as in ewfslist.txt.  A generated file without a
+ * registered generator can't be opened.  largefile.json is streamed, it has no
+ * size function so it is only generated once per read of the file.
+ * Template variables are registered with EWFS_RegisterTemplateVariable() by
+ * the name used in the templates, ~counter~ is replaced with a read count.
  * 
 ******************************************************************************/
 void InitGeneratedFiles(){
-    uint8_t *ptr;
-    uint16_t count = 0;
-    uint16_t hash = 0;
-    uint16_t size = 0;
-    
-    //calculate the hashes for the files that can be generated
-    for (count = 0; count < FILE_LIST_COUNT; count ++){
-        ptr = my_file_list[count].file_name;
-        hash = 0;
-        for (size = 0; size < my_file_list[count].file_name_length; size ++){
-            hash <<=1;
-            hash += *ptr ++;
-        }
-        my_file_list[count].hash = hash;
-    }
+    EWFS_RegisterGeneratedFile("largefile.json", NULL, GenerateLargeFileJson, NULL, 0);
+    EWFS_RegisterTemplateVariable("counter", GenerateCounterVariable, NULL);
 }
 
 /******************************************************************************
- * FUNCTION:  GenerateFileRead
+ * FUNCTION:  GenerateCounterVariable
  *
  * DESCRIPTION:
- * This function determines which file is being read and generates the data.
+ * This function generates the value of the ~counter~ template variable, the
+ * number of times it was read.
  *
  * PARAMETERS:
- * hash             uint16_t    hash of the file name
- * buffer           uint8_t *   pointer to the buffer
- * buffer_size      uint32_t    the maximum size of data that can be put into 
- *                              the buffer
- * num_bytes_read   uint32_t *  the number of bytes put into the buffer
- * index            uint16_t *  The index of the file generation process
- * offset           uint32_t    offset to the number of bytes to read
+ * context      void *      registered context (unused)
+ * state        void *      state of this use of the variable in the open file
+ * offset       uint32_t    offset in the value to start at
+ * max_size     uint32_t    maximum size of the buffer
+ * buffer       uint8_t *   pointer to the buffer for the value
  *
- * RETURN VALUE:  None.
+ * RETURN VALUE:
+ * uint32_t     bytes put in the buffer, 0 at the end of the value
  *
- * NOTES:  None.
+ * NOTES:
+ * The value is formatted in the state when it is started and kept there for
+ * the next parts, so files reading it at the same time each continue their
+ * own value.
  *
  *****************************************************************************/
-void GenerateFileRead(uint16_t hash, uint8_t *buffer, uint32_t buffer_size, 
-        uint32_t *num_bytes_read, uint16_t *index, uint32_t *offset){
-    volatile int16_t count = -1;
-    volatile uint32_t my_num_bytes_read;
-    volatile uint32_t my_offset = *offset;
-    volatile uint8_t my_buf[buffer_size];
+static uint32_t GenerateCounterVariable(void *context, void *state, uint32_t offset,
+        uint32_t max_size, uint8_t *buffer){
+    static uint32_t counter = 0;
+    char *value = state;
+    uint32_t length;
     
-    
-    for (count = 0; count < FILE_LIST_COUNT; count ++){
-        if (my_file_list[count].hash == hash){
-            if (strncmp(my_file_list[count].file_name, "largefile.json", strlen("largefile.json")) == 0){
-                *num_bytes_read = GenerateLargeFileJson(index, buffer_size, buffer);
-            }else{
-                *num_bytes_read = 0;
-            }
-            if ((my_offset > 0) && (*num_bytes_read > 0)){
-                my_num_bytes_read = *num_bytes_read;
-                //move the buffered data
-                memmove(buffer, (uint8_t *)(buffer + (*num_bytes_read - *offset)), *offset);
-                *num_bytes_read = *offset;
-                *offset = 0;
-            }
-            return;
-        }
+    (void) context;
+    if (offset == 0){
+        counter ++;
+        snprintf(value, EWFS_GEN_STATE_SIZE, "%u", (unsigned int) counter);
     }
-    if (count == -1){
-        *num_bytes_read = 0;
-        return;
+    length = strlen(value);
+    if (offset >= length){
+        return 0;
     }
-}
-
-/******************************************************************************
- * FUNCTION:  GenerateFileSize
- *
- * DESCRIPTION:
- * This function determines the size of the next itteration of calling 
- * GenerateFileRead().  This function checks the file name to determine the 
- * next file size.
- *
- * PARAMETERS:
- * hash             uint16_t    hash of the file name
- *
- * RETURN VALUE:
- * uint32_t     size of the next iteration of reading the file
- *
- * NOTES:  None.
- *
- *****************************************************************************/
-uint32_t GenerateFileSize(uint16_t hash){
-    volatile uint16_t count = 0;
-    volatile uint16_t i;
-    volatile uint32_t num_bytes_read = 0;
-    volatile uint32_t sum=0;
-    volatile uint8_t buf[512];
-            
-    for (count = 0; count < FILE_LIST_COUNT; count ++){
-        if (my_file_list[count].hash == hash){
-            if (strncmp(my_file_list[count].file_name, "largefile.json", strlen("largefile.json")) == 0){
-                i = 0;
-                //loop through all indexes to get the size
-                do{
-                    num_bytes_read = GenerateLargeFileJson((uint16_t *)&i,512, (uint8_t *)buf);
-                    sum += num_bytes_read;
-                }while (num_bytes_read > 0);
-            }
-            break;            
-        }
+    length -= offset;
+    if (length > max_size){
+        length = max_size;
     }
-    return sum;
+    memcpy(buffer, &value[offset], length);
+    return length;
 }
 
 /******************************************************************************
@@ -193,65 +130,48 @@ uint32_t GenerateFileSize(uint16_t hash){
  * This function generates the file data for largefile.json.
  *
  * PARAMETERS:
- * index    uint16_t *  index or itteration count of generating this file
+ * context      void *      registered context (unused)
+ * state        void *      state of the JSON writer kept in the open file
  * max_size     uint32_t    maximum size of the buffer
  * buffer       uint8_t *   pointer to the buffer for the generated data
  *
  * RETURN VALUE:
- * uint32_t     size of the next iteration of reading the file
+ * uint32_t     bytes put in the buffer, 0 at the end of the file
  *
- * NOTES:  None.
+ * NOTES:
+ * The file is an array of LARGE_FILE_LINES objects, one for each letter,
+ * written with the streaming JSON writer.  Item 0 is the start of the array,
+ * items 1 to LARGE_FILE_LINES the lines and the last item the end of the
+ * array.  The start of each item is published as a seek checkpoint.
  *
  *****************************************************************************/
-uint32_t GenerateLargeFileJson(uint16_t *index, uint32_t max_size, uint8_t *buffer){
-    volatile uint32_t size = 0;
+static uint32_t GenerateLargeFileJson(void *context, void *state, uint32_t max_size,
+        uint8_t *buffer){
+    static char text[LARGE_FILE_TEXT_SIZE];
+    ewfs_json_t json;
+    uint32_t item;
     
-    switch (*index){
-        case 0:     //a
-        case 1:     //b
-        case 2:     //c
-        case 3:     //d
-        case 4:     //e
-        case 5:     //f
-        case 6:     //g
-        case 7:     //h
-        case 8:     //i
-        case 9:     //j
-        case 10:    //k
-        case 11:    //l
-        case 12:    //m
-        case 13:    //n
-        case 14:    //o
-        case 15:    //p
-        case 16:    //q
-        case 17:    //r
-        case 18:    //s
-        case 19:    //t
-        case 20:    //u 
-        case 21:    //v
-        case 22:    //w
-        case 23:    //x
-        case 24:    //y
-        case 25:    //z
-            memset(buffer, 'a'+*index, max_size);
-            buffer[max_size-1] = '\r';
-            buffer[max_size - 0] = '\n';
-            size = max_size;
+    (void) context;
+    EWFS_JsonStart(&json, state, buffer, max_size);
+    while (EWFS_JsonNext(&json, &item) == true){
+        EWFS_GeneratedCheckpoint(state, EWFS_JsonLength(&json));
+        if (item == 0){
+            EWFS_JsonArrayStart(&json);
+        }else if (item <= LARGE_FILE_LINES){
+            memset(text, 'a' + item - 1, sizeof(text));
+            EWFS_JsonObjectStart(&json);
+            EWFS_JsonKey(&json, "line");
+            EWFS_JsonUint(&json, item);
+            EWFS_JsonKey(&json, "fraction");
+            EWFS_JsonFloat(&json, (float) item / LARGE_FILE_LINES, 4);
+            EWFS_JsonKey(&json, "text");
+            EWFS_JsonStringLength(&json, text, sizeof(text));
+            EWFS_JsonObjectEnd(&json);
+        }else if (item == LARGE_FILE_LINES + 1){
+            EWFS_JsonArrayEnd(&json);
+        }else{
             break;
-        default:
-            size = 0;
-            break;
-    }
-    
-    if (size > 0){
-        (*index) ++;   //increment json creation index
-        if (size > max_size ){
-            //the size of data is to large for the buffer.
-            memset(buffer, 0x00, max_size); //clear the buffer
-            size = 0;
-            (*index) --;
         }
     }
-    
-    return size;
-}
\ No newline at end of file
+    return EWFS_JsonLength(&json);
+}
@@ -33,33 +33,103 @@
 #include <stddef.h>
 #include "system/command/sys_command.h"
 #include "custom_file_app.h"
+#include "ewfs_crc.h"
 
 /******************************************************************************
  *                          DEFINITIONS
  *****************************************************************************/
 #define EWFS_HANDLE_TOKEN_MAX (0xFF)
-#define EWFS_MAKE_HANDLE(token, disk, index) (((token) << 24) | ((disk) << 16) | (index))
+#define EWFS_MAKE_HANDLE(token, disk, index) (((uint32_t) (token) << 24) | ((disk) << 16) | (index))
+#define EWFS_TEMPLATE_SLOT    (0x80000000u)   //template segment is a variable
+#define EWFS_TEMPLATE_NAME_SHIFT 24           //length of the variable name in a segment word
+#define EWFS_TEMPLATE_NAME_OFFSET (0x00FFFFFFu)   //offset of the variable name in the template
+#define EWFS_TEMPLATE_NAME_MAX 32             //longest variable name of the generator
+#define EWFS_SKIP_SIZE        32              //bytes generated per call when skipping data
+#define EWFS_HEADER_SIZE      7               //magic, version and file count
+#define EWFS_SEED_VERSION     2               //first image version with a hash seed after the header
+#define EWFS_SEED_SIZE        2
+#define EWFS_CHECKSUM_VERSION 3               //first image version with checksums after the index
+#define EWFS_CRC_SIZE         4
+#define EWFS_LONG_HASH_VERSION 4              //first image version with 32 bit path hashes after the index
+#define EWFS_LONG_HASH_SIZE   4
 #define EWFS_UPDATE_HANDLE_TOKEN(token) { \
     (token)++; \
     (token) = ((token) == EWFS_HANDLE_TOKEN_MAX) ? 0: (token); \
 }
+//platform hint of how a media range is about to be read (e.g. to start a
+//read ahead), sequential is false for random access
+#ifndef EWFS_MEDIA_ACCESS_HINT
+#define EWFS_MEDIA_ACCESS_HINT(disk, address, length, sequential)
+#endif
+//time stamps of the statistics and the tracer are core timer ticks counted
+//across the restarts done for the delays
+#if defined(EWFS_STATS_ENABLE) || defined(EWFS_TRACE_ENABLE) || defined(EWFS_GEN_CACHE_ENABLE)
+#define EWFS_TIMER_TICKS()                  (ewfs_timer_ticks + _APP_SQI_ReadCoreTimer())
+#define EWFS_TIMER_RESTART()                (ewfs_timer_ticks += _APP_SQI_ReadCoreTimer())
+#else
+#define EWFS_TIMER_RESTART()
+#endif
+//runtime statistics, compiled out unless EWFS_STATS_ENABLE is defined
+#if defined(EWFS_STATS_ENABLE)
+#define EWFS_STATS_ADD(counter, value)      (ewfs_stats.counter += (value))
+#define EWFS_STATS_START(start)             const uint32_t start = EWFS_TIMER_TICKS()
+#define EWFS_STATS_TIME(histogram, start)   EWFSStatsHistogramAdd(&ewfs_stats.histogram, \
+        EWFS_TIMER_TICKS() - (start))
+#else
+#define EWFS_STATS_ADD(counter, value)
+#define EWFS_STATS_START(start)
+#define EWFS_STATS_TIME(histogram, start)
+#endif
+//event tracer, compiled out unless EWFS_TRACE_ENABLE is defined
+#if defined(EWFS_TRACE_ENABLE)
+#define EWFS_TRACE(type, file, hash, offset, length)    EWFSTraceAdd(type, file, hash, offset, length)
+#else
+#define EWFS_TRACE(type, file, hash, offset, length)
+#endif
 
 /******************************************************************************
  *                              TYPE DEFINES
  *****************************************************************************/
 typedef enum __attribute__((packed,aligned(1))){
     TYPE_GENERATED = 0,
-	TYPE_FILE = 1
+	TYPE_FILE = 1,
+	TYPE_TEMPLATE = 2
 }file_type_e;
 
+#if defined(EWFS_GEN_CACHE_ENABLE)
+//state of the cached output of a generated file
+typedef enum{
+    EWFS_GEN_CACHE_EMPTY = 0,   //no output in the cache
+    EWFS_GEN_CACHE_FILLING,     //output is stored while a file reads it
+    EWFS_GEN_CACHE_VALID,       //output can be served
+    EWFS_GEN_CACHE_STALE        //invalidated, kept until its readers close
+}ewfs_gen_cache_state_e;
+
+//how an open generated file uses the cache
+typedef enum{
+    EWFS_GEN_CACHE_NONE = 0,    //runs the generator
+    EWFS_GEN_CACHE_FILL,        //runs the generator and stores the output
+    EWFS_GEN_CACHE_SERVE        //copies the output from the cache
+}ewfs_gen_cache_use_e;
+#endif
+
 //EWFS header structure
 typedef struct{
     uint8_t disk_num;
     uint8_t version;
     uint16_t file_count;
-    uint32_t base_address;
+    uintptr_t base_address;
     uint32_t file_start_address;
     bool cachable_index;
+    uint16_t hash_seed;         //seed of the path hash, 0 for the original hash
+#if defined(EWFS_MEDIA_IS_MAPPED)
+    bool mapped;                //media is memory mapped and read directly
+    uint32_t media_size;        //size of the mapped media in bytes
+#endif
+#if defined(EWFS_CHECKSUM_ENABLE)
+    bool checksums;             //the image has checksums, ewfs_crc holds them
+    uint32_t header_crc;        //CRC of the header, the index and the checksums
+#endif
 }ewfs_header_t;
 
 //EWFS fiile index item structure
@@ -70,25 +140,121 @@ typedef struct __attribute__((packed,aligned(1))){
     uint32_t length;
 }ewfs_index_t;
 
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+//generator state that continues a generated file at an offset
+typedef struct{
+    uint32_t offset;            //bytes of the file before the state
+    uint32_t state[EWFS_GEN_STATE_SIZE / sizeof(uint32_t)];
+}ewfs_gen_checkpoint_t;
+#endif
+
+//registered generated file
+typedef struct{
+    uint16_t hash;              //hash of the file path with the seed of the mounted image
+    const char *path;           //registered path, hashed again when an image is mounted
+    ewfs_gen_size_t size;
+    ewfs_gen_read_t read;
+    void *context;
+    uint8_t flags;              //EWFS_GEN_ flags
+    uint32_t cached_size;       //size kept for EWFS_GEN_STABLE_SIZE, EWFS_SIZE_UNKNOWN if none
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    uint32_t cache_ttl;         //core timer ticks the output is kept, 0 if not cached
+    uint32_t cache_time;        //core timer ticks when the output was generated
+    uint32_t cache_offset;      //offset of the output in ewfs_gen_cache
+    uint32_t cache_length;      //length of the output, or of the part stored so far
+    uint8_t cache_state;        //ewfs_gen_cache_state_e
+    uint8_t cache_readers;      //open files served from the cache
+#endif
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+    ewfs_gen_checkpoint_t checkpoints[EWFS_GEN_CHECKPOINTS];    //by increasing offset
+    uint32_t checkpoint_count;
+    uint32_t checkpoint_spacing;    //least bytes between recorded checkpoints
+#endif
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+    ewfs_gen_snapshot_t snapshot;   //takes the snapshot at open, NULL for none
+#endif
+}ewfs_generator_t;
+
+//registered template variable
+typedef struct{
+    const char *name;           //variable name, kept from the registration
+    ewfs_var_read_t read;
+    void *context;
+}ewfs_variable_t;
+
 //EWFS opened file structure
 typedef struct{
     uint32_t current_position;  //current position in file
     uint32_t bytes_remaining;   //bytes remaining to send
     uint32_t size;          	//size of file
     uint32_t handle;        	//handle to file
-    uint16_t gen_hash;          //hash of the file - used by generated files
-    uint16_t gen_index;         //index of generated file - used by generated files
-    uint32_t gen_offset;    	//offset if not all the data was sent - otherwise 0 bytes
+    uint16_t gen_hash;          //hash of the file - used by generated files and the tracer
+    uint32_t gen_state[EWFS_GEN_STATE_SIZE / sizeof(uint32_t)];   //state of the generator
+    uint32_t gen_position;      //bytes generated from the state, differs from
+                                //current_position while a seek skips data
+    ewfs_generator_t *generator;    //callbacks of a generated file, resolved at open
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    uint8_t gen_cache;          //ewfs_gen_cache_use_e
+#endif
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+    uint32_t *gen_snapshot;     //snapshot buffer of the file, NULL for none
+#endif
+    uint32_t tpl_table;         //media address of the template segment table
+    uint32_t tpl_segment;       //media address of the next segment word
+    uint32_t tpl_data;          //media address of the next static byte
+    uint32_t tpl_run;           //static bytes left in the segment, or variable bytes done
+    uint16_t tpl_segments;      //segments not started
+    bool tpl_slot;              //the segment is a variable
+    const ewfs_variable_t *tpl_variable;    //variable of the segment, NULL if not registered
+#if defined(EWFS_CHECKSUM_ENABLE)
+    uint32_t crc;               //CRC of the data read from the start of the file
+    uint32_t crc_next;          //offset in the file the CRC continues at
+    uint32_t crc_expected;      //CRC of the file in the image
+    uint8_t verify;             //ewfs_verify_e
+#endif
     file_type_e type;       	//type of file (generated or file)
 }ewfs_file_obj_t;
 
-static ewfs_header_t ewfs_header = {0xff, 0, 0, 0,true};
+static ewfs_header_t ewfs_header = {.disk_num = 0xff, .cachable_index = true};
 
 static ewfs_index_t *ewfs_index;
+static uint32_t *ewfs_long_hash;    //32 bit hash of each path, NULL unless 16 bit hashes of the image collide
+#if defined(EWFS_CHECKSUM_ENABLE)
+static uint32_t *ewfs_crc;      //CRC of each index entry, then the header CRC
+static ewfs_scrub_t ewfs_scrub;
+static uint8_t ewfs_scrub_buffer[EWFS_SCRUB_CHUNK];
+#endif
 
 static ewfs_file_obj_t ewfs_file_obj[SYS_FS_MAX_FILES];
 uint8_t ewfs_handle_token = 0;
 
+static ewfs_generator_t ewfs_generators[EWFS_GENERATED_FILES_MAX];
+static uint32_t ewfs_generator_count = 0;
+
+static ewfs_variable_t ewfs_variables[EWFS_TEMPLATE_VARIABLES_MAX];
+static uint32_t ewfs_variable_count = 0;
+
+static uint8_t ewfs_skip[EWFS_SKIP_SIZE];   //generated data that is skipped by a seek
+#if defined(EWFS_GEN_CACHE_ENABLE)
+static uint8_t ewfs_gen_cache[EWFS_GEN_CACHE_SIZE];
+static ewfs_file_obj_t *ewfs_gen_cache_filler = NULL;   //only one output is stored at a time
+#endif
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+static uint32_t ewfs_gen_snapshots[EWFS_GEN_SNAPSHOTS][EWFS_GEN_SNAPSHOT_SIZE / sizeof(uint32_t)];
+static bool ewfs_gen_snapshot_used[EWFS_GEN_SNAPSHOTS];
+#endif
+
+#if defined(EWFS_STATS_ENABLE) || defined(EWFS_TRACE_ENABLE) || defined(EWFS_GEN_CACHE_ENABLE)
+static uint32_t ewfs_timer_ticks = 0;   //core timer ticks before the last restart
+#endif
+#if defined(EWFS_STATS_ENABLE)
+static ewfs_stats_t ewfs_stats;
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+static ewfs_trace_event_t ewfs_trace[EWFS_TRACE_ENTRIES];
+static uint32_t ewfs_trace_count = 0;   //events recorded, the ring keeps the last ones
+#endif
+
 const SYS_FS_FUNCTIONS EWFSFunctions = {
     .mount  = EWFS_Mount,
     .unmount = EWFS_Unmount,
@@ -131,12 +297,78 @@ const SYS_FS_FUNCTIONS EWFSFunctions = {
  *****************************************************************************/
 static bool EWFSGetArray(uint8_t diskNum, uint32_t address, uint32_t length, uint8_t *buffer);
 static bool EWFSDiskRead(uint16_t diskNum, uint8_t *destination, uint8_t *source, const uint32_t nBytes);
-static int EWFSFindFile(uint8_t disk_num, uint8_t *file);
+#if EWFS_MEDIA_PAGE_SIZE > 0
+static uint32_t EWFSPageReadLength(uint32_t address, uint32_t btr, uint32_t remaining);
+#endif
+static int EWFSFindFile(uint8_t *file, uint16_t *file_hash);
+static uint16_t EWFSHash(const uint8_t *path, uint16_t seed);
+static uint32_t EWFSLongHash(const uint8_t *path, uint16_t seed);
+static void EWFSRehashGenerators(void);
+static ewfs_generator_t *EWFSFindGenerator(const char *path);
+static uint32_t EWFSGeneratedSize(ewfs_file_obj_t *file_obj);
+static uint32_t EWFSGeneratedRead(ewfs_file_obj_t *file_obj, uint8_t *buffer, uint32_t btr);
+static uint32_t EWFSGeneratedSkip(ewfs_file_obj_t *file_obj, uint32_t length);
+static void EWFSGeneratedRestart(ewfs_file_obj_t *file_obj, uint32_t position);
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+static void EWFSCheckpointDrop(ewfs_generator_t *generator);
+#endif
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE) || defined(EWFS_GEN_SNAPSHOT_ENABLE)
+static ewfs_file_obj_t *EWFSFindGeneratorState(const void *state);
+#endif
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+static uint32_t *EWFSSnapshotReserve(void);
+static void EWFSSnapshotRelease(ewfs_file_obj_t *file_obj);
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE)
+static bool EWFSGenCacheOpen(ewfs_file_obj_t *file_obj);
+static void EWFSGenCacheStore(ewfs_file_obj_t *file_obj, const uint8_t *data, uint32_t length,
+        bool end);
+static void EWFSGenCacheClose(ewfs_file_obj_t *file_obj);
+static void EWFSGenCacheDrop(ewfs_generator_t *generator);
+static bool EWFSGenCacheReserve(uint32_t length);
+static uint32_t EWFSGenCacheCompact(void);
+#endif
+static bool EWFSTemplateStart(uint8_t disk_num, ewfs_file_obj_t *file_obj);
+static uint32_t EWFSTemplateRead(uint8_t disk_num, ewfs_file_obj_t *file_obj, uint8_t *buffer,
+        uint32_t btr);
+static bool EWFSTemplateVariable(uint8_t disk_num, ewfs_file_obj_t *file_obj, uint32_t segment);
+static const ewfs_variable_t *EWFSFindVariable(const char *name);
 static bool EWFSIsHandleValid(uint32_t handle);
+#if defined(EWFS_CHECKSUM_ENABLE)
+static int EWFSChecksumLoad(uint8_t disk_num, uint32_t index_address);
+static bool EWFSChecksumAdd(ewfs_file_obj_t *file_obj, const void *data, uint32_t length);
+static int EWFSScrubCommand(SYS_CMD_DEVICE_NODE *pCmdIO, int argc, char **argv);
+#endif
+#if defined(EWFS_STATS_ENABLE)
+static void EWFSStatsHistogramAdd(ewfs_histogram_t *histogram, uint32_t ticks);
+static void EWFSStatsPrintHistogram(SYS_CMD_DEVICE_NODE *pCmdIO, const char *name,
+        const ewfs_histogram_t *histogram);
+static int EWFSStatsCommand(SYS_CMD_DEVICE_NODE *pCmdIO, int argc, char **argv);
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+static void EWFSTraceAdd(uint8_t type, uint8_t file, uint16_t hash, uint32_t offset, uint32_t length);
+static int EWFSTraceCommand(SYS_CMD_DEVICE_NODE *pCmdIO, int argc, char **argv);
+#endif
+
+#if defined(EWFS_COMMAND_ENABLE)
+static const SYS_CMD_DESCRIPTOR ewfs_commands[] = {
+#if defined(EWFS_STATS_ENABLE)
+    {"ewfsstats", EWFSStatsCommand, ": print EWFS statistics, 'ewfsstats clear' resets them"},
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+    {"ewfstrace", EWFSTraceCommand, ": dump the EWFS trace, 'ewfstrace clear' empties it"},
+#endif
+#if defined(EWFS_CHECKSUM_ENABLE)
+    {"ewfsscrub", EWFSScrubCommand, ": print the EWFS scrub results, 'ewfsscrub run' finishes the pass, "
+            "'ewfsscrub clear' resets them"},
+#endif
+};
+#endif
 
 /******************************************************************************
 * Function: Soft delay functions 
 ******************************************************************************/
+#if defined(__mips__)
 inline static uint32_t _APP_SQI_ReadCoreTimer()
 {
     volatile uint32_t timer;
@@ -152,6 +384,8 @@ inline static void _APP_SQI_StartCoreTimer(uint32_t period)
     /* Reset the coutner */
     volatile uint32_t loadZero = 0;
 
+    EWFS_TIMER_RESTART();
+
     asm volatile("mtc0   %0, $9" : "+r"(loadZero));
     asm volatile("mtc0   %0, $11" : "+r" (period));
 }
@@ -161,6 +395,25 @@ inline void _APP_SQI_CoreTimer_Delay(uint32_t delayValue)
     while ((_APP_SQI_ReadCoreTimer() <= delayValue))
     asm("nop");
 }
+#else
+//host build: the port layer provides the core timer, the host media stand-in
+//completes its commands in the transfer task so no settling delay is needed
+inline static uint32_t _APP_SQI_ReadCoreTimer()
+{
+    return HOST_CoreTimerRead();
+}
+
+inline static void _APP_SQI_StartCoreTimer(uint32_t period)
+{
+    EWFS_TIMER_RESTART();
+    HOST_CoreTimerStart(period);
+}
+
+inline static void _APP_SQI_CoreTimer_Delay(uint32_t delayValue)
+{
+    (void) delayValue;
+}
+#endif
 
 /******************************************************************************
  * FUNCTION:  EWFS_Mount
@@ -180,7 +433,12 @@ inline void _APP_SQI_CoreTimer_Delay(uint32_t delayValue)
 int EWFS_Mount (uint8_t disk_num){
     uint32_t index = 0;
     uint8_t ewfs_fs_start[4];
-    static volatile int k = 0;
+    uint32_t index_address;
+    uint32_t long_hash_size;
+    uint32_t checksum_size;
+#if defined(EWFS_MEDIA_IS_MAPPED)
+    SYS_FS_MEDIA_GEOMETRY *geometry;
+#endif
     
     //leaving the next line in allows for mounting to work
     SYS_CONSOLE_PRINT("disk num: %i\r\n", disk_num);
@@ -192,13 +450,60 @@ int EWFS_Mount (uint8_t disk_num){
         return EWFS_OK;
     }
     ewfs_header.file_count = 0;
+    free(ewfs_long_hash);
+    ewfs_long_hash = NULL;
+#if defined(EWFS_CHECKSUM_ENABLE)
+    ewfs_header.checksums = false;
+    free(ewfs_crc);
+    ewfs_crc = NULL;
+    memset(&ewfs_scrub, 0, sizeof(ewfs_scrub));
+    ewfs_scrub.entry = EWFS_SCRUB_INDEX;
+    ewfs_scrub.last_error = EWFS_INVALID;
+#endif
     //find the base address of the EWFS image
     ewfs_header.base_address = SYS_FS_MEDIA_MANAGER_AddressGet(disk_num);
+#if defined(EWFS_MEDIA_IS_MAPPED)
+    //a memory mapped media (e.g. SQI flash in XIP mode) is read directly
+    ewfs_header.mapped = EWFS_MEDIA_IS_MAPPED(disk_num);
+    if (ewfs_header.mapped){
+        geometry = SYS_FS_MEDIA_MANAGER_GetMediaGeometry(disk_num);
+        if (geometry == NULL){
+            return EWFS_DISK_ERR;
+        }
+        ewfs_header.media_size = geometry->geometryTable[0].blockSize * geometry->geometryTable[0].numBlocks;
+    }
+#endif
     for (index = 0; index < SYS_FS_MAX_FILES; index ++){
         ewfs_file_obj[index].current_position = EWFS_INVALID;
         ewfs_file_obj[index].bytes_remaining = 0;
         ewfs_file_obj[index].size = 0;
+#if defined(EWFS_GEN_CACHE_ENABLE)
+        ewfs_file_obj[index].gen_cache = EWFS_GEN_CACHE_NONE;
+#endif
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+        ewfs_file_obj[index].gen_snapshot = NULL;
+#endif
+#if defined(EWFS_CHECKSUM_ENABLE)
+        ewfs_file_obj[index].verify = EWFS_VERIFY_NONE;
+#endif
     }
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+    memset(ewfs_gen_snapshot_used, 0, sizeof(ewfs_gen_snapshot_used));
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    //outputs of the generators can differ with a new image
+    for (index = 0; index < ewfs_generator_count; index ++){
+        ewfs_generators[index].cache_state = EWFS_GEN_CACHE_EMPTY;
+        ewfs_generators[index].cache_length = 0;
+        ewfs_generators[index].cache_readers = 0;
+    }
+    ewfs_gen_cache_filler = NULL;
+#endif
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+    for (index = 0; index < ewfs_generator_count; index ++){
+        EWFSCheckpointDrop(&ewfs_generators[index]);
+    }
+#endif
     
     //read the EWFS image header
     if (EWFSGetArray(disk_num, 0, 4, (uint8_t *) ewfs_fs_start) == false){
@@ -209,8 +514,12 @@ int EWFS_Mount (uint8_t disk_num){
         ewfs_header.version=0;
         ewfs_header.file_count =0;
         ewfs_header.cachable_index = true;
-        ewfs_header.file_start_address = 7 + 0;
+        ewfs_header.hash_seed = 0;
+        EWFSRehashGenerators();
+        ewfs_header.file_start_address = EWFS_HEADER_SIZE + 0;
         ewfs_header.disk_num = disk_num;
+        EWFS_STATS_ADD(mounts, 1);
+        EWFS_TRACE(EWFS_TRACE_MOUNT, EWFS_TRACE_NO_FILE, 0, 0, ewfs_header.file_start_address);
         return EWFS_OK;
     }
     _APP_SQI_StartCoreTimer(0);
@@ -226,34 +535,82 @@ int EWFS_Mount (uint8_t disk_num){
     if (EWFSGetArray(disk_num, 5, 2, (uint8_t *) &ewfs_header.file_count) == false){
         return EWFS_DISK_ERR;
     }
+    //read the seed the generator chose to keep the path hashes unique
+    index_address = EWFS_HEADER_SIZE;
+    ewfs_header.hash_seed = 0;
+    if (ewfs_header.version >= EWFS_SEED_VERSION){
+        if (EWFSGetArray(disk_num, EWFS_HEADER_SIZE, EWFS_SEED_SIZE, (uint8_t *) &ewfs_header.hash_seed) == false){
+            return EWFS_DISK_ERR;
+        }
+        index_address += EWFS_SEED_SIZE;
+    }
+    //the 32 bit hashes of the paths, then the CRC of each file and of the
+    //header and index follow the index
+    long_hash_size = 0;
+    if (ewfs_header.version >= EWFS_LONG_HASH_VERSION){
+        long_hash_size = EWFS_LONG_HASH_SIZE * ewfs_header.file_count;
+    }
+    checksum_size = 0;
+    if (ewfs_header.version >= EWFS_CHECKSUM_VERSION){
+        checksum_size = (EWFS_CRC_SIZE * ewfs_header.file_count) + EWFS_CRC_SIZE;
+    }
+    //generated files registered for another image are found with this seed
+    EWFSRehashGenerators();
     if (ewfs_header.file_count == 0){
         ewfs_header.cachable_index = true;
         //file_index_byte_count = 0;
-        ewfs_header.file_start_address = 7 + 0;
+        ewfs_header.file_start_address = index_address + checksum_size;
         ewfs_header.disk_num = disk_num;
+        EWFS_STATS_ADD(mounts, 1);
+        EWFS_TRACE(EWFS_TRACE_MOUNT, EWFS_TRACE_NO_FILE, 0, 0, ewfs_header.file_start_address);
         return EWFS_OK;
         //return EWFS_DISK_ERR;
     }
     if (ewfs_index != NULL){
         free (ewfs_index);  //free the memory before reallocating
+        ewfs_index = NULL;
     }
     //force cachable file system index
     ewfs_header.cachable_index = true;
     //file_index_byte_count = sizeof(ewfs_index_t) * ewfs_header.file_count;
-    ewfs_header.file_start_address = 7 + (sizeof(ewfs_index_t) * ewfs_header.file_count);     //get start of file data
+    ewfs_header.file_start_address = index_address + (sizeof(ewfs_index_t) * ewfs_header.file_count) +
+            long_hash_size + checksum_size;     //get start of file data
     SYS_CONSOLE_PRINT("file start address: %i\r\n", ewfs_header.file_start_address);
     _APP_SQI_StartCoreTimer(0);
     _APP_SQI_CoreTimer_Delay(100000);  //1ms
     if (ewfs_header.cachable_index){
         if (ewfs_index != NULL){    //free space if allocated
             free(ewfs_index);
+            ewfs_index = NULL;
         }
         //allocate memory for file index
         ewfs_index = malloc(sizeof(ewfs_index_t) * ewfs_header.file_count);
+        EWFS_MEDIA_ACCESS_HINT(disk_num, index_address, (sizeof(ewfs_index_t) * ewfs_header.file_count), true);
         //read the file index
-        if (EWFSGetArray(disk_num, 7, (sizeof(ewfs_index_t) * ewfs_header.file_count), (uint8_t *) ewfs_index) == false){
+        if (EWFSGetArray(disk_num, index_address, (sizeof(ewfs_index_t) * ewfs_header.file_count), (uint8_t *) ewfs_index) == false){
             return EWFS_DISK_ERR;
         }
+        //paths with the same 16 bit hash are told apart by their 32 bit hash
+        if (long_hash_size > 0){
+            ewfs_long_hash = malloc(long_hash_size);
+            if ((ewfs_long_hash == NULL) || (EWFSGetArray(disk_num,
+                    index_address + (sizeof(ewfs_index_t) * ewfs_header.file_count), long_hash_size,
+                    (uint8_t *) ewfs_long_hash) == false)){
+                free(ewfs_long_hash);
+                ewfs_long_hash = NULL;
+                return EWFS_DISK_ERR;
+            }
+        }
+#if defined(EWFS_CHECKSUM_ENABLE)
+        //a damaged index would send the reads anywhere in the media
+        if (checksum_size > 0){
+            int result = EWFSChecksumLoad(disk_num, index_address);
+            
+            if (result != EWFS_OK){
+                return result;
+            }
+        }
+#endif
         //print the file index to the console
         SYS_CONSOLE_PRINT("hash\tlength\t\toffset=>total offset\ttype\r\n");
         _APP_SQI_StartCoreTimer(0);
@@ -273,6 +630,8 @@ int EWFS_Mount (uint8_t disk_num){
     ewfs_header.disk_num = disk_num;
     //initialize the user custom file generation
     InitGeneratedFiles();
+    EWFS_STATS_ADD(mounts, 1);
+    EWFS_TRACE(EWFS_TRACE_MOUNT, EWFS_TRACE_NO_FILE, 0, 0, ewfs_header.file_start_address);
     
     return EWFS_OK;
 }
@@ -294,9 +653,21 @@ int EWFS_Mount (uint8_t disk_num){
  * bool		returns result from EWFSDiskRead()
  * 
  * NOTES:
+ * When the media is memory mapped the data is copied directly after checking
+ * the read is within the media.
  * 
 ******************************************************************************/
 static bool EWFSGetArray(uint8_t diskNum, uint32_t address, uint32_t length, uint8_t *buffer){
+#if defined(EWFS_MEDIA_IS_MAPPED)
+    if (ewfs_header.mapped){
+        if ((address > ewfs_header.media_size) || (length > (ewfs_header.media_size - address))){
+            return false;
+        }
+        memcpy(buffer, ((uint8_t *)ewfs_header.base_address + address), length);
+        EWFS_STATS_ADD(mapped_reads, 1);
+        return true;
+    }
+#endif
     return EWFSDiskRead (diskNum, buffer, ((uint8_t *)ewfs_header.base_address + address), length);
 }
 
@@ -322,7 +693,9 @@ static bool EWFSGetArray(uint8_t diskNum, uint32_t address, uint32_t length, uin
 SYS_FS_MEDIA_COMMAND_STATUS __attribute__ ((coherent,aligned (16))) commandStatus = SYS_FS_MEDIA_COMMAND_UNKNOWN;
 static bool EWFSDiskRead(uint16_t diskNum, uint8_t *destination, uint8_t *source, const uint32_t nBytes){
     SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE commandHandle  = SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+    EWFS_STATS_START(start);
     
+    EWFS_STATS_ADD(media_commands, 1);
     commandHandle = SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
     commandHandle = SYS_FS_MEDIA_MANAGER_Read (
             diskNum, 
@@ -330,6 +703,7 @@ static bool EWFSDiskRead(uint16_t diskNum, uint8_t *destination, uint8_t *source
             source, 
             nBytes);
     if (commandHandle == SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID){
+        EWFS_STATS_ADD(media_errors, 1);
         return false;
     }
 
@@ -343,14 +717,62 @@ static bool EWFSDiskRead(uint16_t diskNum, uint8_t *destination, uint8_t *source
     
     _APP_SQI_StartCoreTimer(0);
     _APP_SQI_CoreTimer_Delay(200000);  //2ms
+    EWFS_STATS_TIME(media_ticks, start);
    
     if (commandStatus == SYS_FS_MEDIA_COMMAND_COMPLETED){
+        EWFS_STATS_ADD(media_bytes, nBytes);
         return true;
     }else{
+        EWFS_STATS_ADD(media_errors, 1);
         return false;
     }
 }
 
+#if EWFS_MEDIA_PAGE_SIZE > 0
+/******************************************************************************
+ * FUNCTION:  EWFSPageReadLength
+ * 
+ * DESCRIPTION:
+ * Shorten a media transfer of a stored file so it ends on a flash page
+ * boundary.
+ * 
+ * PARAMETERS:
+ * address 		uint32_t	image address the read starts at
+ * btr 			uint32_t	bytes asked for, at most the bytes remaining
+ * remaining 	uint32_t	bytes of the file after the address
+ * 
+ * RETURN VALUE:
+ * uint32_t		bytes to read
+ * 
+ * NOTES:
+ * EWFS_Read transfers the rest of the read from the page boundary on, so
+ * after the first transfer every transfer of the file starts on a page and
+ * crosses no more page boundaries than it has to.  A file the generator
+ * aligned (-a) starts on a page and is read in whole pages from the first
+ * read on.  Reads within a page, the end of the file and mapped media are
+ * not changed.
+ * 
+******************************************************************************/
+static uint32_t EWFSPageReadLength(uint32_t address, uint32_t btr, uint32_t remaining){
+    uint32_t end;
+    
+#if defined(EWFS_MEDIA_IS_MAPPED)
+    if (ewfs_header.mapped){
+        return btr;
+    }
+#endif
+    if (btr == remaining){
+        return btr;
+    }
+    end = (uint32_t) ewfs_header.base_address + address + btr;
+    end &= ~((uint32_t) EWFS_MEDIA_PAGE_SIZE - 1);
+    if (end > ((uint32_t) ewfs_header.base_address + address)){
+        btr = end - ((uint32_t) ewfs_header.base_address + address);
+    }
+    return btr;
+}
+#endif
+
 /******************************************************************************
  * FUNCTION:  EWFS_Unmount
  * 
@@ -374,6 +796,14 @@ int EWFS_Unmount(uint8_t disk_num){
     ewfs_header.file_count = 0;
     ewfs_header.disk_num = EWFS_INVALID_HANDLE;
     free(ewfs_index);
+    ewfs_index = NULL;
+    free(ewfs_long_hash);
+    ewfs_long_hash = NULL;
+#if defined(EWFS_CHECKSUM_ENABLE)
+    ewfs_header.checksums = false;
+    free(ewfs_crc);
+    ewfs_crc = NULL;
+#endif
     
     return EWFS_OK;
 }
@@ -390,7 +820,8 @@ int EWFS_Unmount(uint8_t disk_num){
  * PARAMETERS:
  * handle 			uintptr_t	pointer to file system file handle
  * filewithDisk		char *		full file path
- * mode				uint8_t		mode attribute of how to open file
+ * mode				uint8_t		mode attribute of how to open file, not used as
+ *								the file system is read only
  * 
  * RETURN VALUE:
  * int 		returns EWFS_OK if successful.
@@ -400,9 +831,13 @@ int EWFS_Unmount(uint8_t disk_num){
 ******************************************************************************/
 int EWFS_Open(uintptr_t handle, const char *filewithDisk, uint8_t mode){
     volatile uint32_t index = 0;
-    volatile uint32_t found_file;
+    volatile int32_t found_file;
     uint8_t disk_num = 0;
+    uint16_t hash = 0;
+    uint32_t address;
+    EWFS_STATS_START(start);
     
+    (void) mode;    //the file system is read only
     disk_num = filewithDisk[0] - '0';
     
     if ((disk_num > SYS_FS_VOLUME_NUMBER) || (disk_num != ewfs_header.disk_num)){
@@ -414,40 +849,107 @@ int EWFS_Open(uintptr_t handle, const char *filewithDisk, uint8_t mode){
             break;
         }
     }
-    if (index > SYS_FS_MAX_FILES){  //check if the index is valid
+    if (index >= SYS_FS_MAX_FILES){  //no free file object
         return EWFS_INVALID_PARAMETER;
     }
-    found_file = EWFSFindFile(disk_num, (uint8_t *) (filewithDisk + 3));
+    found_file = EWFSFindFile((uint8_t *) (filewithDisk + 3), &hash);
+    if ((found_file >= 0) && (ewfs_index[found_file].type == TYPE_GENERATED)){
+        //a generated file needs a registered generator
+        ewfs_file_obj[index].generator = EWFSFindGenerator(filewithDisk + 3);
+        if (ewfs_file_obj[index].generator == NULL){
+            found_file = -1;
+        }
+    }
     if (found_file >= 0){
         ewfs_file_obj[index].bytes_remaining = ewfs_index[found_file].length - 1;   //-1 because file size includes 0 at end of file
         ewfs_file_obj[index].current_position = ewfs_index[found_file].offset + ewfs_header.file_start_address;
         ewfs_file_obj[index].size= ewfs_file_obj[index].bytes_remaining;
         ewfs_file_obj[index].type = ewfs_index[found_file].type;
+        ewfs_file_obj[index].gen_hash = hash;
+#if defined(EWFS_CHECKSUM_ENABLE)
+        //stored files are checked as they are read from the start
+        ewfs_file_obj[index].verify = EWFS_VERIFY_NONE;
+        ewfs_file_obj[index].crc = EWFS_CRC_START;
+        ewfs_file_obj[index].crc_next = 0;
+        if (ewfs_header.checksums && (ewfs_file_obj[index].type == TYPE_FILE) &&
+                (ewfs_file_obj[index].size > 0)){
+            ewfs_file_obj[index].verify = EWFS_VERIFY_PENDING;
+            ewfs_file_obj[index].crc_expected = ewfs_crc[found_file];
+        }
+#endif
         //update handles
         ewfs_file_obj[index].handle = EWFS_MAKE_HANDLE(ewfs_handle_token, disk_num, index);
         EWFS_UPDATE_HANDLE_TOKEN(ewfs_handle_token);
         *(uintptr_t *) handle = ewfs_file_obj[index].handle;
         if (ewfs_file_obj[index].type == TYPE_GENERATED){
-            ewfs_file_obj[index].gen_hash = ewfs_index[found_file].hash;
-            ewfs_file_obj[index].gen_index = 0; //starting at first index
-            ewfs_file_obj[index].size = GenerateFileSize(ewfs_index[found_file].hash); 
+            memset(ewfs_file_obj[index].gen_state, 0, sizeof(ewfs_file_obj[index].gen_state));
+            ewfs_file_obj[index].gen_position = 0;
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+            ewfs_file_obj[index].gen_snapshot = NULL;
+            if (ewfs_file_obj[index].generator->snapshot != NULL){
+                ewfs_file_obj[index].gen_snapshot = EWFSSnapshotReserve();
+                if (ewfs_file_obj[index].gen_snapshot == NULL){
+                    //all snapshot buffers are used by open files
+                    ewfs_file_obj[index].handle = EWFS_INVALID_HANDLE;
+                    ewfs_file_obj[index].current_position = EWFS_INVALID;
+                    ewfs_file_obj[index].generator = NULL;
+                    return EWFS_INVALID_PARAMETER;
+                }
+            }
+#endif
+            ewfs_file_obj[index].size = EWFSGeneratedSize(&ewfs_file_obj[index]);
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+            if (ewfs_file_obj[index].gen_snapshot != NULL){
+#if defined(EWFS_GEN_CACHE_ENABLE)
+                if (ewfs_file_obj[index].gen_cache == EWFS_GEN_CACHE_SERVE){
+                    //the stored output is read instead
+                    EWFSSnapshotRelease(&ewfs_file_obj[index]);
+                }else
+#endif
+                {
+                    ewfs_file_obj[index].generator->snapshot(ewfs_file_obj[index].generator->context,
+                            ewfs_file_obj[index].gen_snapshot);
+                }
+            }
+#endif
             ewfs_file_obj[index].bytes_remaining = ewfs_file_obj[index].size;
             ewfs_file_obj[index].current_position = 0;
-            ewfs_file_obj[index].gen_offset = 0;
+            address = EWFS_INVALID;
             /*SYS_CONSOLE_PRINT("***OPEN hash: %04X\ttype: generated\tname: %s\tlength: %X\toffset: %X***\r\n",
                     ewfs_index[found_file].hash,
                     (filewithDisk + 3),
                     ewfs_file_obj[index].bytes_remaining,
                     ewfs_file_obj[index].current_position);*/
+        }else if (ewfs_file_obj[index].type == TYPE_TEMPLATE){
+            //static data is read from the media, the variables are generated
+            address = ewfs_file_obj[index].current_position;
+            ewfs_file_obj[index].tpl_table = address;
+            if (EWFSTemplateStart(disk_num, &ewfs_file_obj[index]) == false){
+                ewfs_file_obj[index].handle = EWFS_INVALID_HANDLE;
+                ewfs_file_obj[index].current_position = EWFS_INVALID;
+                return EWFS_DISK_ERR;
+            }
+            ewfs_file_obj[index].size = EWFS_SIZE_UNKNOWN;
+            ewfs_file_obj[index].bytes_remaining = EWFS_SIZE_UNKNOWN;
+            ewfs_file_obj[index].current_position = 0;
         }else{  // file type = file
+            address = ewfs_file_obj[index].current_position;
+            EWFS_MEDIA_ACCESS_HINT(disk_num, ewfs_file_obj[index].current_position,
+                    ewfs_file_obj[index].size, true);
             /*SYS_CONSOLE_PRINT("***OPEN hash: %04X\ttype: file\tname: %s\tlength: %X\toffset: %X***\r\n",
                     ewfs_index[found_file].hash,
                     (filewithDisk + 3),
                     ewfs_file_obj[index].bytes_remaining,
                     ewfs_file_obj[index].current_position);*/
         }
+        EWFS_STATS_ADD(opens, 1);
+        EWFS_STATS_TIME(open_ticks, start);
+        EWFS_TRACE(EWFS_TRACE_OPEN, index, hash, address, ewfs_file_obj[index].size);
         return EWFS_OK;        
     }
+    EWFS_STATS_ADD(open_misses, 1);
+    EWFS_STATS_TIME(open_ticks, start);
+    EWFS_TRACE(EWFS_TRACE_OPEN_MISS, EWFS_TRACE_NO_FILE, hash, 0, 0);
     return EWFS_NO_FILE;
 }
 
@@ -460,35 +962,44 @@ int EWFS_Open(uintptr_t handle, const char *filewithDisk, uint8_t mode){
  * record with the file information.
  * 
  * PARAMETERS:
- * diskNum 		uint8_t		disk number
- * destination	uint8_t *	pointer to the buffer to read the data to
- * source 		uint8_t *	the starting address of data to read
- * nBytes 		uint32_t	the number of bytes to read
+ * file 		uint8_t *	file path without the disk prefix
+ * file_hash 	uint16_t *	returns the hash of the file path
  * 
  * RETURN VALUE:
- * int 		returns true if successful, otherwise false
+ * int 		returns the index of the file, otherwise -1
  * 
  * NOTES:
  * Current implementation assumes that the file system index is cachable,
- * otherwise additional file system reading will need to happen.
+ * otherwise additional file system reading will need to happen.  When the
+ * image has 32 bit hashes an entry with the same 16 bit hash is only the file
+ * if its 32 bit hash matches too, the 32 bit hash is calculated at the first
+ * such entry.
  * 
 ******************************************************************************/
-static int EWFSFindFile(uint8_t disk_num, uint8_t *file){
-    uint8_t *ptr;
+static int EWFSFindFile(uint8_t *file, uint16_t *file_hash){
     volatile uint16_t hash = 0;
     volatile uint32_t index = 0;
+    uint32_t long_hash = 0;
+    bool long_hash_known = false;
     
     //calculate the hash of the file name
-    ptr = file;
-    while (*ptr != '\0'){
-        hash <<=1;
-        hash += *ptr ++;
-    }
+    hash = EWFSHash(file, ewfs_header.hash_seed);
+    *file_hash = hash;
     if (!ewfs_header.cachable_index){
         return -1;
     }
     for (index = 0; index < ewfs_header.file_count; index ++){
-        if (ewfs_index[index].hash == hash){
+        if (ewfs_index[index].hash != hash){
+            continue;
+        }
+        if (ewfs_long_hash == NULL){
+            return index;
+        }
+        if (!long_hash_known){
+            long_hash = EWFSLongHash(file, ewfs_header.hash_seed);
+            long_hash_known = true;
+        }
+        if (ewfs_long_hash[index] == long_hash){
             return index;
         }
     }
@@ -496,217 +1007,2145 @@ static int EWFSFindFile(uint8_t disk_num, uint8_t *file){
 }
 
 /******************************************************************************
- * FUNCTION NAME:  EWFS_Read
- *
- * FUNCTION DESCRIPTION:
- * Read the file data from flash if it is a file type.  If it is a generated
- * file, call the GenerateFileRead function to generate file data.
- *
- * FUNCTION PARAMETERS:
- * handle   uintptr_t   The handle to the file that will be read.
- * buffer   void *      Pointer to the buffer where the data that is read is 
- *                      stored to for calling function to use.
- * btr      uint32_t    The size of data to put in the buffer. Bytes To Read
- * br       uint32_t *  A pointer to the number of bytes read from the file. 
- *                      Bytes Read
- *
- * FUNCTION RETURN VALUE:
- * EWFS_OK  The file was read.
- *
- * FUNCTION NOTES:  None.
- *
- *****************************************************************************/
-int EWFS_Read(uintptr_t handle, void* buffer, uint32_t btr, uint32_t *br){
-    uint16_t index = 0;
-    uint8_t disk_num = 0;
+ * FUNCTION:  EWFSHash
+ * 
+ * DESCRIPTION:
+ * Calculate the hash of a file path the same way the image generator does.
+ * 
+ * PARAMETERS:
+ * path 		const uint8_t *		file path without the disk prefix
+ * seed 		uint16_t			seed from the image header, 0 for the
+ * 									original hash
+ * 
+ * RETURN VALUE:
+ * uint16_t		hash of the path
+ * 
+ * NOTES:
+ * The generator only picks a seed when two paths of the image have the same
+ * original hash.  A seeded hash is the 32 bit hash of EWFSLongHash folded to
+ * 16 bits, so every seed gives a different set of hashes.
+ * 
+******************************************************************************/
+static uint16_t EWFSHash(const uint8_t *path, uint16_t seed){
+    uint16_t hash = 0;
+    uint32_t seeded;
     
-    *br = 0;
-    index = handle & 0xFFFF;
-    if (index > SYS_FS_MAX_FILES){
-        return EWFS_INVALID_PARAMETER;
+    if (seed == 0){
+        while (*path != '\0'){
+            hash <<=1;
+            hash += *path ++;
+        }
+        return hash;
     }
-    //extract the disk number from the handle
-    disk_num = ((handle >> 16) * 0xFF);
-    //find the number of bytes to read is greater then the number of remaining bytes
-    if (btr > ewfs_file_obj[index].bytes_remaining){
-        btr = ewfs_file_obj[index].bytes_remaining;
+    seeded = EWFSLongHash(path, seed);
+    return (uint16_t) (seeded ^ (seeded >> 16));
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSLongHash
+ * 
+ * DESCRIPTION:
+ * Calculate the 32 bit hash of a file path the same way the image generator
+ * does.
+ * 
+ * PARAMETERS:
+ * path 		const uint8_t *		file path without the disk prefix
+ * seed 		uint16_t			seed from the image header
+ * 
+ * RETURN VALUE:
+ * uint32_t		hash of the path
+ * 
+ * NOTES:
+ * A 32 bit FNV-1a started from 0x811c9dc5 XOR the seed.  Version 4 images
+ * store it for each path when no seed makes the 16 bit hashes unique.
+ * 
+******************************************************************************/
+static uint32_t EWFSLongHash(const uint8_t *path, uint16_t seed){
+    uint32_t hash = 0x811c9dc5u ^ seed;
+    
+    while (*path != '\0'){
+        hash ^= *path ++;
+        hash *= 0x01000193u;
     }
-    //check that the buffer needs data
-    if (btr > 0){
-        /*SYS_CONSOLE_PRINT("***READ current position: %X\tbytes remaining: %X***\r\n", 
-                ewfs_file_obj[index].current_position,
-                ewfs_file_obj[index].bytes_remaining);
-        _APP_SQI_StartCoreTimer(0);
-        _APP_SQI_CoreTimer_Delay(500000);  //5ms */
-        if (ewfs_file_obj[index].type == TYPE_GENERATED){    //check if the file is generated
-            GenerateFileRead(ewfs_file_obj[index].gen_hash, buffer, btr, br,
-                    &ewfs_file_obj[index].gen_index, &ewfs_file_obj[index].gen_offset);
-            ewfs_file_obj[index].current_position += *br;
-            ewfs_file_obj[index].bytes_remaining -= *br;
-        }else{  //else its a file
-            if (EWFSGetArray(disk_num, ewfs_file_obj[index].current_position, btr, buffer) == true){
-                *br = btr;
-                //update the current address offset and the bytes remaining offset
-                ewfs_file_obj[index].current_position += *br;
-                ewfs_file_obj[index].bytes_remaining -= *br;
-            }
-        }
-        /*SYS_CONSOLE_PRINT("***READ current position: %X\tbytes remaining: %X***\r\n", 
-                ewfs_file_obj[index].current_position,
-                ewfs_file_obj[index].bytes_remaining);
-        _APP_SQI_StartCoreTimer(0);
-        _APP_SQI_CoreTimer_Delay(500000);  //5ms */
+    return hash;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSRehashGenerators
+ * 
+ * DESCRIPTION:
+ * Hash the paths of the registered generated files with the seed of the
+ * image being mounted.
+ * 
+ * PARAMETERS:
+ * none
+ * 
+ * RETURN VALUE:
+ * none
+ * 
+ * NOTES:
+ * Files registered before a mount, or for an image with another seed, are
+ * still found after the mount.
+ * 
+******************************************************************************/
+static void EWFSRehashGenerators(void){
+    uint32_t index;
+    
+    for (index = 0; index < ewfs_generator_count; index ++){
+        ewfs_generators[index].hash = EWFSHash((const uint8_t *) ewfs_generators[index].path,
+                ewfs_header.hash_seed);
     }
-    return EWFS_OK;
 }
 
 /******************************************************************************
- * FUNCTION:  EWFS_Close
+ * FUNCTION:  EWFS_RegisterGeneratedFile
  * 
  * DESCRIPTION:
- * Close the file and free the file pointer handle.
+ * Register the callbacks that generate a file listed as generated in the
+ * image.
  * 
  * PARAMETERS:
- * handle 	uintptr_t	pointer to file handle
+ * path 		const char *		file path without the disk prefix, as listed
+ * 									in ewfslist.txt (e.g. "largefile.json")
+ * size 		ewfs_gen_size_t		returns the size of the file, NULL if the size
+ * 									is not known before the file is generated
+ * read 		ewfs_gen_read_t		generates the file data
+ * context 		void *				passed to the callbacks
+ * flags 		uint8_t				EWFS_GEN_STABLE_SIZE if the size doesn't
+ * 									change, otherwise 0
  * 
  * RETURN VALUE:
  * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
  * 
  * NOTES:
+ * Registering a path again with other callbacks replaces them and removes
+ * its snapshot callback, cached output and checkpoints.  With the same read
+ * callback and context (InitGeneratedFiles() runs at every mount) they are
+ * kept, with the time to live of the cache, and only the size function and
+ * flags are updated.  The path is kept, so it must stay valid while the file is
+ * registered (e.g. a string literal).  The callbacks are looked
+ * up once when the file is opened.  Without a size function the file size is
+ * EWFS_SIZE_UNKNOWN until the generator returns 0, so the file can be sent
+ * with chunked transfer encoding without generating it twice.
  * 
 ******************************************************************************/
-int EWFS_Close(uintptr_t handle){
-    uint16_t index = 0;
+int EWFS_RegisterGeneratedFile(const char *path, ewfs_gen_size_t size, ewfs_gen_read_t read,
+        void *context, uint8_t flags){
+    uint16_t hash;
+    uint32_t index;
     
-    index = handle & 0xFFFF;
-    if (index > SYS_FS_MAX_FILES){
+    if ((path == NULL) || (read == NULL)){
         return EWFS_INVALID_PARAMETER;
     }
-    ewfs_file_obj[index].handle = EWFS_INVALID_HANDLE;
-    ewfs_file_obj[index].current_position = EWFS_INVALID;
-    ewfs_file_obj[index].bytes_remaining = 0;
-    ewfs_file_obj[index].size = 0;
-    ewfs_file_obj[index].gen_hash = 0;
-    ewfs_file_obj[index].gen_index = 0;
-    ewfs_file_obj[index].gen_offset = 0;
-    /*SYS_CONSOLE_PRINT("CLOSE\r\n");*/
+    hash = EWFSHash((const uint8_t *) path, ewfs_header.hash_seed);
+    //paths with the same hash are different files
+    for (index = 0; index < ewfs_generator_count; index ++){
+        if (strcmp(ewfs_generators[index].path, path) == 0){
+            break;
+        }
+    }
+    if (index == EWFS_GENERATED_FILES_MAX){
+        return EWFS_INVALID_PARAMETER;
+    }
+    if ((index < ewfs_generator_count) && (ewfs_generators[index].read == read) &&
+            (ewfs_generators[index].context == context)){
+        //same generator registered again, keep its snapshot, cache and checkpoints
+        if ((ewfs_generators[index].size != size) || (ewfs_generators[index].flags != flags)){
+            ewfs_generators[index].cached_size = EWFS_SIZE_UNKNOWN;
+        }
+        ewfs_generators[index].hash = hash;
+        ewfs_generators[index].size = size;
+        ewfs_generators[index].flags = flags;
+        return EWFS_OK;
+    }
+    if (index == ewfs_generator_count){
+        ewfs_generator_count ++;
+    }
+    ewfs_generators[index].hash = hash;
+    ewfs_generators[index].path = path;
+    ewfs_generators[index].size = size;
+    ewfs_generators[index].read = read;
+    ewfs_generators[index].context = context;
+    ewfs_generators[index].flags = flags;
+    ewfs_generators[index].cached_size = EWFS_SIZE_UNKNOWN;
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+    ewfs_generators[index].snapshot = NULL;
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    //the output of the old callbacks is not used again, the time to live is kept
+    EWFSGenCacheDrop(&ewfs_generators[index]);
+#endif
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+    EWFSCheckpointDrop(&ewfs_generators[index]);
+#endif
     return EWFS_OK;
-    
 }
 
 /******************************************************************************
- * FUNCTION:  EWFS_GetSize
+ * FUNCTION:  EWFSFindGenerator
  * 
  * DESCRIPTION:
- * Return the size of the file associated with the file handle.
+ * Find the registered callbacks of a generated file.
  * 
  * PARAMETERS:
- * handle 	uintptr_t	pointer to file handle
+ * path 		const char *	file path without the disk prefix
  * 
  * RETURN VALUE:
- * int 		returns the size of the file, 0 if not valid
+ * ewfs_generator_t *		the generator, NULL if none is registered
  * 
  * NOTES:
+ * The hash is compared first, the path only when the hash matches.
  * 
 ******************************************************************************/
-uint32_t EWFS_GetSize(uintptr_t handle){
-    uint16_t index = 0;
+static ewfs_generator_t *EWFSFindGenerator(const char *path){
+    uint16_t hash = EWFSHash((const uint8_t *) path, ewfs_header.hash_seed);
+    uint32_t index;
     
-    if (EWFSIsHandleValid(handle) == false){
-        return 0;   //invalid handle
+    for (index = 0; index < ewfs_generator_count; index ++){
+        if ((ewfs_generators[index].hash == hash) && (strcmp(ewfs_generators[index].path, path) == 0)){
+            return &ewfs_generators[index];
+        }
     }
-    index = handle & 0xFFFF;
-    return ewfs_file_obj[index].size;
+    return NULL;
 }
 
 /******************************************************************************
- * FUNCTION:  EWFSIsHandleValid
+ * FUNCTION:  EWFSGeneratedSize
  * 
  * DESCRIPTION:
- * Determine if the file handle is valid.
+ * Get the size of a generated file when it is opened.
  * 
  * PARAMETERS:
- * handle 	uint32_t	file handle
+ * file_obj 	ewfs_file_obj_t *	generated file being opened
  * 
  * RETURN VALUE:
- * bool		true if handle is valid, otherwise false
+ * uint32_t		size of the file, EWFS_SIZE_UNKNOWN if it is streamed
  * 
  * NOTES:
+ * A stable size is only asked for once, or learned from the first complete
+ * read of a streamed file.  Output served from the cache has the size of
+ * the stored output.
  * 
 ******************************************************************************/
-static bool EWFSIsHandleValid(uint32_t handle){
-    uint16_t index = handle & 0xFFFF;
-    if (index > SYS_FS_MAX_FILES){
-        return false;
+static uint32_t EWFSGeneratedSize(ewfs_file_obj_t *file_obj){
+    ewfs_generator_t *generator = file_obj->generator;
+    uint32_t size;
+    
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    if (EWFSGenCacheOpen(file_obj) == true){
+        return generator->cache_length;
     }
-    if (ewfs_file_obj[index].handle != handle){
-        return false;
+#endif
+    if (generator->cached_size != EWFS_SIZE_UNKNOWN){
+        return generator->cached_size;
     }
-    return true;
+    if (generator->size == NULL){
+        return EWFS_SIZE_UNKNOWN;
+    }
+    size = generator->size(generator->context);
+    if ((generator->flags & EWFS_GEN_STABLE_SIZE) != 0){
+        generator->cached_size = size;
+    }
+    return size;
 }
 
 /******************************************************************************
- * FUNCTION:  EWFS_GetPosition
+ * FUNCTION:  EWFSGeneratedRead
  * 
  * DESCRIPTION:
- * This function returns the current position within the file being read.
+ * Read the next part of a generated file from its generator.
  * 
  * PARAMETERS:
- * handle 		uintptr_t	file handle
+ * file_obj 	ewfs_file_obj_t *	open generated file
+ * buffer 		uint8_t *			buffer for the data
+ * btr 			uint32_t			size of the buffer
  * 
  * RETURN VALUE:
- * uint32_t		current position within the file
+ * uint32_t		number of bytes put in the buffer
  * 
  * NOTES:
+ * The generator continues from the state kept in the file object.
  * 
 ******************************************************************************/
-uint32_t EWFS_GetPosition(uintptr_t handle){
-    uint16_t index;
-    if (EWFSIsHandleValid(handle) == false){
-        return 0;   //invalid handle
+static uint32_t EWFSGeneratedRead(ewfs_file_obj_t *file_obj, uint8_t *buffer, uint32_t btr){
+    uint32_t bytes_read;
+    
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    if (file_obj->gen_cache == EWFS_GEN_CACHE_SERVE){
+        //btr is limited to the bytes remaining in the stored output
+        memcpy(buffer, &ewfs_gen_cache[file_obj->generator->cache_offset + file_obj->current_position],
+                btr);
+        return btr;
     }
+#endif
+    bytes_read = file_obj->generator->read(file_obj->generator->context, file_obj->gen_state,
+            btr, buffer);
+    file_obj->gen_position += bytes_read;
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    if (file_obj->gen_cache == EWFS_GEN_CACHE_FILL){
+        //the output ends at the end of the file or when the generator is done
+        EWFSGenCacheStore(file_obj, buffer, bytes_read,
+                (bytes_read == 0) || (bytes_read == file_obj->bytes_remaining));
+    }
+#endif
+    return bytes_read;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSGeneratedSkip
+ * 
+ * DESCRIPTION:
+ * Generate the next part of a generated file without keeping it.
+ * 
+ * PARAMETERS:
+ * file_obj 	ewfs_file_obj_t *	open generated file
+ * length 		uint32_t			bytes to skip
+ * 
+ * RETURN VALUE:
+ * uint32_t		number of bytes skipped, less than length at the end of the file
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static uint32_t EWFSGeneratedSkip(ewfs_file_obj_t *file_obj, uint32_t length){
+    uint32_t skipped = 0;
+    uint32_t bytes_read;
     
-    index = handle & 0xFFFF;
-    return (uint32_t) (ewfs_file_obj[index].current_position);
+    while (skipped < length){
+        bytes_read = file_obj->generator->read(file_obj->generator->context, file_obj->gen_state,
+                (length - skipped < sizeof(ewfs_skip)) ? length - skipped : sizeof(ewfs_skip),
+                ewfs_skip);
+        if (bytes_read == 0){
+            break;
+        }
+        file_obj->gen_position += bytes_read;
+        skipped += bytes_read;
+    }
+    return skipped;
 }
 
 /******************************************************************************
- * FUNCTION:  EWFS_Seek
+ * FUNCTION:  EWFSGeneratedRestart
  * 
  * DESCRIPTION:
- * Update the file object position for reading to allow for adjustments of 
- * file reading position.
+ * Move the generator of an open file to a position before generating from
+ * there.
  * 
  * PARAMETERS:
- * handle 		uintptr_t		file handle
- * dwOffset		uint32_t		offset to current file position to apply
+ * file_obj 	ewfs_file_obj_t *	open generated file
+ * position 	uint32_t			position the next read starts at
  * 
  * RETURN VALUE:
- * int 		returns 0 if successful, otherwise 1
+ * none
  * 
  * NOTES:
+ * The generator continues from the last checkpoint before the position, or
+ * from the start of the file.  A forward seek continues from the current
+ * state when no checkpoint is closer.  The data up to the position is
+ * generated again and dropped by EWFSGeneratedSkip().
  * 
 ******************************************************************************/
-//returns 0 when successful, otherwise 1.
-int EWFS_Seek(uintptr_t handle, uint32_t dwOffset){
-    uint16_t index = 0;
-    if (EWFSIsHandleValid(handle) == false){
-        return 1;   //invalid handle
+static void EWFSGeneratedRestart(ewfs_file_obj_t *file_obj, uint32_t position){
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+    ewfs_generator_t *generator = file_obj->generator;
+    uint32_t index = generator->checkpoint_count;
+    
+    while ((index > 0) && (generator->checkpoints[index - 1].offset > position)){
+        index --;
     }
-    index = handle & 0xFFFF;
-    if (labs(dwOffset) > ewfs_file_obj[index].size){
-        return 1;
+    if ((index > 0) && ((position < file_obj->gen_position) ||
+            (generator->checkpoints[index - 1].offset > file_obj->gen_position))){
+        memcpy(file_obj->gen_state, generator->checkpoints[index - 1].state,
+                sizeof(file_obj->gen_state));
+        file_obj->gen_position = generator->checkpoints[index - 1].offset;
+        return;
     }
-    if (ewfs_file_obj[index].type == TYPE_GENERATED){    //check if the file is generated
-        ewfs_file_obj[index].gen_index--;
-        ewfs_file_obj[index].gen_offset = -dwOffset;
-        ewfs_file_obj[index].current_position = ewfs_file_obj[index].current_position + dwOffset;
-        ewfs_file_obj[index].bytes_remaining = ewfs_file_obj[index].bytes_remaining - dwOffset;
-    }else{
-        ewfs_file_obj[index].current_position = ewfs_file_obj[index].current_position + dwOffset;
-        ewfs_file_obj[index].bytes_remaining = ewfs_file_obj[index].bytes_remaining - dwOffset;
+#endif
+    if (position < file_obj->gen_position){
+        memset(file_obj->gen_state, 0, sizeof(file_obj->gen_state));
+        file_obj->gen_position = 0;
     }
-
-    return 0;
 }
 
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE) || defined(EWFS_GEN_SNAPSHOT_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFSFindGeneratorState
+ * 
+ * DESCRIPTION:
+ * Find the open file of a generator state.
+ * 
+ * PARAMETERS:
+ * state 		const void *	state passed to the read callback
+ * 
+ * RETURN VALUE:
+ * ewfs_file_obj_t *	the open file, NULL if the state is not of an open file
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static ewfs_file_obj_t *EWFSFindGeneratorState(const void *state){
+    uint32_t index;
+    
+    for (index = 0; index < SYS_FS_MAX_FILES; index ++){
+        if (state == ewfs_file_obj[index].gen_state){
+            return &ewfs_file_obj[index];
+        }
+    }
+    return NULL;
+}
+#endif
+
+/******************************************************************************
+ * FUNCTION:  EWFS_GeneratedCheckpoint
+ * 
+ * DESCRIPTION:
+ * Publish the state of a generator so a later seek in the file continues
+ * from it instead of generating the file from the start.
+ * 
+ * PARAMETERS:
+ * state 		void *		state passed to the read callback
+ * length 		uint32_t	bytes put in the buffer by this call before the
+ * 							point the state continues from
+ * 
+ * RETURN VALUE:
+ * none
+ * 
+ * NOTES:
+ * Called from the read callback of a generated file, with the state updated
+ * to continue after the first length bytes of this call, e.g. at the start of
+ * each line or record.  The state must not refer to the open file and the
+ * output must be the same on every read until the file is invalidated or
+ * registered again.  Checkpoints are only kept at increasing offsets, when
+ * all EWFS_GEN_CHECKPOINTS are used every second one is dropped and the
+ * spacing doubles.  Does nothing without EWFS_GEN_CHECKPOINTS or for a file
+ * generated from a snapshot.
+ * 
+******************************************************************************/
+void EWFS_GeneratedCheckpoint(void *state, uint32_t length){
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+    ewfs_file_obj_t *file_obj = EWFSFindGeneratorState(state);
+    ewfs_generator_t *generator;
+    ewfs_gen_checkpoint_t *last;
+    uint32_t offset;
+    uint32_t index;
+    
+    if ((file_obj == NULL) || (file_obj->generator == NULL)){
+        return;
+    }
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+    if (file_obj->gen_snapshot != NULL){
+        return;     //the output of the next open is generated from another snapshot
+    }
+#endif
+    generator = file_obj->generator;
+    offset = file_obj->gen_position + length;
+    last = (generator->checkpoint_count > 0) ?
+            &generator->checkpoints[generator->checkpoint_count - 1] : NULL;
+    if ((offset == 0) || ((last != NULL) && (offset <= last->offset)) ||
+            (offset - ((last != NULL) ? last->offset : 0) < generator->checkpoint_spacing)){
+        return;
+    }
+    if (generator->checkpoint_count == EWFS_GEN_CHECKPOINTS){
+        //keep every second checkpoint
+        for (index = 1; index < EWFS_GEN_CHECKPOINTS; index += 2){
+            generator->checkpoints[index / 2] = generator->checkpoints[index];
+        }
+        generator->checkpoint_count = EWFS_GEN_CHECKPOINTS / 2;
+        last = &generator->checkpoints[generator->checkpoint_count - 1];
+        generator->checkpoint_spacing = last->offset / generator->checkpoint_count;
+        if (offset - last->offset < generator->checkpoint_spacing){
+            return;
+        }
+    }
+    generator->checkpoints[generator->checkpoint_count].offset = offset;
+    memcpy(generator->checkpoints[generator->checkpoint_count].state, state,
+            sizeof(generator->checkpoints[0].state));
+    generator->checkpoint_count ++;
+#else
+    (void) state;
+    (void) length;
+#endif
+}
+
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFSCheckpointDrop
+ * 
+ * DESCRIPTION:
+ * Drop the checkpoints of a generated file.
+ * 
+ * PARAMETERS:
+ * generator 	ewfs_generator_t *	generator of the file
+ * 
+ * RETURN VALUE:
+ * none
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static void EWFSCheckpointDrop(ewfs_generator_t *generator){
+    generator->checkpoint_count = 0;
+    generator->checkpoint_spacing = 0;
+}
+#endif
+
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFS_SetGeneratedFileSnapshot
+ * 
+ * DESCRIPTION:
+ * Generate a file from a snapshot of its live data taken when the file is
+ * opened.
+ * 
+ * PARAMETERS:
+ * path 		const char *		registered path of the generated file
+ * snapshot 	ewfs_gen_snapshot_t	copies the live data into the snapshot
+ * 									buffer, NULL to generate from the live data
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
+ * 
+ * NOTES:
+ * The snapshot callback is the only place the live data is read, so only it
+ * has to lock the data or disable the interrupts that update it.  The read
+ * callback gets the snapshot with EWFS_GeneratedSnapshot() and every read of
+ * the open file, including after a seek, is generated from the same
+ * snapshot.  Opening the file fails when all EWFS_GEN_SNAPSHOTS buffers are
+ * used.  The size callback is called after the snapshot is taken, streamed
+ * files don't need one.
+ * 
+******************************************************************************/
+int EWFS_SetGeneratedFileSnapshot(const char *path, ewfs_gen_snapshot_t snapshot){
+    ewfs_generator_t *generator;
+    
+    if (path == NULL){
+        return EWFS_INVALID_PARAMETER;
+    }
+    generator = EWFSFindGenerator(path);
+    if (generator == NULL){
+        return EWFS_INVALID_PARAMETER;
+    }
+    generator->snapshot = snapshot;
+    return EWFS_OK;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_GeneratedSnapshot
+ * 
+ * DESCRIPTION:
+ * Get the snapshot an open generated file is generated from.
+ * 
+ * PARAMETERS:
+ * state 		void *		state passed to the read callback
+ * 
+ * RETURN VALUE:
+ * const void *		the snapshot, NULL if the file has none
+ * 
+ * NOTES:
+ * Called from the read callback of a generated file.
+ * 
+******************************************************************************/
+const void *EWFS_GeneratedSnapshot(void *state){
+    ewfs_file_obj_t *file_obj = EWFSFindGeneratorState(state);
+    
+    if (file_obj == NULL){
+        return NULL;
+    }
+    return file_obj->gen_snapshot;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSSnapshotReserve
+ * 
+ * DESCRIPTION:
+ * Take a free snapshot buffer.
+ * 
+ * PARAMETERS:
+ * none
+ * 
+ * RETURN VALUE:
+ * uint32_t *	the snapshot buffer, NULL if all are used
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static uint32_t *EWFSSnapshotReserve(void){
+    uint32_t index;
+    
+    for (index = 0; index < EWFS_GEN_SNAPSHOTS; index ++){
+        if (ewfs_gen_snapshot_used[index] == false){
+            ewfs_gen_snapshot_used[index] = true;
+            return ewfs_gen_snapshots[index];
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSSnapshotRelease
+ * 
+ * DESCRIPTION:
+ * Free the snapshot buffer of a file.
+ * 
+ * PARAMETERS:
+ * file_obj 	ewfs_file_obj_t *	file with a snapshot or without one
+ * 
+ * RETURN VALUE:
+ * none
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static void EWFSSnapshotRelease(ewfs_file_obj_t *file_obj){
+    if (file_obj->gen_snapshot != NULL){
+        ewfs_gen_snapshot_used[(file_obj->gen_snapshot - ewfs_gen_snapshots[0]) /
+                (EWFS_GEN_SNAPSHOT_SIZE / sizeof(uint32_t))] = false;
+        file_obj->gen_snapshot = NULL;
+    }
+}
+#endif
+
+/******************************************************************************
+ * FUNCTION:  EWFS_RegisterTemplateVariable
+ * 
+ * DESCRIPTION:
+ * Register the callback that generates a variable of the template files.
+ * 
+ * PARAMETERS:
+ * name 		const char *		variable name, as written between the markers
+ * 									in the templates (e.g. "counter" for ~counter~)
+ * read 		ewfs_var_read_t		generates the value
+ * context 		void *				passed to the callback
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
+ * 
+ * NOTES:
+ * Registering a name again replaces its callback.  A variable without a
+ * registered callback is left out of the file.  The name is kept, so it must
+ * stay valid while the variable is registered (e.g. a string literal).  The
+ * templates store the names of their variables, a variable is found by name
+ * when a template reads it.
+ * 
+******************************************************************************/
+int EWFS_RegisterTemplateVariable(const char *name, ewfs_var_read_t read, void *context){
+    uint32_t index;
+    
+    if ((name == NULL) || (read == NULL)){
+        return EWFS_INVALID_PARAMETER;
+    }
+    for (index = 0; index < ewfs_variable_count; index ++){
+        if (strcmp(ewfs_variables[index].name, name) == 0){
+            break;
+        }
+    }
+    if (index == EWFS_TEMPLATE_VARIABLES_MAX){
+        return EWFS_INVALID_PARAMETER;
+    }
+    if (index == ewfs_variable_count){
+        ewfs_variable_count ++;
+    }
+    ewfs_variables[index].name = name;
+    ewfs_variables[index].read = read;
+    ewfs_variables[index].context = context;
+    return EWFS_OK;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSFindVariable
+ * 
+ * DESCRIPTION:
+ * Find the registered callback of a template variable.
+ * 
+ * PARAMETERS:
+ * name 		const char *	variable name
+ * 
+ * RETURN VALUE:
+ * const ewfs_variable_t *		the variable, NULL if none is registered
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static const ewfs_variable_t *EWFSFindVariable(const char *name){
+    uint32_t index;
+    
+    for (index = 0; index < ewfs_variable_count; index ++){
+        if (strcmp(ewfs_variables[index].name, name) == 0){
+            return &ewfs_variables[index];
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSTemplateStart
+ * 
+ * DESCRIPTION:
+ * Start reading a template file from its first segment.
+ * 
+ * PARAMETERS:
+ * disk_num 	uint8_t				disk number
+ * file_obj 	ewfs_file_obj_t *	template file, tpl_table is set
+ * 
+ * RETURN VALUE:
+ * bool		true if successful, false if the media can't be read
+ * 
+ * NOTES:
+ * The template data is the number of segments (2 bytes), a 4 byte word for
+ * each segment, the static bytes and the variable names.  A segment word is
+ * the length of a static run, or EWFS_TEMPLATE_SLOT with the length and the
+ * offset in the template data of the variable name.
+ * 
+******************************************************************************/
+static bool EWFSTemplateStart(uint8_t disk_num, ewfs_file_obj_t *file_obj){
+    uint8_t count[2];
+    
+    if (EWFSGetArray(disk_num, file_obj->tpl_table, sizeof(count), count) == false){
+        return false;
+    }
+    file_obj->tpl_segments = count[0] | (count[1] << 8);
+    file_obj->tpl_segment = file_obj->tpl_table + sizeof(count);
+    file_obj->tpl_data = file_obj->tpl_segment + (file_obj->tpl_segments * 4);
+    file_obj->tpl_run = 0;
+    file_obj->tpl_slot = false;
+    file_obj->tpl_variable = NULL;
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSTemplateRead
+ * 
+ * DESCRIPTION:
+ * Read the next part of a template file, static runs from the media and
+ * variables from their callbacks.
+ * 
+ * PARAMETERS:
+ * disk_num 	uint8_t				disk number
+ * file_obj 	ewfs_file_obj_t *	template file
+ * buffer 		uint8_t *			buffer for the data, NULL to skip the data
+ * btr 			uint32_t			bytes to read
+ * 
+ * RETURN VALUE:
+ * uint32_t		number of bytes read, less than btr at the end of the file
+ * 
+ * NOTES:
+ * Skipped static runs are not read from the media.
+ * 
+******************************************************************************/
+static uint32_t EWFSTemplateRead(uint8_t disk_num, ewfs_file_obj_t *file_obj, uint8_t *buffer,
+        uint32_t btr){
+    uint8_t word[4];
+    uint32_t segment;
+    uint32_t length;
+    uint32_t done = 0;
+    
+    while (done < btr){
+        if (file_obj->tpl_slot){
+            length = 0;
+            if (file_obj->tpl_variable != NULL){
+                if (buffer == NULL){
+                    length = file_obj->tpl_variable->read(file_obj->tpl_variable->context,
+                            file_obj->gen_state, file_obj->tpl_run,
+                            (btr - done < sizeof(ewfs_skip)) ? btr - done : sizeof(ewfs_skip),
+                            ewfs_skip);
+                }else{
+                    length = file_obj->tpl_variable->read(file_obj->tpl_variable->context,
+                            file_obj->gen_state, file_obj->tpl_run, btr - done, &buffer[done]);
+                }
+            }
+            if (length > 0){
+                file_obj->tpl_run += length;
+                done += length;
+                continue;
+            }
+            file_obj->tpl_slot = false;     //end of the value
+            file_obj->tpl_run = 0;
+        }else if (file_obj->tpl_run > 0){
+            length = (btr - done < file_obj->tpl_run) ? btr - done : file_obj->tpl_run;
+            if ((buffer != NULL) &&
+                    (EWFSGetArray(disk_num, file_obj->tpl_data, length, &buffer[done]) == false)){
+                break;
+            }
+            file_obj->tpl_data += length;
+            file_obj->tpl_run -= length;
+            done += length;
+            continue;
+        }
+        //start the next segment
+        if (file_obj->tpl_segments == 0){
+            break;
+        }
+        if (EWFSGetArray(disk_num, file_obj->tpl_segment, sizeof(word), word) == false){
+            break;
+        }
+        file_obj->tpl_segment += sizeof(word);
+        file_obj->tpl_segments --;
+        segment = word[0] | (word[1] << 8) | (word[2] << 16) | ((uint32_t) word[3] << 24);
+        if ((segment & EWFS_TEMPLATE_SLOT) != 0){
+            if (EWFSTemplateVariable(disk_num, file_obj, segment) == false){
+                break;
+            }
+            file_obj->tpl_slot = true;
+            file_obj->tpl_run = 0;
+        }else{
+            file_obj->tpl_run = segment;
+        }
+    }
+    return done;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSTemplateVariable
+ * 
+ * DESCRIPTION:
+ * Start a variable of a template, find its callback by the name stored in the
+ * template.
+ * 
+ * PARAMETERS:
+ * disk_num 	uint8_t				disk number
+ * file_obj 	ewfs_file_obj_t *	template file
+ * segment 		uint32_t			segment word of the variable
+ * 
+ * RETURN VALUE:
+ * bool		true if successful, false if the media can't be read
+ * 
+ * NOTES:
+ * The state of the open file is zeroed for the callback, each use of a
+ * variable in each open file has its own.
+ * 
+******************************************************************************/
+static bool EWFSTemplateVariable(uint8_t disk_num, ewfs_file_obj_t *file_obj, uint32_t segment){
+    char name[EWFS_TEMPLATE_NAME_MAX + 1];
+    uint32_t length;
+    
+    file_obj->tpl_variable = NULL;
+    memset(file_obj->gen_state, 0, sizeof(file_obj->gen_state));
+    length = (segment & ~EWFS_TEMPLATE_SLOT) >> EWFS_TEMPLATE_NAME_SHIFT;
+    if ((length == 0) || (length > EWFS_TEMPLATE_NAME_MAX)){
+        return true;    //not a name of the generator, left out
+    }
+    if (EWFSGetArray(disk_num, file_obj->tpl_table + (segment & EWFS_TEMPLATE_NAME_OFFSET), length,
+            (uint8_t *) name) == false){
+        return false;
+    }
+    name[length] = '\0';
+    file_obj->tpl_variable = EWFSFindVariable(name);
+    return true;
+}
+
+#if defined(EWFS_GEN_CACHE_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFS_SetGeneratedFileCache
+ * 
+ * DESCRIPTION:
+ * Keep the output of a generated file in the cache so it is only generated
+ * again after the time to live or when it is invalidated.
+ * 
+ * PARAMETERS:
+ * path 		const char *	registered path of the generated file
+ * ttl_ms 		uint32_t		time to live of the output in milliseconds, 0 to
+ * 								not cache the file, EWFS_INVALID to keep it until
+ * 								it is invalidated
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
+ * 
+ * NOTES:
+ * The time to live is at most EWFS_GEN_CACHE_TTL_MAX.  Output that isn't read
+ * for longer than a core timer wrap period (about 42 s at 100 MHz) can be seen
+ * as fresh again, invalidate the file when its data changes in that case.
+ * 
+******************************************************************************/
+int EWFS_SetGeneratedFileCache(const char *path, uint32_t ttl_ms){
+    ewfs_generator_t *generator;
+    
+    if (path == NULL){
+        return EWFS_INVALID_PARAMETER;
+    }
+    generator = EWFSFindGenerator(path);
+    if ((generator == NULL) || ((ttl_ms > EWFS_GEN_CACHE_TTL_MAX) && (ttl_ms != EWFS_INVALID))){
+        return EWFS_INVALID_PARAMETER;
+    }
+    EWFSGenCacheDrop(generator);
+    generator->cache_ttl = (ttl_ms == EWFS_INVALID) ? EWFS_INVALID :
+            ttl_ms * (EWFS_CORE_TIMER_FREQUENCY / 1000u);
+    return EWFS_OK;
+}
+#endif
+
+#if defined(EWFS_GEN_CACHE_ENABLE) || defined(EWFS_GEN_CHECKPOINT_ENABLE)
+
+/******************************************************************************
+ * FUNCTION:  EWFS_InvalidateGeneratedFile
+ * 
+ * DESCRIPTION:
+ * Drop the cached output and the checkpoints of a generated file, the next
+ * open generates it again.
+ * 
+ * PARAMETERS:
+ * path 		const char *	registered path of the generated file, NULL for
+ * 								all generated files
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
+ * 
+ * NOTES:
+ * Files already reading the output keep reading it.
+ * 
+******************************************************************************/
+int EWFS_InvalidateGeneratedFile(const char *path){
+    ewfs_generator_t *generator;
+    uint32_t index;
+    
+    if (path == NULL){
+        for (index = 0; index < ewfs_generator_count; index ++){
+#if defined(EWFS_GEN_CACHE_ENABLE)
+            EWFSGenCacheDrop(&ewfs_generators[index]);
+#endif
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+            EWFSCheckpointDrop(&ewfs_generators[index]);
+#endif
+        }
+        return EWFS_OK;
+    }
+    generator = EWFSFindGenerator(path);
+    if (generator == NULL){
+        return EWFS_INVALID_PARAMETER;
+    }
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    EWFSGenCacheDrop(generator);
+#endif
+#if defined(EWFS_GEN_CHECKPOINT_ENABLE)
+    EWFSCheckpointDrop(generator);
+#endif
+    return EWFS_OK;
+}
+#endif
+
+#if defined(EWFS_GEN_CACHE_ENABLE)
+
+/******************************************************************************
+ * FUNCTION:  EWFSGenCacheOpen
+ * 
+ * DESCRIPTION:
+ * Decide how a generated file being opened uses the cache.
+ * 
+ * PARAMETERS:
+ * file_obj 	ewfs_file_obj_t *	generated file being opened
+ * 
+ * RETURN VALUE:
+ * bool		true if the file is served from the cache, otherwise false
+ * 
+ * NOTES:
+ * When the output is not in the cache the file stores it while it is read,
+ * unless another file is already storing an output.
+ * 
+******************************************************************************/
+static bool EWFSGenCacheOpen(ewfs_file_obj_t *file_obj){
+    ewfs_generator_t *generator = file_obj->generator;
+    uint32_t ticks;
+    
+    file_obj->gen_cache = EWFS_GEN_CACHE_NONE;
+    if (generator->cache_ttl == 0){
+        return false;
+    }
+    ticks = EWFS_TIMER_TICKS();
+    if ((generator->cache_state == EWFS_GEN_CACHE_VALID) && (generator->cache_ttl != EWFS_INVALID) &&
+            ((ticks - generator->cache_time) >= generator->cache_ttl)){
+        EWFSGenCacheDrop(generator);    //expired
+    }
+    if (generator->cache_state == EWFS_GEN_CACHE_VALID){
+        generator->cache_readers ++;
+        file_obj->gen_cache = EWFS_GEN_CACHE_SERVE;
+        EWFS_STATS_ADD(gen_cache_hits, 1);
+        return true;
+    }
+    EWFS_STATS_ADD(gen_cache_misses, 1);
+    if ((ewfs_gen_cache_filler == NULL) && (generator->cache_state == EWFS_GEN_CACHE_EMPTY)){
+        generator->cache_offset = EWFSGenCacheCompact();
+        generator->cache_length = 0;
+        generator->cache_time = ticks;
+        generator->cache_state = EWFS_GEN_CACHE_FILLING;
+        ewfs_gen_cache_filler = file_obj;
+        file_obj->gen_cache = EWFS_GEN_CACHE_FILL;
+    }
+    return false;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSGenCacheStore
+ * 
+ * DESCRIPTION:
+ * Add generated data to the output being stored.
+ * 
+ * PARAMETERS:
+ * file_obj 	ewfs_file_obj_t *	generated file storing its output
+ * data 		const uint8_t *		generated data
+ * length 		uint32_t			bytes of data
+ * end 			bool				true if this is the end of the output
+ * 
+ * RETURN VALUE:
+ * none
+ * 
+ * NOTES:
+ * The output is not stored if it doesn't fit in the cache or it was
+ * invalidated while it was being stored.
+ * 
+******************************************************************************/
+static void EWFSGenCacheStore(ewfs_file_obj_t *file_obj, const uint8_t *data, uint32_t length,
+        bool end){
+    ewfs_generator_t *generator = file_obj->generator;
+    
+    if (ewfs_gen_cache_filler != file_obj){
+        file_obj->gen_cache = EWFS_GEN_CACHE_NONE;  //invalidated
+        return;
+    }
+    if (length > 0){
+        if ((generator->cache_offset + generator->cache_length + length > EWFS_GEN_CACHE_SIZE) &&
+                (EWFSGenCacheReserve(length) == false)){
+            EWFSGenCacheClose(file_obj);
+            return;
+        }
+        memcpy(&ewfs_gen_cache[generator->cache_offset + generator->cache_length], data, length);
+        generator->cache_length += length;
+    }
+    if (end){
+        generator->cache_state = EWFS_GEN_CACHE_VALID;
+        ewfs_gen_cache_filler = NULL;
+        file_obj->gen_cache = EWFS_GEN_CACHE_NONE;
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSGenCacheClose
+ * 
+ * DESCRIPTION:
+ * Stop using the cache for a generated file.
+ * 
+ * PARAMETERS:
+ * file_obj 	ewfs_file_obj_t *	generated file
+ * 
+ * RETURN VALUE:
+ * none
+ * 
+ * NOTES:
+ * An output that was not stored to its end is dropped.
+ * 
+******************************************************************************/
+static void EWFSGenCacheClose(ewfs_file_obj_t *file_obj){
+    ewfs_generator_t *generator = file_obj->generator;
+    
+    if (file_obj->gen_cache == EWFS_GEN_CACHE_SERVE){
+        generator->cache_readers --;
+        if ((generator->cache_readers == 0) && (generator->cache_state == EWFS_GEN_CACHE_STALE)){
+            generator->cache_state = EWFS_GEN_CACHE_EMPTY;
+            generator->cache_length = 0;
+        }
+    }else if ((file_obj->gen_cache == EWFS_GEN_CACHE_FILL) && (ewfs_gen_cache_filler == file_obj)){
+        EWFSGenCacheDrop(generator);
+    }
+    file_obj->gen_cache = EWFS_GEN_CACHE_NONE;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSGenCacheDrop
+ * 
+ * DESCRIPTION:
+ * Drop the cached output of a generated file.
+ * 
+ * PARAMETERS:
+ * generator 	ewfs_generator_t *	generator of the file
+ * 
+ * RETURN VALUE:
+ * none
+ * 
+ * NOTES:
+ * An output still being read is kept until the last reader closes.
+ * 
+******************************************************************************/
+static void EWFSGenCacheDrop(ewfs_generator_t *generator){
+    if (generator->cache_state == EWFS_GEN_CACHE_FILLING){
+        ewfs_gen_cache_filler = NULL;   //the file stops storing at its next read
+    }
+    if (generator->cache_readers > 0){
+        generator->cache_state = EWFS_GEN_CACHE_STALE;
+    }else{
+        generator->cache_state = EWFS_GEN_CACHE_EMPTY;
+        generator->cache_length = 0;
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSGenCacheReserve
+ * 
+ * DESCRIPTION:
+ * Make room after the output being stored.
+ * 
+ * PARAMETERS:
+ * length 		uint32_t	bytes needed
+ * 
+ * RETURN VALUE:
+ * bool		true if there is room, otherwise false
+ * 
+ * NOTES:
+ * The oldest outputs that are not being read are dropped until there is
+ * room.
+ * 
+******************************************************************************/
+static bool EWFSGenCacheReserve(uint32_t length){
+    ewfs_generator_t *oldest;
+    uint32_t ticks;
+    uint32_t index;
+    
+    for (;;){
+        if (EWFSGenCacheCompact() + length <= EWFS_GEN_CACHE_SIZE){
+            return true;
+        }
+        oldest = NULL;
+        ticks = EWFS_TIMER_TICKS();
+        for (index = 0; index < ewfs_generator_count; index ++){
+            if ((ewfs_generators[index].cache_state == EWFS_GEN_CACHE_VALID) &&
+                    (ewfs_generators[index].cache_readers == 0) && ((oldest == NULL) ||
+                    ((ticks - ewfs_generators[index].cache_time) > (ticks - oldest->cache_time)))){
+                oldest = &ewfs_generators[index];
+            }
+        }
+        if (oldest == NULL){
+            return false;
+        }
+        EWFSGenCacheDrop(oldest);
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSGenCacheCompact
+ * 
+ * DESCRIPTION:
+ * Move the stored outputs to the start of the cache.
+ * 
+ * PARAMETERS:
+ * none
+ * 
+ * RETURN VALUE:
+ * uint32_t		bytes of the cache in use, the free space starts there
+ * 
+ * NOTES:
+ * The outputs keep their order and the output being stored is moved last so
+ * it can grow.
+ * 
+******************************************************************************/
+static uint32_t EWFSGenCacheCompact(void){
+    ewfs_generator_t *filling = NULL;
+    ewfs_generator_t *next;
+    uint32_t top = 0;
+    uint32_t last = 0;
+    uint32_t index;
+    bool first = true;
+    
+    if (ewfs_gen_cache_filler != NULL){
+        filling = ewfs_gen_cache_filler->generator;
+    }
+    for (;;){
+        //next output after the last one moved, by its offset before the move
+        next = NULL;
+        for (index = 0; index < ewfs_generator_count; index ++){
+            if ((&ewfs_generators[index] != filling) &&
+                    (ewfs_generators[index].cache_state != EWFS_GEN_CACHE_EMPTY) &&
+                    (ewfs_generators[index].cache_length > 0) &&
+                    (first || (ewfs_generators[index].cache_offset > last)) &&
+                    ((next == NULL) || (ewfs_generators[index].cache_offset < next->cache_offset))){
+                next = &ewfs_generators[index];
+            }
+        }
+        if (next == NULL){
+            break;
+        }
+        first = false;
+        last = next->cache_offset;
+        memmove(&ewfs_gen_cache[top], &ewfs_gen_cache[next->cache_offset], next->cache_length);
+        next->cache_offset = top;
+        top += next->cache_length;
+    }
+    if (filling != NULL){
+        memmove(&ewfs_gen_cache[top], &ewfs_gen_cache[filling->cache_offset], filling->cache_length);
+        filling->cache_offset = top;
+        top += filling->cache_length;
+    }
+    return top;
+}
+#endif
+
+/******************************************************************************
+ * FUNCTION NAME:  EWFS_Read
+ *
+ * FUNCTION DESCRIPTION:
+ * Read the file data from flash if it is a file type.  If it is a generated
+ * file, call its registered generator to generate file data.
+ *
+ * FUNCTION PARAMETERS:
+ * handle   uintptr_t   The handle to the file that will be read.
+ * buffer   void *      Pointer to the buffer where the data that is read is 
+ *                      stored to for calling function to use.
+ * btr      uint32_t    The size of data to put in the buffer. Bytes To Read
+ * br       uint32_t *  A pointer to the number of bytes read from the file. 
+ *                      Bytes Read
+ *
+ * FUNCTION RETURN VALUE:
+ * EWFS_OK              The file was read.
+ * EWFS_CHECKSUM_ERR    The file was read to the end and didn't match its
+ *                      checksum, the data is in the buffer.
+ *
+ * FUNCTION NOTES:
+ * A read of a stored file returns btr bytes unless the file ends first.  With
+ * EWFS_MEDIA_PAGE_SIZE it is split into media transfers that end on flash
+ * pages.  Generated files can return fewer bytes, so they are read until *br
+ * is 0.
+ *
+ *****************************************************************************/
+int EWFS_Read(uintptr_t handle, void* buffer, uint32_t btr, uint32_t *br){
+    uint16_t index = 0;
+    uint8_t disk_num = 0;
+    uint32_t length;
+    int result = EWFS_OK;
+    EWFS_STATS_START(start);
+    
+    *br = 0;
+    if (EWFSIsHandleValid(handle) == false){
+        return EWFS_INVALID_PARAMETER;
+    }
+    index = handle & 0xFFFF;
+    //extract the disk number from the handle
+    disk_num = ((handle >> 16) & 0xFF);
+    //find the number of bytes to read is greater then the number of remaining bytes
+    if (btr > ewfs_file_obj[index].bytes_remaining){
+        btr = ewfs_file_obj[index].bytes_remaining;
+    }
+    //check that the buffer needs data
+    if (btr > 0){
+        /*SYS_CONSOLE_PRINT("***READ current position: %X\tbytes remaining: %X***\r\n", 
+                ewfs_file_obj[index].current_position,
+                ewfs_file_obj[index].bytes_remaining);
+        _APP_SQI_StartCoreTimer(0);
+        _APP_SQI_CoreTimer_Delay(500000);  //5ms */
+        if (ewfs_file_obj[index].type == TYPE_GENERATED){    //check if the file is generated
+            *br = EWFSGeneratedRead(&ewfs_file_obj[index], buffer, btr);
+            ewfs_file_obj[index].current_position += *br;
+            ewfs_file_obj[index].bytes_remaining -= *br;
+            if ((*br == 0) && (ewfs_file_obj[index].size == EWFS_SIZE_UNKNOWN)){
+                //end of a streamed file, the size is known now
+                ewfs_file_obj[index].size = ewfs_file_obj[index].current_position;
+                ewfs_file_obj[index].bytes_remaining = 0;
+                if ((ewfs_file_obj[index].generator->flags & EWFS_GEN_STABLE_SIZE) != 0){
+                    ewfs_file_obj[index].generator->cached_size = ewfs_file_obj[index].size;
+                }
+            }
+            EWFS_STATS_ADD(generated_reads, 1);
+            EWFS_STATS_ADD(generated_bytes, *br);
+        }else if (ewfs_file_obj[index].type == TYPE_TEMPLATE){
+            *br = EWFSTemplateRead(disk_num, &ewfs_file_obj[index], buffer, btr);
+            ewfs_file_obj[index].current_position += *br;
+            ewfs_file_obj[index].bytes_remaining -= *br;
+            if ((*br == 0) && (ewfs_file_obj[index].size == EWFS_SIZE_UNKNOWN)){
+                //end of the template, the size is known now
+                ewfs_file_obj[index].size = ewfs_file_obj[index].current_position;
+                ewfs_file_obj[index].bytes_remaining = 0;
+            }
+        }else{  //else its a file
+            //the media transfers end on flash pages, the caller still gets btr bytes
+            while (*br < btr){
+                length = btr - *br;
+#if EWFS_MEDIA_PAGE_SIZE > 0
+                length = EWFSPageReadLength(ewfs_file_obj[index].current_position, length,
+                        ewfs_file_obj[index].bytes_remaining);
+#endif
+                if (EWFSGetArray(disk_num, ewfs_file_obj[index].current_position, length,
+                        (uint8_t *) buffer + *br) == false){
+                    break;
+                }
+#if defined(EWFS_CHECKSUM_ENABLE)
+                if (EWFSChecksumAdd(&ewfs_file_obj[index], (uint8_t *) buffer + *br, length) == false){
+                    result = EWFS_CHECKSUM_ERR;
+                }
+#endif
+                //update the current address offset and the bytes remaining offset
+                ewfs_file_obj[index].current_position += length;
+                ewfs_file_obj[index].bytes_remaining -= length;
+                *br += length;
+            }
+        }
+        /*SYS_CONSOLE_PRINT("***READ current position: %X\tbytes remaining: %X***\r\n", 
+                ewfs_file_obj[index].current_position,
+                ewfs_file_obj[index].bytes_remaining);
+        _APP_SQI_StartCoreTimer(0);
+        _APP_SQI_CoreTimer_Delay(500000);  //5ms */
+    }
+    EWFS_STATS_ADD(reads, 1);
+    EWFS_STATS_ADD(read_bytes, *br);
+    EWFS_STATS_TIME(read_ticks, start);
+    EWFS_TRACE(EWFS_TRACE_READ, index, ewfs_file_obj[index].gen_hash,
+            ewfs_file_obj[index].size - ewfs_file_obj[index].bytes_remaining - *br, *br);
+    return result;
+}
+
+#if defined(EWFS_MEDIA_IS_MAPPED)
+/******************************************************************************
+ * FUNCTION NAME:  EWFS_ReadPointer
+ *
+ * FUNCTION DESCRIPTION:
+ * Zero copy version of EWFS_Read for memory mapped media.  Instead of copying
+ * the file data to a buffer a pointer to the data in the media is returned.
+ *
+ * FUNCTION PARAMETERS:
+ * handle   uintptr_t       The handle to the file that will be read.
+ * data     const void **   Pointer set to the file data in the media.
+ * btr      uint32_t        The maximum number of bytes to read. Bytes To Read
+ * br       uint32_t *      A pointer to the number of bytes the data pointer
+ *                          is valid for. Bytes Read
+ *
+ * FUNCTION RETURN VALUE:
+ * EWFS_OK                  The file was read.
+ * EWFS_INVALID_PARAMETER   The handle is not valid, the file is generated or
+ *                          the media is not mapped.
+ * EWFS_DISK_ERR            The file data is outside of the media.
+ * EWFS_CHECKSUM_ERR        The file was read to the end and didn't match its
+ *                          checksum, the data pointer is set.
+ *
+ * FUNCTION NOTES:
+ * Generated files have no data in the media and must be read with EWFS_Read.
+ *
+ *****************************************************************************/
+int EWFS_ReadPointer(uintptr_t handle, const void **data, uint32_t btr, uint32_t *br){
+    uint16_t index = 0;
+    uint32_t position;
+    int result = EWFS_OK;
+    
+    *br = 0;
+    *data = NULL;
+    if ((ewfs_header.mapped == false) || (EWFSIsHandleValid(handle) == false)){
+        return EWFS_INVALID_PARAMETER;
+    }
+    index = handle & 0xFFFF;
+    if (ewfs_file_obj[index].type != TYPE_FILE){
+        return EWFS_INVALID_PARAMETER;
+    }
+    if (btr > ewfs_file_obj[index].bytes_remaining){
+        btr = ewfs_file_obj[index].bytes_remaining;
+    }
+    position = ewfs_file_obj[index].current_position;
+    if ((position > ewfs_header.media_size) || (btr > (ewfs_header.media_size - position))){
+        return EWFS_DISK_ERR;
+    }
+    *data = (const uint8_t *)ewfs_header.base_address + position;
+    *br = btr;
+#if defined(EWFS_CHECKSUM_ENABLE)
+    if (EWFSChecksumAdd(&ewfs_file_obj[index], *data, btr) == false){
+        result = EWFS_CHECKSUM_ERR;
+    }
+#endif
+    ewfs_file_obj[index].current_position += btr;
+    ewfs_file_obj[index].bytes_remaining -= btr;
+    EWFS_STATS_ADD(reads, 1);
+    EWFS_STATS_ADD(read_bytes, btr);
+    EWFS_STATS_ADD(mapped_reads, 1);
+    EWFS_TRACE(EWFS_TRACE_READ, index, ewfs_file_obj[index].gen_hash,
+            ewfs_file_obj[index].size - ewfs_file_obj[index].bytes_remaining - btr, btr);
+    return result;
+}
+#endif
+
+/******************************************************************************
+ * FUNCTION:  EWFS_Close
+ * 
+ * DESCRIPTION:
+ * Close the file and free the file pointer handle.
+ * 
+ * PARAMETERS:
+ * handle 	uintptr_t	pointer to file handle
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+int EWFS_Close(uintptr_t handle){
+    uint16_t index = 0;
+    
+    //a stale handle mustn't release the cache or snapshot of the new owner
+    if (EWFSIsHandleValid(handle) == false){
+        return EWFS_INVALID_PARAMETER;
+    }
+    index = handle & 0xFFFF;
+    EWFS_TRACE(EWFS_TRACE_CLOSE, index, ewfs_file_obj[index].gen_hash,
+            ewfs_file_obj[index].size - ewfs_file_obj[index].bytes_remaining, 0);
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    EWFSGenCacheClose(&ewfs_file_obj[index]);
+#endif
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+    EWFSSnapshotRelease(&ewfs_file_obj[index]);
+#endif
+    ewfs_file_obj[index].handle = EWFS_INVALID_HANDLE;
+    ewfs_file_obj[index].current_position = EWFS_INVALID;
+    ewfs_file_obj[index].bytes_remaining = 0;
+    ewfs_file_obj[index].size = 0;
+    ewfs_file_obj[index].gen_hash = 0;
+    ewfs_file_obj[index].generator = NULL;
+    /*SYS_CONSOLE_PRINT("CLOSE\r\n");*/
+    return EWFS_OK;
+    
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_GetSize
+ * 
+ * DESCRIPTION:
+ * Return the size of the file associated with the file handle.
+ * 
+ * PARAMETERS:
+ * handle 	uintptr_t	pointer to file handle
+ * 
+ * RETURN VALUE:
+ * int 		returns the size of the file, 0 if not valid
+ * 
+ * NOTES:
+ * A streamed generated file returns EWFS_SIZE_UNKNOWN until it has been read
+ * to the end.
+ * 
+******************************************************************************/
+uint32_t EWFS_GetSize(uintptr_t handle){
+    uint16_t index = 0;
+    
+    if (EWFSIsHandleValid(handle) == false){
+        return 0;   //invalid handle
+    }
+    index = handle & 0xFFFF;
+    return ewfs_file_obj[index].size;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSIsHandleValid
+ * 
+ * DESCRIPTION:
+ * Determine if the file handle is valid.
+ * 
+ * PARAMETERS:
+ * handle 	uint32_t	file handle
+ * 
+ * RETURN VALUE:
+ * bool		true if handle is valid, otherwise false
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static bool EWFSIsHandleValid(uint32_t handle){
+    uint16_t index = handle & 0xFFFF;
+    if (index >= SYS_FS_MAX_FILES){
+        return false;
+    }
+    if (ewfs_file_obj[index].handle != handle){
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_GetPosition
+ * 
+ * DESCRIPTION:
+ * This function returns the current position within the file being read.
+ * 
+ * PARAMETERS:
+ * handle 		uintptr_t	file handle
+ * 
+ * RETURN VALUE:
+ * uint32_t		current position within the file
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+uint32_t EWFS_GetPosition(uintptr_t handle){
+    uint16_t index;
+    if (EWFSIsHandleValid(handle) == false){
+        return 0;   //invalid handle
+    }
+    
+    index = handle & 0xFFFF;
+    return (uint32_t) (ewfs_file_obj[index].current_position);
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_Seek
+ * 
+ * DESCRIPTION:
+ * Update the file object position for reading to allow for adjustments of 
+ * file reading position.
+ * 
+ * PARAMETERS:
+ * handle 		uintptr_t		file handle
+ * dwOffset		uint32_t		offset to current file position to apply
+ * 
+ * RETURN VALUE:
+ * int 		returns 0 if successful, otherwise 1
+ * 
+ * NOTES:
+ * The offset is signed.  A seek before the start or past the end of the
+ * file fails and leaves the position unchanged, the end of a generated file
+ * or template of unknown size is found by generating it up to the position.
+ * 
+******************************************************************************/
+//returns 0 when successful, otherwise 1.
+int EWFS_Seek(uintptr_t handle, uint32_t dwOffset){
+    uint16_t index = 0;
+    uint32_t position;
+    int64_t target;
+    if (EWFSIsHandleValid(handle) == false){
+        return 1;   //invalid handle
+    }
+    index = handle & 0xFFFF;
+    //position in the file, stored files keep the media address in current_position
+    if (ewfs_file_obj[index].type == TYPE_FILE){
+        position = ewfs_file_obj[index].size - ewfs_file_obj[index].bytes_remaining;
+    }else{
+        position = ewfs_file_obj[index].current_position;
+    }
+    target = (int64_t) position + (int32_t) dwOffset;
+    if ((target < 0) || ((ewfs_file_obj[index].size != EWFS_SIZE_UNKNOWN) &&
+            (target > ewfs_file_obj[index].size))){
+        return 1;
+    }
+    position = (uint32_t) target;
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    if (ewfs_file_obj[index].gen_cache == EWFS_GEN_CACHE_SERVE){
+        //stored output is read at any position
+        ewfs_file_obj[index].current_position = position;
+        ewfs_file_obj[index].bytes_remaining = ewfs_file_obj[index].size - position;
+        EWFS_TRACE(EWFS_TRACE_SEEK, index, ewfs_file_obj[index].gen_hash,
+                ewfs_file_obj[index].size - ewfs_file_obj[index].bytes_remaining, dwOffset);
+        return 0;
+    }
+    if (ewfs_file_obj[index].gen_cache == EWFS_GEN_CACHE_FILL){
+        //the generator repeats data after a seek, don't store it
+        EWFSGenCacheClose(&ewfs_file_obj[index]);
+    }
+#endif
+    if (ewfs_file_obj[index].type == TYPE_TEMPLATE){
+        //read the template again up to the new position
+        if (EWFSTemplateStart((handle >> 16) & 0xFF, &ewfs_file_obj[index]) == false){
+            return 1;
+        }
+        ewfs_file_obj[index].current_position = EWFSTemplateRead((handle >> 16) & 0xFF,
+                &ewfs_file_obj[index], NULL, position);
+        ewfs_file_obj[index].bytes_remaining = ewfs_file_obj[index].size -
+                ewfs_file_obj[index].current_position;
+    }else if (ewfs_file_obj[index].type == TYPE_GENERATED){    //check if the file is generated
+        //generate the file again from the closest state before the new position
+        EWFSGeneratedRestart(&ewfs_file_obj[index], position);
+        EWFSGeneratedSkip(&ewfs_file_obj[index], position - ewfs_file_obj[index].gen_position);
+        ewfs_file_obj[index].current_position = ewfs_file_obj[index].gen_position;
+        ewfs_file_obj[index].bytes_remaining = ewfs_file_obj[index].size -
+                ewfs_file_obj[index].current_position;
+    }else{
+        ewfs_file_obj[index].current_position = ewfs_file_obj[index].current_position + dwOffset;
+        ewfs_file_obj[index].bytes_remaining = ewfs_file_obj[index].size - position;
+    }
+    EWFS_TRACE(EWFS_TRACE_SEEK, index, ewfs_file_obj[index].gen_hash,
+            ewfs_file_obj[index].size - ewfs_file_obj[index].bytes_remaining, dwOffset);
+
+    return 0;
+}
+
+
+#if defined(EWFS_CHECKSUM_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFSChecksumLoad
+ * 
+ * DESCRIPTION:
+ * Read the checksums that follow the index and check the header and the
+ * index against them.
+ * 
+ * PARAMETERS:
+ * disk_num 		uint8_t		disk number
+ * index_address 	uint32_t	media address of the index, already in ewfs_index
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if the checksums were read and the header and
+ * 			index match, EWFS_CHECKSUM_ERR if they don't, otherwise
+ * 			EWFS_DISK_ERR
+ * 
+ * NOTES:
+ * The table is a CRC32C of each index entry (0 for generated files) then the
+ * CRC32C of the header, the index, the 32 bit path hashes (version 4) and
+ * the table, all LSB first like the header fields and the index are in
+ * memory.  The table is kept in RAM (4 bytes per file) so opening a file
+ * doesn't read the media again.
+ * 
+******************************************************************************/
+static int EWFSChecksumLoad(uint8_t disk_num, uint32_t index_address){
+    uint32_t index_size = sizeof(ewfs_index_t) * ewfs_header.file_count;
+    uint32_t long_hash_size = 0;
+    uint32_t crc;
+    
+    if (ewfs_long_hash != NULL){
+        long_hash_size = EWFS_LONG_HASH_SIZE * ewfs_header.file_count;
+    }
+    
+    ewfs_crc = malloc(EWFS_CRC_SIZE * (ewfs_header.file_count + 1));
+    if (ewfs_crc == NULL){
+        return EWFS_DISK_ERR;
+    }
+    if (EWFSGetArray(disk_num, index_address + index_size + long_hash_size, EWFS_CRC_SIZE * (ewfs_header.file_count + 1),
+            (uint8_t *) ewfs_crc) == false){
+        free(ewfs_crc);
+        ewfs_crc = NULL;
+        return EWFS_DISK_ERR;
+    }
+    crc = EWFS_Crc32c(EWFS_CRC_START, "EWFS", 4);
+    crc = EWFS_Crc32c(crc, &ewfs_header.version, 1);
+    crc = EWFS_Crc32c(crc, &ewfs_header.file_count, 2);
+    crc = EWFS_Crc32c(crc, &ewfs_header.hash_seed, EWFS_SEED_SIZE);
+    crc = EWFS_Crc32c(crc, ewfs_index, index_size);
+    if (long_hash_size > 0){
+        crc = EWFS_Crc32c(crc, ewfs_long_hash, long_hash_size);
+    }
+    crc = EWFS_Crc32c(crc, ewfs_crc, EWFS_CRC_SIZE * ewfs_header.file_count);
+    if (crc != ewfs_crc[ewfs_header.file_count]){
+        SYS_CONSOLE_PRINT("index checksum %08X, expected %08X\r\n", crc, ewfs_crc[ewfs_header.file_count]);
+        EWFS_STATS_ADD(checksum_errors, 1);
+        free(ewfs_crc);
+        ewfs_crc = NULL;
+        return EWFS_CHECKSUM_ERR;
+    }
+    ewfs_header.header_crc = crc;
+    ewfs_header.checksums = true;
+    return EWFS_OK;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSChecksumAdd
+ * 
+ * DESCRIPTION:
+ * Add data read from a stored file to the CRC of the file and check it at
+ * the end of the file.
+ * 
+ * PARAMETERS:
+ * file_obj 	ewfs_file_obj_t *	open file, the position is still the one
+ * 									the data was read at
+ * data 		const void *		data read
+ * length 		uint32_t			bytes read
+ * 
+ * RETURN VALUE:
+ * bool		false if the data completed the file and the file didn't match
+ * 			its checksum, otherwise true
+ * 
+ * NOTES:
+ * Only data read in order from the start of the file is added.  A seek
+ * pauses the check, it goes on when a read starts where it stopped again.
+ * The checksum covers the trailing 0 of the data in the image, it isn't
+ * read so it is added here.
+ * 
+******************************************************************************/
+static bool EWFSChecksumAdd(ewfs_file_obj_t *file_obj, const void *data, uint32_t length){
+    static const uint8_t end = 0x00;
+    
+    if ((file_obj->verify != EWFS_VERIFY_PENDING) ||
+            (file_obj->crc_next != (file_obj->size - file_obj->bytes_remaining))){
+        return true;
+    }
+    file_obj->crc = EWFS_Crc32c(file_obj->crc, data, length);
+    file_obj->crc_next += length;
+    if (file_obj->crc_next < file_obj->size){
+        return true;
+    }
+    file_obj->crc = EWFS_Crc32c(file_obj->crc, &end, 1);
+    if (file_obj->crc != file_obj->crc_expected){
+        file_obj->verify = EWFS_VERIFY_FAILED;
+        EWFS_STATS_ADD(checksum_errors, 1);
+        return false;
+    }
+    file_obj->verify = EWFS_VERIFY_OK;
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_GetVerifyState
+ * 
+ * DESCRIPTION:
+ * Return how far the data read from a file was checked against the checksum
+ * in the image.
+ * 
+ * PARAMETERS:
+ * handle 		uintptr_t	file handle
+ * 
+ * RETURN VALUE:
+ * ewfs_verify_e	EWFS_VERIFY_OK once the whole file was read and matched,
+ * 					EWFS_VERIFY_FAILED if it didn't, EWFS_VERIFY_PENDING while
+ * 					it is read, EWFS_VERIFY_NONE if the file isn't checked or
+ * 					the handle isn't valid
+ * 
+ * NOTES:
+ * The last read of a file that doesn't match also returns
+ * EWFS_CHECKSUM_ERR.
+ * 
+******************************************************************************/
+ewfs_verify_e EWFS_GetVerifyState(uintptr_t handle){
+    if (EWFSIsHandleValid(handle) == false){
+        return EWFS_VERIFY_NONE;
+    }
+    return (ewfs_verify_e) ewfs_file_obj[handle & 0xFFFF].verify;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_Scrub
+ * 
+ * DESCRIPTION:
+ * Check the next part of the image against its checksums, for the idle time
+ * of the application.
+ * 
+ * PARAMETERS:
+ * max_bytes 	uint32_t	most bytes of the media to read in this call
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if the data checked matched,
+ * 			EWFS_CHECKSUM_ERR if an index entry (or the header and index)
+ * 			finished in this call didn't match, EWFS_DISK_ERR if the media
+ * 			couldn't be read, EWFS_INVALID_PARAMETER if no image with
+ * 			checksums is mounted
+ * 
+ * NOTES:
+ * Each pass checks the header and index, then the data of every index entry
+ * in index order, each call goes on where the last one stopped and stops at
+ * the end of a pass, so EWFS_Scrub(EWFS_INVALID) finishes the pass.  The
+ * media is read EWFS_SCRUB_CHUNK bytes at a time.  Files that share their
+ * data are read for each of their entries.  The results are read with
+ * EWFS_GetScrubStatus().
+ * 
+******************************************************************************/
+int EWFS_Scrub(uint32_t max_bytes){
+    uint32_t address;
+    uint32_t length;
+    uint32_t expected;
+    uint32_t chunk;
+    int result = EWFS_OK;
+    
+    if ((ewfs_header.disk_num == EWFS_INVALID_HANDLE) || (ewfs_header.checksums == false)){
+        return EWFS_INVALID_PARAMETER;
+    }
+    while (max_bytes > 0){
+        if (ewfs_scrub.entry == EWFS_SCRUB_INDEX){
+            address = 0;
+            length = ewfs_header.file_start_address - EWFS_CRC_SIZE;
+            expected = ewfs_header.header_crc;
+        }else if (ewfs_index[ewfs_scrub.entry].type == TYPE_GENERATED){
+            ewfs_scrub.entry ++;
+            if (ewfs_scrub.entry == ewfs_header.file_count){
+                break;
+            }
+            continue;
+        }else{
+            address = ewfs_header.file_start_address + ewfs_index[ewfs_scrub.entry].offset;
+            length = ewfs_index[ewfs_scrub.entry].length;
+            expected = ewfs_crc[ewfs_scrub.entry];
+        }
+        chunk = length - ewfs_scrub.offset;
+        if (chunk > EWFS_SCRUB_CHUNK){
+            chunk = EWFS_SCRUB_CHUNK;
+        }
+        if (chunk > max_bytes){
+            chunk = max_bytes;
+        }
+        if (chunk > 0){
+            if (EWFSGetArray(ewfs_header.disk_num, address + ewfs_scrub.offset, chunk,
+                    ewfs_scrub_buffer) == false){
+                return EWFS_DISK_ERR;
+            }
+            ewfs_scrub.crc = EWFS_Crc32c(ewfs_scrub.crc, ewfs_scrub_buffer, chunk);
+            ewfs_scrub.offset += chunk;
+            ewfs_scrub.bytes += chunk;
+            max_bytes -= chunk;
+        }
+        if (ewfs_scrub.offset < length){
+            continue;
+        }
+        if (ewfs_scrub.crc != expected){
+            ewfs_scrub.errors ++;
+            ewfs_scrub.last_error = ewfs_scrub.entry;
+            EWFS_STATS_ADD(checksum_errors, 1);
+            result = EWFS_CHECKSUM_ERR;
+        }
+        ewfs_scrub.entry = (ewfs_scrub.entry == EWFS_SCRUB_INDEX) ? 0 : (ewfs_scrub.entry + 1);
+        ewfs_scrub.offset = 0;
+        ewfs_scrub.crc = EWFS_CRC_START;
+        if (ewfs_scrub.entry == ewfs_header.file_count){
+            break;
+        }
+    }
+    if (ewfs_scrub.entry == ewfs_header.file_count){
+        //the next call starts a new pass
+        ewfs_scrub.entry = EWFS_SCRUB_INDEX;
+        ewfs_scrub.passes ++;
+    }
+    return result;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_GetScrubStatus
+ * 
+ * DESCRIPTION:
+ * Copy the progress and the results of the scrub and optionally clear the
+ * results.
+ * 
+ * PARAMETERS:
+ * status 		ewfs_scrub_t *	buffer for the status, NULL to only clear
+ * clear 		bool			true to clear the passes, errors and bytes
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
+ * 
+ * NOTES:
+ * Clearing doesn't move the scrub, it goes on where it stopped.
+ * 
+******************************************************************************/
+int EWFS_GetScrubStatus(ewfs_scrub_t *status, bool clear){
+    if ((status == NULL) && (clear == false)){
+        return EWFS_INVALID_PARAMETER;
+    }
+    if (status != NULL){
+        *status = ewfs_scrub;
+    }
+    if (clear){
+        ewfs_scrub.passes = 0;
+        ewfs_scrub.errors = 0;
+        ewfs_scrub.last_error = EWFS_INVALID;
+        ewfs_scrub.bytes = 0;
+    }
+    return EWFS_OK;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSScrubCommand
+ * 
+ * DESCRIPTION:
+ * The ewfsscrub console command, print the scrub results.
+ * 
+ * PARAMETERS:
+ * pCmdIO 		SYS_CMD_DEVICE_NODE *	command I/O device
+ * argc 		int						number of arguments
+ * argv 		char **					arguments, "run" finishes the pass
+ * 										first, "clear" resets the results
+ * 
+ * RETURN VALUE:
+ * int 		returns 0
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static int EWFSScrubCommand(SYS_CMD_DEVICE_NODE *pCmdIO, int argc, char **argv){
+    const void *cmdIoParam = pCmdIO->cmdIoParam;
+    ewfs_scrub_t status;
+    
+    if ((argc > 1) && (strcmp(argv[1], "clear") == 0)){
+        EWFS_GetScrubStatus(NULL, true);
+        (*pCmdIO->pCmdApi->msg)(cmdIoParam, "EWFS scrub results cleared\r\n");
+        return 0;
+    }
+    if ((argc > 1) && (strcmp(argv[1], "run") == 0) && (EWFS_Scrub(EWFS_INVALID) == EWFS_INVALID_PARAMETER)){
+        (*pCmdIO->pCmdApi->msg)(cmdIoParam, "No EWFS image with checksums is mounted\r\n");
+        return 0;
+    }
+    EWFS_GetScrubStatus(&status, false);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "passes: %u\terrors: %u\tbytes: %llu\r\n",
+            status.passes, status.errors, (unsigned long long) status.bytes);
+    if (status.last_error == EWFS_SCRUB_INDEX){
+        (*pCmdIO->pCmdApi->print)(cmdIoParam, "last error: header and index\r\n");
+    }else if (status.last_error != EWFS_INVALID){
+        (*pCmdIO->pCmdApi->print)(cmdIoParam, "last error: entry %u hash %04X\r\n",
+                status.last_error, ewfs_index[status.last_error].hash);
+    }
+    return 0;
+}
+#endif
+
+#if defined(EWFS_STATS_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFS_GetStats
+ * 
+ * DESCRIPTION:
+ * Copy the runtime statistics and optionally clear them.
+ * 
+ * PARAMETERS:
+ * stats 		ewfs_stats_t *	buffer for the statistics, NULL to only clear
+ * clear 		bool			true to clear the statistics after the copy
+ * 
+ * RETURN VALUE:
+ * int 		returns EWFS_OK if successful, otherwise EWFS_INVALID_PARAMETER
+ * 
+ * NOTES:
+ * The counters are not atomic, read them from the task that uses the file
+ * system.
+ * 
+******************************************************************************/
+int EWFS_GetStats(ewfs_stats_t *stats, bool clear){
+    if ((stats == NULL) && (clear == false)){
+        return EWFS_INVALID_PARAMETER;
+    }
+    if (stats != NULL){
+        *stats = ewfs_stats;
+    }
+    if (clear){
+        memset(&ewfs_stats, 0, sizeof(ewfs_stats));
+    }
+    return EWFS_OK;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSStatsHistogramAdd
+ * 
+ * DESCRIPTION:
+ * Add a time to a latency histogram.
+ * 
+ * PARAMETERS:
+ * histogram 	ewfs_histogram_t *	histogram to update
+ * ticks 		uint32_t			time in core timer ticks
+ * 
+ * RETURN VALUE:  None.
+ * 
+ * NOTES:
+ * The bucket is the position of the highest set bit, a single instruction
+ * (clz) on the PIC32.
+ * 
+******************************************************************************/
+static void EWFSStatsHistogramAdd(ewfs_histogram_t *histogram, uint32_t ticks){
+    uint32_t bucket = 0;
+    
+    if (ticks > 0){
+        bucket = 31 - __builtin_clz(ticks);
+        if (bucket >= EWFS_STATS_BUCKETS){
+            bucket = EWFS_STATS_BUCKETS - 1;
+        }
+    }
+    if ((histogram->count == 0) || (ticks < histogram->min)){
+        histogram->min = ticks;
+    }
+    if (ticks > histogram->max){
+        histogram->max = ticks;
+    }
+    histogram->count ++;
+    histogram->total += ticks;
+    histogram->buckets[bucket] ++;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSStatsPrintHistogram
+ * 
+ * DESCRIPTION:
+ * Print a latency histogram to the command console.
+ * 
+ * PARAMETERS:
+ * pCmdIO 		SYS_CMD_DEVICE_NODE *		command I/O device
+ * name 		const char *				name of the histogram
+ * histogram 	const ewfs_histogram_t *	histogram to print
+ * 
+ * RETURN VALUE:  None.
+ * 
+ * NOTES:
+ * Only buckets with a count are printed, each with its lowest tick count.
+ * 
+******************************************************************************/
+static void EWFSStatsPrintHistogram(SYS_CMD_DEVICE_NODE *pCmdIO, const char *name,
+        const ewfs_histogram_t *histogram){
+    const void *cmdIoParam = pCmdIO->cmdIoParam;
+    uint32_t bucket;
+    
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "%s ticks: count %u min %u avg %u max %u\r\n",
+            name, histogram->count, histogram->min,
+            (histogram->count > 0) ? (uint32_t) (histogram->total / histogram->count) : 0,
+            histogram->max);
+    for (bucket = 0; bucket < EWFS_STATS_BUCKETS; bucket ++){
+        if (histogram->buckets[bucket] > 0){
+            (*pCmdIO->pCmdApi->print)(cmdIoParam, "  >= %u\t%u\r\n",
+                    (bucket == 0) ? 0 : (1u << bucket), histogram->buckets[bucket]);
+        }
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSStatsCommand
+ * 
+ * DESCRIPTION:
+ * The ewfsstats console command, print the runtime statistics.
+ * 
+ * PARAMETERS:
+ * pCmdIO 		SYS_CMD_DEVICE_NODE *	command I/O device
+ * argc 		int						number of arguments
+ * argv 		char **					arguments, "clear" resets the statistics
+ * 
+ * RETURN VALUE:
+ * int 		returns 0
+ * 
+ * NOTES:
+ * 
+******************************************************************************/
+static int EWFSStatsCommand(SYS_CMD_DEVICE_NODE *pCmdIO, int argc, char **argv){
+    const void *cmdIoParam = pCmdIO->cmdIoParam;
+    ewfs_stats_t stats;
+    
+    if ((argc > 1) && (strcmp(argv[1], "clear") == 0)){
+        EWFS_GetStats(NULL, true);
+        (*pCmdIO->pCmdApi->msg)(cmdIoParam, "EWFS statistics cleared\r\n");
+        return 0;
+    }
+    EWFS_GetStats(&stats, false);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "mounts: %u\r\n", stats.mounts);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "opens: %u\tmisses: %u\r\n",
+            stats.opens, stats.open_misses);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "reads: %u\tbytes: %llu\r\n",
+            stats.reads, (unsigned long long) stats.read_bytes);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "generated reads: %u\tbytes: %llu\r\n",
+            stats.generated_reads, (unsigned long long) stats.generated_bytes);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "media commands: %u\terrors: %u\tbytes: %llu\r\n",
+            stats.media_commands, stats.media_errors, (unsigned long long) stats.media_bytes);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "mapped reads: %u\r\n", stats.mapped_reads);
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "generated cache hits: %u\tmisses: %u\thit rate: %u%%\r\n",
+            stats.gen_cache_hits, stats.gen_cache_misses,
+            (stats.gen_cache_hits + stats.gen_cache_misses == 0) ? 0 :
+            (uint32_t) ((100ull * stats.gen_cache_hits) / (stats.gen_cache_hits + stats.gen_cache_misses)));
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "checksum errors: %u\r\n", stats.checksum_errors);
+    EWFSStatsPrintHistogram(pCmdIO, "open", &stats.open_ticks);
+    EWFSStatsPrintHistogram(pCmdIO, "read", &stats.read_ticks);
+    EWFSStatsPrintHistogram(pCmdIO, "media", &stats.media_ticks);
+    return 0;
+}
+#endif
+
+#if defined(EWFS_TRACE_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFS_TraceGet
+ * 
+ * DESCRIPTION:
+ * Copy the recorded trace events, oldest first, and optionally clear them.
+ * 
+ * PARAMETERS:
+ * events 		ewfs_trace_event_t *	buffer for the events, NULL to only clear
+ * max_events 	uint32_t				size of the buffer in events
+ * clear 		bool					true to clear the trace after the copy
+ * 
+ * RETURN VALUE:
+ * uint32_t		number of events copied
+ * 
+ * NOTES:
+ * Only the last EWFS_TRACE_ENTRIES events are kept.  When the buffer is
+ * smaller the oldest of them are copied.
+ * 
+******************************************************************************/
+uint32_t EWFS_TraceGet(ewfs_trace_event_t *events, uint32_t max_events, bool clear){
+    uint32_t first = 0;
+    uint32_t count = 0;
+    
+    if (ewfs_trace_count > EWFS_TRACE_ENTRIES){
+        first = ewfs_trace_count - EWFS_TRACE_ENTRIES;
+    }
+    if (events != NULL){
+        for (count = 0; (count < max_events) && (first + count < ewfs_trace_count); count ++){
+            events[count] = ewfs_trace[(first + count) & (EWFS_TRACE_ENTRIES - 1)];
+        }
+    }
+    if (clear){
+        ewfs_trace_count = 0;
+    }
+    return count;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSTraceAdd
+ * 
+ * DESCRIPTION:
+ * Record an event in the trace ring buffer.
+ * 
+ * PARAMETERS:
+ * type 		uint8_t		ewfs_trace_type_e of the event
+ * file 		uint8_t		file object, EWFS_TRACE_NO_FILE if none
+ * hash 		uint16_t	hash of the file path
+ * offset 		uint32_t	offset, depends on the type
+ * length 		uint32_t	length, depends on the type
+ * 
+ * RETURN VALUE:  None.
+ * 
+ * NOTES:
+ * The oldest event is overwritten when the buffer is full.
+ * 
+******************************************************************************/
+static void EWFSTraceAdd(uint8_t type, uint8_t file, uint16_t hash, uint32_t offset, uint32_t length){
+    ewfs_trace_event_t *event = &ewfs_trace[ewfs_trace_count & (EWFS_TRACE_ENTRIES - 1)];
+    
+    event->timestamp = EWFS_TIMER_TICKS();
+    event->type = type;
+    event->file = file;
+    event->hash = hash;
+    event->offset = offset;
+    event->length = length;
+    ewfs_trace_count ++;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSTraceCommand
+ * 
+ * DESCRIPTION:
+ * The ewfstrace console command, dump the trace in EWFS_TRACE_FORMAT lines.
+ * 
+ * PARAMETERS:
+ * pCmdIO 		SYS_CMD_DEVICE_NODE *	command I/O device
+ * argc 		int						number of arguments
+ * argv 		char **					arguments, "clear" empties the trace
+ * 
+ * RETURN VALUE:
+ * int 		returns 0
+ * 
+ * NOTES:
+ * The dump can be captured from the console and replayed with the host
+ * ewfs_replay tool.
+ * 
+******************************************************************************/
+static int EWFSTraceCommand(SYS_CMD_DEVICE_NODE *pCmdIO, int argc, char **argv){
+    const void *cmdIoParam = pCmdIO->cmdIoParam;
+    ewfs_trace_event_t event;
+    uint32_t count;
+    uint32_t index;
+    
+    if ((argc > 1) && (strcmp(argv[1], "clear") == 0)){
+        EWFS_TraceGet(NULL, 0, true);
+        (*pCmdIO->pCmdApi->msg)(cmdIoParam, "EWFS trace cleared\r\n");
+        return 0;
+    }
+    count = (ewfs_trace_count > EWFS_TRACE_ENTRIES) ? EWFS_TRACE_ENTRIES : ewfs_trace_count;
+    (*pCmdIO->pCmdApi->print)(cmdIoParam, "EWFS trace: %u events\r\n", count);
+    for (index = ewfs_trace_count - count; index < ewfs_trace_count; index ++){
+        event = ewfs_trace[index & (EWFS_TRACE_ENTRIES - 1)];
+        (*pCmdIO->pCmdApi->print)(cmdIoParam, EWFS_TRACE_FORMAT, event.timestamp, event.type,
+                event.file, event.hash, event.offset, event.length);
+    }
+    return 0;
+}
+#endif
+
+#if defined(EWFS_COMMAND_ENABLE)
+/******************************************************************************
+ * FUNCTION:  EWFS_CommandInit
+ * 
+ * DESCRIPTION:
+ * Add the EWFS commands (ewfsstats, ewfstrace, ewfsscrub) to the system command
+ * processor.
+ * 
+ * PARAMETERS:  None.
+ * 
+ * RETURN VALUE:
+ * bool		true if the commands were added, otherwise false
+ * 
+ * NOTES:
+ * Call after the command processor is initialized.
+ * 
+******************************************************************************/
+bool EWFS_CommandInit(void){
+    return SYS_CMD_ADDGRP(ewfs_commands, sizeof(ewfs_commands) / sizeof(ewfs_commands[0]),
+            "ewfs", ": EWFS commands");
+}
+#endif
@@ -41,6 +41,69 @@
  *****************************************************************************/
 #define EWFS_INVALID            (0xffffffffu)
 #define EWFS_INVALID_HANDLE     0xff
+#define EWFS_SIZE_UNKNOWN       EWFS_INVALID    //size of a streamed generated file
+#define EWFS_GEN_STABLE_SIZE    0x01    //generated file size doesn't change, keep it
+#ifndef EWFS_GENERATED_FILES_MAX
+#define EWFS_GENERATED_FILES_MAX    16  //generated files that can be registered
+#endif
+#ifndef EWFS_GEN_STATE_SIZE
+#define EWFS_GEN_STATE_SIZE     16      //bytes of generator state kept in each open file
+#endif
+#ifndef EWFS_GEN_CHECKPOINTS
+#define EWFS_GEN_CHECKPOINTS    0       //seek checkpoints kept for each generated file (at
+                                        //least 2), 0 for none
+#endif
+#if EWFS_GEN_CHECKPOINTS > 1
+#define EWFS_GEN_CHECKPOINT_ENABLE      //seek in generated files from published checkpoints
+#endif
+#ifndef EWFS_GEN_SNAPSHOTS
+#define EWFS_GEN_SNAPSHOTS      0       //snapshot buffers for open generated files, 0 for none
+#endif
+#ifndef EWFS_GEN_SNAPSHOT_SIZE
+#define EWFS_GEN_SNAPSHOT_SIZE  256     //bytes of each snapshot buffer
+#endif
+#if EWFS_GEN_SNAPSHOTS > 0
+#define EWFS_GEN_SNAPSHOT_ENABLE        //generated files read from a snapshot taken at open
+#endif
+#ifndef EWFS_MEDIA_PAGE_SIZE
+#define EWFS_MEDIA_PAGE_SIZE    0       //flash page size (a power of 2) reads of stored files
+                                        //end on, 0 to read as asked
+#endif
+#ifndef EWFS_TEMPLATE_VARIABLES_MAX
+#define EWFS_TEMPLATE_VARIABLES_MAX 32  //template variables that can be registered
+#endif
+#ifndef EWFS_GEN_CACHE_SIZE
+#define EWFS_GEN_CACHE_SIZE     0       //bytes of RAM for generated file output, 0 for none
+#endif
+#if EWFS_GEN_CACHE_SIZE > 0
+#define EWFS_GEN_CACHE_ENABLE           //memoized generated file output
+#ifndef EWFS_CORE_TIMER_FREQUENCY
+#define EWFS_CORE_TIMER_FREQUENCY   100000000u  //core timer ticks per second
+#endif
+//longest time to live, half of the core timer wrap period
+#define EWFS_GEN_CACHE_TTL_MAX  (0x7FFFFFFFu / (EWFS_CORE_TIMER_FREQUENCY / 1000u))
+#endif
+#if defined(EWFS_STATS_ENABLE)
+#define EWFS_STATS_BUCKETS      24      //log2 buckets of core timer ticks
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+#ifndef EWFS_TRACE_ENTRIES
+#define EWFS_TRACE_ENTRIES      256     //events kept by the tracer, a power of 2
+#endif
+#define EWFS_TRACE_NO_FILE      0xFF    //file of events without a file object
+//text form of a trace event written by the ewfstrace command: time stamp,
+//type, file, hash, offset, length
+#define EWFS_TRACE_FORMAT       "T %08X %X %X %04X %08X %08X\r\n"
+#endif
+#if defined(EWFS_CHECKSUM_ENABLE)
+#ifndef EWFS_SCRUB_CHUNK
+#define EWFS_SCRUB_CHUNK        256     //bytes of the image the scrub reads at once
+#endif
+#define EWFS_SCRUB_INDEX        0xfffffffeu     //scrub entry of the header and index
+#endif
+#if defined(EWFS_STATS_ENABLE) || defined(EWFS_TRACE_ENABLE) || defined(EWFS_CHECKSUM_ENABLE)
+#define EWFS_COMMAND_ENABLE             //console commands
+#endif
 
 /******************************************************************************
  *                              TYPE DEFINES
@@ -49,9 +112,108 @@ typedef enum{
     EWFS_OK = 0,    //success
     EWFS_DISK_ERR,  //a hard error occurred in the low level disk I/O layer
     EWFS_NO_FILE,   //could not find the file   
-    EWFS_INVALID_PARAMETER  //given parameter is invalid
+    EWFS_INVALID_PARAMETER, //given parameter is invalid
+    EWFS_CHECKSUM_ERR       //data read from the media doesn't have the checksum of the image
 }ewfs_result_e;
 
+#if defined(EWFS_CHECKSUM_ENABLE)
+//check of an open file against the checksum in the image
+typedef enum{
+    EWFS_VERIFY_NONE = 0,   //the file isn't checked: generated, a template, empty or the
+                            //image has no checksums
+    EWFS_VERIFY_PENDING,    //the file is checked as it is read from the start
+    EWFS_VERIFY_OK,         //the data read matched the checksum
+    EWFS_VERIFY_FAILED      //the data read didn't match the checksum
+}ewfs_verify_e;
+
+//progress and results of the background scrub
+typedef struct{
+    uint32_t passes;        //complete passes over the image
+    uint32_t errors;        //index entries (or the index) that didn't match
+    uint32_t last_error;    //index entry of the last error, EWFS_SCRUB_INDEX for the
+                            //header and index, EWFS_INVALID if none
+    uint64_t bytes;         //bytes checked
+    uint32_t entry;         //index entry being checked, EWFS_SCRUB_INDEX for the
+                            //header and index
+    uint32_t offset;        //bytes of the entry checked
+    uint32_t crc;           //CRC of those bytes
+}ewfs_scrub_t;
+#endif
+
+#if defined(EWFS_STATS_ENABLE)
+//latency histogram in core timer ticks, bucket n counts 2^n to 2^(n+1) - 1
+//ticks (bucket 0 includes 0), the last bucket counts everything longer
+typedef struct{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t buckets[EWFS_STATS_BUCKETS];
+}ewfs_histogram_t;
+
+//runtime statistics since the last clear
+typedef struct{
+    uint32_t mounts;
+    uint32_t opens;             //successful opens
+    uint32_t open_misses;       //opens of files not in the image
+    uint32_t reads;             //EWFS_Read and EWFS_ReadPointer calls
+    uint64_t read_bytes;
+    uint32_t generated_reads;   //reads of generated files, included in reads
+    uint64_t generated_bytes;
+    uint32_t media_commands;    //media manager read commands
+    uint32_t media_errors;      //media manager read commands that failed
+    uint64_t media_bytes;
+    uint32_t mapped_reads;      //media reads served from mapped media without a command
+    uint32_t gen_cache_hits;    //opens of generated files served from the output cache
+    uint32_t gen_cache_misses;  //opens of cached generated files that ran the generator
+    uint32_t checksum_errors;   //files (or the index) that didn't match their checksum
+    ewfs_histogram_t open_ticks;
+    ewfs_histogram_t read_ticks;
+    ewfs_histogram_t media_ticks;   //EWFSDiskRead including the settling delays
+}ewfs_stats_t;
+#endif
+
+#if defined(EWFS_TRACE_ENABLE)
+typedef enum{
+    EWFS_TRACE_MOUNT = 0,   //offset 0, length of the header and index
+    EWFS_TRACE_OPEN,        //offset of the data in the media (EWFS_INVALID if
+                            //generated), length is the file size
+    EWFS_TRACE_OPEN_MISS,   //hash of the missing file
+    EWFS_TRACE_READ,        //position in the file, length read
+    EWFS_TRACE_SEEK,        //position after the seek, length is the seek offset
+    EWFS_TRACE_CLOSE        //position in the file
+}ewfs_trace_type_e;
+
+//trace event
+typedef struct{
+    uint32_t timestamp;     //core timer ticks
+    uint8_t type;           //ewfs_trace_type_e
+    uint8_t file;           //file object, EWFS_TRACE_NO_FILE if none
+    uint16_t hash;          //hash of the file path
+    uint32_t offset;
+    uint32_t length;
+}ewfs_trace_event_t;
+#endif
+
+//generated file callbacks, context is the pointer given at registration
+//return the size of the file in bytes, or EWFS_SIZE_UNKNOWN
+typedef uint32_t (*ewfs_gen_size_t)(void *context);
+//generate the next part of the file, up to max_size bytes continuing where the
+//last call stopped, state is EWFS_GEN_STATE_SIZE bytes of the open file
+//(zeroed at open, aligned for uint32_t), return the bytes put in the buffer,
+//0 at the end
+typedef uint32_t (*ewfs_gen_read_t)(void *context, void *state, uint32_t max_size,
+        uint8_t *buffer);
+//copy the live data the file is generated from into snapshot, EWFS_GEN_SNAPSHOT_SIZE
+//bytes aligned for uint32_t, when the file is opened
+typedef void (*ewfs_gen_snapshot_t)(void *context, void *snapshot);
+//template variable callback, put the value starting at offset in the buffer,
+//state is EWFS_GEN_STATE_SIZE bytes of the open file for this use of the
+//variable (zeroed when the value starts, aligned for uint32_t), return the
+//bytes put in the buffer, 0 at the end of the value
+typedef uint32_t (*ewfs_var_read_t)(void *context, void *state, uint32_t offset,
+        uint32_t max_size, uint8_t *buffer);
+
 extern const SYS_FS_FUNCTIONS EWFSFunctions;
 
 /******************************************************************************
@@ -65,5 +227,36 @@ int EWFS_Close(uintptr_t handle);
 uint32_t EWFS_GetSize(uintptr_t handle);
 uint32_t EWFS_GetPosition(uintptr_t handle);
 int EWFS_Seek(uintptr_t handle, uint32_t dwOffset);
+int EWFS_RegisterGeneratedFile(const char *path, ewfs_gen_size_t size, ewfs_gen_read_t read,
+        void *context, uint8_t flags);
+int EWFS_RegisterTemplateVariable(const char *name, ewfs_var_read_t read, void *context);
+void EWFS_GeneratedCheckpoint(void *state, uint32_t length);
+#if defined(EWFS_GEN_SNAPSHOT_ENABLE)
+int EWFS_SetGeneratedFileSnapshot(const char *path, ewfs_gen_snapshot_t snapshot);
+const void *EWFS_GeneratedSnapshot(void *state);
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE)
+int EWFS_SetGeneratedFileCache(const char *path, uint32_t ttl_ms);
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE) || defined(EWFS_GEN_CHECKPOINT_ENABLE)
+int EWFS_InvalidateGeneratedFile(const char *path);
+#endif
+#if defined(EWFS_MEDIA_IS_MAPPED)
+int EWFS_ReadPointer(uintptr_t handle, const void **data, uint32_t btr, uint32_t *br);
+#endif
+#if defined(EWFS_CHECKSUM_ENABLE)
+ewfs_verify_e EWFS_GetVerifyState(uintptr_t handle);
+int EWFS_Scrub(uint32_t max_bytes);
+int EWFS_GetScrubStatus(ewfs_scrub_t *status, bool clear);
+#endif
+#if defined(EWFS_STATS_ENABLE)
+int EWFS_GetStats(ewfs_stats_t *stats, bool clear);
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+uint32_t EWFS_TraceGet(ewfs_trace_event_t *events, uint32_t max_events, bool clear);
+#endif
+#if defined(EWFS_COMMAND_ENABLE)
+bool EWFS_CommandInit(void);
+#endif
 
 #endif /* _EWFS_H */
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_crc.h
+ *
+ * FILE DESCRIPTION:
+ * CRC32C (Castagnoli) of the file data and the index of an image.
+ *
+ * FILE NOTES:
+ * A CRC is started with 0 and continued by passing the result of the last
+ * call, so data can be checked in pieces as it is read.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _EWFS_CRC_H    /* Guard against multiple inclusion */
+#define _EWFS_CRC_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define EWFS_CRC_START          0           //CRC of no data
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+uint32_t EWFS_Crc32c(uint32_t crc, const void *data, uint32_t length);
+uint32_t EWFS_Crc32cSoftware(uint32_t crc, const void *data, uint32_t length);
+
+#endif /* _EWFS_CRC_H */
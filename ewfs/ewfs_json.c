@@ -0,0 +1,742 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_json.c
+ *
+ * FILE DESCRIPTION:
+ * Streaming JSON writer for the read callbacks of generated files.
+ *
+ * FILE NOTES:
+ * A read callback writes the document as a sequence of items, e.g. the
+ * start of an array, one element per item and the end of the array.  When
+ * the read buffer fills in the middle of an item the rest of the item is
+ * dropped and the bytes already written are kept in the state, the next
+ * read writes the item again and skips those bytes.  So only the item being
+ * written is generated twice and the output doesn't depend on the size of
+ * the reads.  Numbers are formatted without printf.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "ewfs_json.h"
+#include "ewfs.h"
+#include <string.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define EWFS_JSON_UINT_DIGITS   10      //digits of the largest uint32_t
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//the writer state is kept in the generator state of the open file
+typedef char ewfs_json_state_size_t[(sizeof(ewfs_json_state_t) <= EWFS_GEN_STATE_SIZE) ? 1 : -1];
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static void EWFSJsonPut(ewfs_json_t *json, const char *data, uint32_t length);
+static void EWFSJsonValue(ewfs_json_t *json);
+static void EWFSJsonOpen(ewfs_json_t *json, char bracket);
+static void EWFSJsonClose(ewfs_json_t *json, char bracket);
+static uint32_t EWFSJsonFormatUint(uint32_t value, char *text);
+
+/******************************************************************************
+ *                              VARIABLES
+ *****************************************************************************/
+//two digit pairs for formatting integers
+static const char ewfs_json_digits[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonStart
+ *
+ * DESCRIPTION:
+ * Start writing JSON into the read buffer of a generated file.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer, kept by the read callback
+ * state 		void *			state passed to the read callback
+ * buffer 		uint8_t *		buffer passed to the read callback
+ * max_size 	uint32_t		max_size passed to the read callback
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ * The writer uses the generator state as an ewfs_json_state_t, the read
+ * callback must not use the state for anything else.
+ *
+******************************************************************************/
+void EWFS_JsonStart(ewfs_json_t *json, void *state, uint8_t *buffer, uint32_t max_size){
+    json->state = (ewfs_json_state_t *) state;
+    json->buffer = buffer;
+    json->max_size = max_size;
+    json->length = 0;
+    json->position = 0;
+    json->commas = json->state->commas;
+    json->depth = json->state->depth;
+    json->key = json->state->key;
+    json->started = false;
+    json->full = (max_size == 0);
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonNext
+ *
+ * DESCRIPTION:
+ * Finish the item written and get the next item to write.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * item 		uint32_t *		returns the number of the item to write, 0 for
+ * 								the first item of the document
+ *
+ * RETURN VALUE:
+ * bool		true if the item is to be written, false when the buffer is full
+ *
+ * NOTES:
+ * The read callback writes the item and calls EWFS_JsonNext() again, and
+ * stops when it returns false or when there are no more items.  The number
+ * of an item must always give the same output while the file is open.
+ *
+******************************************************************************/
+bool EWFS_JsonNext(ewfs_json_t *json, uint32_t *item){
+    if (json->full == true){
+        return false;
+    }
+    if (json->started == true){
+        //the item is complete, the next read starts after it
+        json->state->item ++;
+        json->state->skip = 0;
+        json->state->commas = json->commas;
+        json->state->depth = json->depth;
+        json->state->key = json->key;
+        json->position = 0;
+        if (json->length == json->max_size){
+            return false;
+        }
+    }
+    json->started = true;
+    *item = json->state->item;
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonLength
+ *
+ * DESCRIPTION:
+ * Get the bytes put in the read buffer.
+ *
+ * PARAMETERS:
+ * json 		const ewfs_json_t *	writer
+ *
+ * RETURN VALUE:
+ * uint32_t		bytes put in the buffer, returned by the read callback
+ *
+ * NOTES:
+ *
+******************************************************************************/
+uint32_t EWFS_JsonLength(const ewfs_json_t *json){
+    return json->length;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonObjectStart
+ *
+ * DESCRIPTION:
+ * Write the start of an object.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonObjectStart(ewfs_json_t *json){
+    EWFSJsonOpen(json, '{');
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonObjectEnd
+ *
+ * DESCRIPTION:
+ * Write the end of an object.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonObjectEnd(ewfs_json_t *json){
+    EWFSJsonClose(json, '}');
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonArrayStart
+ *
+ * DESCRIPTION:
+ * Write the start of an array.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonArrayStart(ewfs_json_t *json){
+    EWFSJsonOpen(json, '[');
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonArrayEnd
+ *
+ * DESCRIPTION:
+ * Write the end of an array.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonArrayEnd(ewfs_json_t *json){
+    EWFSJsonClose(json, ']');
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonKey
+ *
+ * DESCRIPTION:
+ * Write the key of the next value of an object.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * key 			const char *	key, escaped as a string
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonKey(ewfs_json_t *json, const char *key){
+    EWFS_JsonString(json, key);
+    EWFSJsonPut(json, ":", 1);
+    json->key = true;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonString
+ *
+ * DESCRIPTION:
+ * Write a string value.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * string 		const char *	0 terminated string
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonString(ewfs_json_t *json, const char *string){
+    EWFS_JsonStringLength(json, string, strlen(string));
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonStringLength
+ *
+ * DESCRIPTION:
+ * Write a string value of a given length.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * string 		const char *	string, UTF-8
+ * length 		uint32_t		bytes of the string
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ * Quotes, backslashes and control characters are escaped, the runs of
+ * characters between them are copied as they are.  The string is checked
+ * 4 characters at a time and is not scanned past the end of the buffer.
+ *
+******************************************************************************/
+void EWFS_JsonStringLength(ewfs_json_t *json, const char *string, uint32_t length){
+    static const char hex[] = "0123456789abcdef";
+    char escape[6] = {'\\', 'u', '0', '0', 0, 0};
+    uint32_t run = 0;
+    uint32_t index = 0;
+    uint32_t word;
+    uint32_t quote;
+    uint32_t backslash;
+    uint8_t character;
+
+    EWFSJsonValue(json);
+    EWFSJsonPut(json, "\"", 1);
+    while (index < length){
+        if (length - index >= sizeof(word)){
+            //skip 4 characters at a time when none of them is escaped
+            memcpy(&word, &string[index], sizeof(word));
+            quote = word ^ 0x22222222u;
+            backslash = word ^ 0x5C5C5C5Cu;
+            if (((((word - 0x20202020u) & ~word) | ((quote - 0x01010101u) & ~quote) |
+                    ((backslash - 0x01010101u) & ~backslash)) & 0x80808080u) == 0){
+                index += sizeof(word);
+                continue;
+            }
+        }
+        character = (uint8_t) string[index ++];
+        if ((character >= 0x20) && (character != '"') && (character != '\\')){
+            continue;
+        }
+        EWFSJsonPut(json, &string[run], index - 1 - run);
+        run = index;
+        switch (character){
+            case '"':
+            case '\\':
+                escape[1] = character;
+                EWFSJsonPut(json, escape, 2);
+                break;
+            case '\n':
+                EWFSJsonPut(json, "\\n", 2);
+                break;
+            case '\r':
+                EWFSJsonPut(json, "\\r", 2);
+                break;
+            case '\t':
+                EWFSJsonPut(json, "\\t", 2);
+                break;
+            default:
+                escape[1] = 'u';
+                escape[4] = hex[character >> 4];
+                escape[5] = hex[character & 0x0F];
+                EWFSJsonPut(json, escape, 6);
+                break;
+        }
+        if (json->full == true){
+            return;
+        }
+    }
+    EWFSJsonPut(json, &string[run], length - run);
+    EWFSJsonPut(json, "\"", 1);
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonInt
+ *
+ * DESCRIPTION:
+ * Write a signed integer value.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * value 		int32_t			value
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonInt(ewfs_json_t *json, int32_t value){
+    char text[EWFS_JSON_UINT_DIGITS + 1];
+    uint32_t length = 0;
+
+    EWFSJsonValue(json);
+    if (value < 0){
+        text[length ++] = '-';
+    }
+    length += EWFSJsonFormatUint((value < 0) ? 0u - (uint32_t) value : (uint32_t) value,
+            &text[length]);
+    EWFSJsonPut(json, text, length);
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonUint
+ *
+ * DESCRIPTION:
+ * Write an unsigned integer value.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * value 		uint32_t		value
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonUint(ewfs_json_t *json, uint32_t value){
+    char text[EWFS_JSON_UINT_DIGITS];
+
+    EWFSJsonValue(json);
+    EWFSJsonPut(json, text, EWFSJsonFormatUint(value, text));
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonFloat
+ *
+ * DESCRIPTION:
+ * Write a floating point value with a fixed number of decimals.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * value 		float			value
+ * decimals 	uint8_t			digits after the point, at most
+ * 								EWFS_JSON_DECIMALS_MAX
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ * Values of 1e9 and more are written with an exponent.  NaN and infinity
+ * have no JSON number and are written as null.  Only float and integer
+ * arithmetic is used, so no double support is linked in.
+ *
+******************************************************************************/
+void EWFS_JsonFloat(ewfs_json_t *json, float value, uint8_t decimals){
+    char text[2 * EWFS_JSON_UINT_DIGITS + 6];
+    char fraction_text[EWFS_JSON_UINT_DIGITS];
+    uint32_t length = 0;
+    uint32_t scale = 1;
+    uint32_t whole;
+    uint32_t fraction;
+    uint32_t digits;
+    uint32_t exponent = 0;
+    uint32_t bits;
+    uint32_t mantissa;
+    uint32_t shift;
+    float rest;
+    uint8_t index;
+
+    EWFSJsonValue(json);
+    if ((value != value) || (value - value != 0.0f)){
+        EWFSJsonPut(json, "null", 4);
+        return;
+    }
+    if (decimals > EWFS_JSON_DECIMALS_MAX){
+        decimals = EWFS_JSON_DECIMALS_MAX;
+    }
+    if (value < 0.0f){
+        text[length ++] = '-';
+        value = -value;
+    }
+    if (value >= 1e9f){
+        while (value >= 10.0f){
+            value /= 10.0f;
+            exponent ++;
+        }
+    }
+    for (index = 0; index < decimals; index ++){
+        scale *= 10;
+    }
+    whole = (uint32_t) value;
+    //the part after the point is exact in float, take its mantissa and
+    //exponent so the scaling and rounding are done on integers, no double
+    rest = value - (float) whole;
+    memcpy(&bits, &rest, sizeof(bits));
+    mantissa = bits & 0x007fffff;
+    shift = 149;
+    if ((bits >> 23) != 0){
+        mantissa |= 0x00800000;
+        shift = 150 - (bits >> 23);
+    }
+    fraction = 0;
+    if (shift < 64){
+        fraction = (uint32_t) (((uint64_t) mantissa * scale + ((uint64_t) 1 << (shift - 1))) >> shift);
+    }
+    if (fraction >= scale){
+        //rounded up to the next whole number
+        whole ++;
+        fraction -= scale;
+    }
+    length += EWFSJsonFormatUint(whole, &text[length]);
+    if (decimals > 0){
+        text[length ++] = '.';
+        digits = EWFSJsonFormatUint(fraction, fraction_text);
+        memset(&text[length], '0', decimals - digits);
+        length += decimals - digits;
+        memcpy(&text[length], fraction_text, digits);
+        length += digits;
+    }
+    if (exponent > 0){
+        text[length ++] = 'e';
+        length += EWFSJsonFormatUint(exponent, &text[length]);
+    }
+    EWFSJsonPut(json, text, length);
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonBool
+ *
+ * DESCRIPTION:
+ * Write a true or false value.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * value 		bool			value
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonBool(ewfs_json_t *json, bool value){
+    EWFSJsonValue(json);
+    if (value == true){
+        EWFSJsonPut(json, "true", 4);
+    }else{
+        EWFSJsonPut(json, "false", 5);
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonNull
+ *
+ * DESCRIPTION:
+ * Write a null value.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+void EWFS_JsonNull(ewfs_json_t *json){
+    EWFSJsonValue(json);
+    EWFSJsonPut(json, "null", 4);
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_JsonRaw
+ *
+ * DESCRIPTION:
+ * Write data as it is, e.g. white space or a value formatted by the caller.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * data 		const char *	data
+ * length 		uint32_t		bytes of data
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ * No comma is written before the data.
+ *
+******************************************************************************/
+void EWFS_JsonRaw(ewfs_json_t *json, const char *data, uint32_t length){
+    EWFSJsonPut(json, data, length);
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSJsonPut
+ *
+ * DESCRIPTION:
+ * Put the next bytes of the item in the buffer.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * data 		const char *	bytes of the item
+ * length 		uint32_t		number of bytes
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ * Bytes already put in an earlier buffer are skipped.  When the buffer
+ * fills the bytes of the item written so far are kept in the state and the
+ * rest of the item is dropped.
+ *
+******************************************************************************/
+static void EWFSJsonPut(ewfs_json_t *json, const char *data, uint32_t length){
+    uint32_t start = 0;
+    uint32_t room;
+
+    if (json->full == true){
+        return;
+    }
+    if (json->position + length <= json->state->skip){
+        json->position += length;   //put in an earlier buffer
+        return;
+    }
+    if (json->position < json->state->skip){
+        start = json->state->skip - json->position;
+    }
+    room = json->max_size - json->length;
+    if (length - start > room){
+        memcpy(&json->buffer[json->length], &data[start], room);
+        json->length += room;
+        json->state->skip = json->position + start + room;
+        json->full = true;
+        return;
+    }
+    memcpy(&json->buffer[json->length], &data[start], length - start);
+    json->length += length - start;
+    json->position += length;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSJsonValue
+ *
+ * DESCRIPTION:
+ * Write the comma before a value when it is needed.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+static void EWFSJsonValue(ewfs_json_t *json){
+    if (json->key == true){
+        json->key = false;  //the value of a key
+        return;
+    }
+    if (json->depth > 0){
+        if ((json->commas & (1u << json->depth)) != 0){
+            EWFSJsonPut(json, ",", 1);
+        }else{
+            json->commas |= 1u << json->depth;
+        }
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSJsonOpen
+ *
+ * DESCRIPTION:
+ * Write the start of an object or an array.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * bracket 		char			'{' or '['
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ * Nesting deeper than EWFS_JSON_DEPTH_MAX is written but the commas of the
+ * deeper levels are not.
+ *
+******************************************************************************/
+static void EWFSJsonOpen(ewfs_json_t *json, char bracket){
+    EWFSJsonValue(json);
+    EWFSJsonPut(json, &bracket, 1);
+    if (json->depth < EWFS_JSON_DEPTH_MAX){
+        json->depth ++;
+        json->commas &= ~(1u << json->depth);
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSJsonClose
+ *
+ * DESCRIPTION:
+ * Write the end of an object or an array.
+ *
+ * PARAMETERS:
+ * json 		ewfs_json_t *	writer
+ * bracket 		char			'}' or ']'
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ *
+******************************************************************************/
+static void EWFSJsonClose(ewfs_json_t *json, char bracket){
+    EWFSJsonPut(json, &bracket, 1);
+    if (json->depth > 0){
+        json->depth --;
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSJsonFormatUint
+ *
+ * DESCRIPTION:
+ * Format an unsigned integer in decimal.
+ *
+ * PARAMETERS:
+ * value 		uint32_t	value
+ * text 		char *		buffer of EWFS_JSON_UINT_DIGITS characters, not 0
+ * 							terminated
+ *
+ * RETURN VALUE:
+ * uint32_t		number of characters
+ *
+ * NOTES:
+ * Two digits are formatted per division.
+ *
+******************************************************************************/
+static uint32_t EWFSJsonFormatUint(uint32_t value, char *text){
+    char digits[EWFS_JSON_UINT_DIGITS];
+    uint32_t index = EWFS_JSON_UINT_DIGITS;
+    uint32_t pair;
+
+    while (value >= 100){
+        pair = (value % 100) * 2;
+        value /= 100;
+        digits[-- index] = ewfs_json_digits[pair + 1];
+        digits[-- index] = ewfs_json_digits[pair];
+    }
+    if (value >= 10){
+        digits[-- index] = ewfs_json_digits[value * 2 + 1];
+        digits[-- index] = ewfs_json_digits[value * 2];
+    }else{
+        digits[-- index] = '0' + value;
+    }
+    memcpy(text, &digits[index], EWFS_JSON_UINT_DIGITS - index);
+    return EWFS_JSON_UINT_DIGITS - index;
+}
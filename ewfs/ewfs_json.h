@@ -0,0 +1,91 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_json.h
+ *
+ * FILE DESCRIPTION:
+ * Streaming JSON writer for the read callbacks of generated files.
+ *
+ * FILE NOTES:
+ * The writer puts the JSON straight into the read buffer of the generated
+ * file and keeps its position in the generator state, so a document can be
+ * larger than any read buffer and no memory is allocated.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _EWFS_JSON_H    /* Guard against multiple inclusion */
+#define _EWFS_JSON_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define EWFS_JSON_DEPTH_MAX     31      //nesting of objects and arrays
+#define EWFS_JSON_DECIMALS_MAX  9       //digits after the point of a float
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//position of the writer, kept in the generator state (zeroed at open) and
+//only changed at the start of an item
+typedef struct{
+    uint32_t item;          //item being written
+    uint32_t skip;          //bytes of the item put in earlier buffers
+    uint32_t commas;        //bit n set when depth n needs a comma before a value
+    uint8_t depth;          //open objects and arrays
+    bool key;               //a key was written, the value follows without a comma
+}ewfs_json_state_t;
+
+//writer of one read callback, kept on the stack of the callback
+typedef struct{
+    ewfs_json_state_t *state;
+    uint8_t *buffer;
+    uint32_t max_size;
+    uint32_t length;        //bytes put in the buffer
+    uint32_t position;      //bytes of the item generated, including skipped ones
+    uint32_t commas;
+    uint8_t depth;
+    bool key;
+    bool started;           //an item is being written
+    bool full;              //the buffer is full, the rest of the item is dropped
+}ewfs_json_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void EWFS_JsonStart(ewfs_json_t *json, void *state, uint8_t *buffer, uint32_t max_size);
+bool EWFS_JsonNext(ewfs_json_t *json, uint32_t *item);
+uint32_t EWFS_JsonLength(const ewfs_json_t *json);
+void EWFS_JsonObjectStart(ewfs_json_t *json);
+void EWFS_JsonObjectEnd(ewfs_json_t *json);
+void EWFS_JsonArrayStart(ewfs_json_t *json);
+void EWFS_JsonArrayEnd(ewfs_json_t *json);
+void EWFS_JsonKey(ewfs_json_t *json, const char *key);
+void EWFS_JsonString(ewfs_json_t *json, const char *string);
+void EWFS_JsonStringLength(ewfs_json_t *json, const char *string, uint32_t length);
+void EWFS_JsonInt(ewfs_json_t *json, int32_t value);
+void EWFS_JsonUint(ewfs_json_t *json, uint32_t value);
+void EWFS_JsonFloat(ewfs_json_t *json, float value, uint8_t decimals);
+void EWFS_JsonBool(ewfs_json_t *json, bool value);
+void EWFS_JsonNull(ewfs_json_t *json);
+void EWFS_JsonRaw(ewfs_json_t *json, const char *data, uint32_t length);
+
+#endif /* _EWFS_JSON_H */
@@ -0,0 +1,464 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_patch.c
+ *
+ * FILE DESCRIPTION:
+ * Streaming applier of the image deltas written by the generator.
+ *
+ * FILE NOTES:
+ * The delta (ewfs_generator -b BASE -d DELTA) is a header and the changed
+ * blocks of the image, each as the hashes of the block in the base image
+ * and in the new image and ranges of new bytes.  A block is read when its
+ * header is received, the ranges are copied into it as they arrive and it
+ * is written when its last range is in, after its hash was checked.  A block
+ * that already has the hash of the new image isn't written, so a patch that
+ * was interrupted can be given again from the start.  A block that has
+ * neither hash stops the patch before anything is written to it.
+ *
+ * The image must not be mounted while it is patched, EWFS_Mount() is called
+ * again when EWFS_PatchPut() returns EWFS_PATCH_DONE.  The callbacks take
+ * addresses from the start of the image.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "ewfs_patch.h"
+#include <string.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define EWFS_PATCH_START        "EWFD"
+#define EWFS_PATCH_VERSION      1
+#define EWFS_PATCH_END          0xffffffff  //block number that ends the delta
+#define EWFS_PATCH_HEADER_SIZE  17          //start, version, block size, base and image length
+#define EWFS_PATCH_BLOCK_SIZE   4           //block number
+#define EWFS_PATCH_RECORD_SIZE  10          //hashes of the block and number of ranges
+#define EWFS_PATCH_RANGE_SIZE   8           //offset and length of a range
+#define EWFS_PATCH_HASH_START   0x811c9dc5  //FNV-1a
+#define EWFS_PATCH_HASH_MULTIPLY    0x01000193
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//part of the delta being received
+typedef enum{
+    EWFS_PATCH_STATE_HEADER = 0,
+    EWFS_PATCH_STATE_BLOCK,
+    EWFS_PATCH_STATE_RECORD,
+    EWFS_PATCH_STATE_RANGE,
+    EWFS_PATCH_STATE_DATA,
+    EWFS_PATCH_STATE_END
+}ewfs_patch_state_e;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static bool EWFSPatchField(ewfs_patch_t *patch, const uint8_t **data, uint32_t *length, uint8_t size);
+static uint32_t EWFSPatchWord(const uint8_t *bytes, uint8_t size);
+static uint32_t EWFSPatchSpan(const ewfs_patch_t *patch, uint32_t image_length);
+static void EWFSPatchHeader(ewfs_patch_t *patch);
+static void EWFSPatchBlock(ewfs_patch_t *patch);
+static void EWFSPatchRecord(ewfs_patch_t *patch);
+static void EWFSPatchRange(ewfs_patch_t *patch);
+static void EWFSPatchRangeEnd(ewfs_patch_t *patch);
+
+/******************************************************************************
+ * FUNCTION:  EWFS_PatchStart
+ *
+ * DESCRIPTION:
+ * Start applying a delta to the image.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *			applier
+ * buffer 		uint8_t *				buffer of a block, at least the block size
+ * 										of the delta (the -e option of the
+ * 										generator, 4096 bytes by default)
+ * buffer_size 	uint32_t				size of the buffer
+ * read 		ewfs_patch_read_t		reads the image
+ * write 		ewfs_patch_write_t		erases and writes a block of the image
+ * context 		void *					passed to the callbacks
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+void EWFS_PatchStart(ewfs_patch_t *patch, uint8_t *buffer, uint32_t buffer_size,
+        ewfs_patch_read_t read, ewfs_patch_write_t write, void *context){
+    memset(patch, 0, sizeof(ewfs_patch_t));
+    patch->read = read;
+    patch->write = write;
+    patch->context = context;
+    patch->block = buffer;
+    patch->buffer_size = buffer_size;
+    patch->state = EWFS_PATCH_STATE_HEADER;
+    patch->result = EWFS_PATCH_MORE;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_PatchPut
+ *
+ * DESCRIPTION:
+ * Apply the next part of the delta.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *		applier
+ * data 		const uint8_t *		next bytes of the delta
+ * length 		uint32_t			number of bytes
+ *
+ * RETURN VALUE:
+ * ewfs_patch_result_e	EWFS_PATCH_MORE while the end of the delta wasn't
+ * 						received, EWFS_PATCH_DONE after it, otherwise the
+ * 						error that stopped the patch
+ *
+ * NOTES:
+ * The delta can be split anywhere.  The blocks are written from this call,
+ * so it takes as long as the erase and write of the blocks completed by the
+ * data.  After an error the result doesn't change, the blocks written before
+ * it are the blocks of the new image and the others are unchanged.
+ *
+******************************************************************************/
+ewfs_patch_result_e EWFS_PatchPut(ewfs_patch_t *patch, const uint8_t *data, uint32_t length){
+    uint32_t count;
+
+    while ((patch->result == EWFS_PATCH_MORE) && (length > 0)){
+        switch (patch->state){
+            case EWFS_PATCH_STATE_HEADER:
+                if (EWFSPatchField(patch, &data, &length, EWFS_PATCH_HEADER_SIZE) == true){
+                    EWFSPatchHeader(patch);
+                }
+                break;
+            case EWFS_PATCH_STATE_BLOCK:
+                if (EWFSPatchField(patch, &data, &length, EWFS_PATCH_BLOCK_SIZE) == true){
+                    EWFSPatchBlock(patch);
+                }
+                break;
+            case EWFS_PATCH_STATE_RECORD:
+                if (EWFSPatchField(patch, &data, &length, EWFS_PATCH_RECORD_SIZE) == true){
+                    EWFSPatchRecord(patch);
+                }
+                break;
+            case EWFS_PATCH_STATE_RANGE:
+                if (EWFSPatchField(patch, &data, &length, EWFS_PATCH_RANGE_SIZE) == true){
+                    EWFSPatchRange(patch);
+                }
+                break;
+            case EWFS_PATCH_STATE_DATA:
+                count = (length < patch->remaining) ? length : patch->remaining;
+                if (patch->patched == true){
+                    memcpy(&patch->block[patch->offset], data, count);
+                }
+                patch->offset += count;
+                patch->remaining -= count;
+                data += count;
+                length -= count;
+                if (patch->remaining == 0){
+                    EWFSPatchRangeEnd(patch);
+                }
+                break;
+            default:
+                length = 0;     //past the end of the delta
+                break;
+        }
+    }
+    return patch->result;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFS_PatchHash
+ *
+ * DESCRIPTION:
+ * Hash the bytes of a block of an image.
+ *
+ * PARAMETERS:
+ * data 		const uint8_t *		bytes
+ * length 		uint32_t			number of bytes
+ *
+ * RETURN VALUE:
+ * uint32_t		FNV-1a hash of the bytes
+ *
+ * NOTES:
+ * The same hash as the generator writes in the delta.
+ *
+******************************************************************************/
+uint32_t EWFS_PatchHash(const uint8_t *data, uint32_t length){
+    uint32_t hash = EWFS_PATCH_HASH_START;
+    uint32_t index;
+
+    for (index = 0; index < length; index ++){
+        hash = (hash ^ data[index]) * EWFS_PATCH_HASH_MULTIPLY;
+    }
+    return hash;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchField
+ *
+ * DESCRIPTION:
+ * Collect the bytes of a header of the delta.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *		applier
+ * data 		const uint8_t **	next bytes of the delta, moved past the
+ * 									bytes taken
+ * length 		uint32_t *			number of bytes, less the bytes taken
+ * size 		uint8_t				size of the header
+ *
+ * RETURN VALUE:
+ * bool		true when the header is complete, it is in patch->field
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+static bool EWFSPatchField(ewfs_patch_t *patch, const uint8_t **data, uint32_t *length, uint8_t size){
+    uint32_t count = size - patch->field_length;
+
+    if (count > *length){
+        count = *length;
+    }
+    memcpy(&patch->field[patch->field_length], *data, count);
+    patch->field_length += count;
+    *data += count;
+    *length -= count;
+    if (patch->field_length < size){
+        return false;
+    }
+    patch->field_length = 0;
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchWord
+ *
+ * DESCRIPTION:
+ * Get a word of a header, the delta is LSB first like the image.
+ *
+ * PARAMETERS:
+ * bytes 		const uint8_t *		first byte of the word
+ * size 		uint8_t				bytes of the word, up to 4
+ *
+ * RETURN VALUE:
+ * uint32_t		the word
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+static uint32_t EWFSPatchWord(const uint8_t *bytes, uint8_t size){
+    uint32_t word = 0;
+
+    while (size > 0){
+        size --;
+        word = (word << 8) | bytes[size];
+    }
+    return word;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchSpan
+ *
+ * DESCRIPTION:
+ * Get the bytes of the block being patched inside an image.
+ *
+ * PARAMETERS:
+ * patch 		const ewfs_patch_t *	applier
+ * image_length uint32_t				length of the base or the new image
+ *
+ * RETURN VALUE:
+ * uint32_t		bytes the hash of the block covers
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+static uint32_t EWFSPatchSpan(const ewfs_patch_t *patch, uint32_t image_length){
+    if (patch->address >= image_length){
+        return 0;
+    }
+    if (image_length - patch->address < patch->block_size){
+        return image_length - patch->address;
+    }
+    return patch->block_size;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchHeader
+ *
+ * DESCRIPTION:
+ * Check the header of the delta.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *		applier
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+static void EWFSPatchHeader(ewfs_patch_t *patch){
+    patch->block_size = EWFSPatchWord(&patch->field[5], 4);
+    patch->base_length = EWFSPatchWord(&patch->field[9], 4);
+    patch->image_length = EWFSPatchWord(&patch->field[13], 4);
+    if ((memcmp(patch->field, EWFS_PATCH_START, strlen(EWFS_PATCH_START)) != 0) ||
+            (patch->field[4] != EWFS_PATCH_VERSION) ||
+            (patch->block_size == 0) || (patch->block_size > patch->buffer_size)){
+        patch->result = EWFS_PATCH_FORMAT_ERR;
+        return;
+    }
+    patch->state = EWFS_PATCH_STATE_BLOCK;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchBlock
+ *
+ * DESCRIPTION:
+ * Start the next changed block, or end the delta.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *		applier
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+static void EWFSPatchBlock(ewfs_patch_t *patch){
+    uint32_t number = EWFSPatchWord(patch->field, 4);
+
+    if (number == EWFS_PATCH_END){
+        patch->state = EWFS_PATCH_STATE_END;
+        patch->result = EWFS_PATCH_DONE;
+        return;
+    }
+    if (number >= ((patch->image_length + patch->block_size - 1) / patch->block_size)){
+        patch->result = EWFS_PATCH_FORMAT_ERR;     //past the end of the new image
+        return;
+    }
+    patch->address = number * patch->block_size;
+    patch->state = EWFS_PATCH_STATE_RECORD;
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchRecord
+ *
+ * DESCRIPTION:
+ * Read the block being patched and check it against the hashes of the delta.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *		applier
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:
+ * The hashes only cover the bytes of the block inside each image.
+ *
+******************************************************************************/
+static void EWFSPatchRecord(ewfs_patch_t *patch){
+    uint32_t base_hash = EWFSPatchWord(patch->field, 4);
+
+    patch->image_hash = EWFSPatchWord(&patch->field[4], 4);
+    patch->ranges = EWFSPatchWord(&patch->field[8], 2);
+    if (patch->read(patch->context, patch->address, patch->block, patch->block_size) == false){
+        patch->result = EWFS_PATCH_DISK_ERR;
+        return;
+    }
+    if (EWFS_PatchHash(patch->block, EWFSPatchSpan(patch, patch->image_length)) == patch->image_hash){
+        patch->patched = false;     //written by an earlier run of the patch
+        patch->blocks_skipped ++;
+    }
+    else if (EWFS_PatchHash(patch->block, EWFSPatchSpan(patch, patch->base_length)) == base_hash){
+        patch->patched = true;
+    }
+    else{
+        patch->result = EWFS_PATCH_BASE_ERR;
+        return;
+    }
+    patch->state = EWFS_PATCH_STATE_RANGE;
+    if (patch->ranges == 0){
+        patch->ranges = 1;
+        EWFSPatchRangeEnd(patch);
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchRange
+ *
+ * DESCRIPTION:
+ * Start a range of new bytes of the block.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *		applier
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+static void EWFSPatchRange(ewfs_patch_t *patch){
+    patch->offset = EWFSPatchWord(patch->field, 4);
+    patch->remaining = EWFSPatchWord(&patch->field[4], 4);
+    if ((patch->offset > patch->block_size) || (patch->remaining > patch->block_size - patch->offset)){
+        patch->result = EWFS_PATCH_FORMAT_ERR;
+        return;
+    }
+    patch->state = EWFS_PATCH_STATE_DATA;
+    if (patch->remaining == 0){
+        EWFSPatchRangeEnd(patch);
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  EWFSPatchRangeEnd
+ *
+ * DESCRIPTION:
+ * End a range, after the last range of the block check it and write it.
+ *
+ * PARAMETERS:
+ * patch 		ewfs_patch_t *		applier
+ *
+ * RETURN VALUE:
+ * none
+ *
+ * NOTES:  None.
+ *
+******************************************************************************/
+static void EWFSPatchRangeEnd(ewfs_patch_t *patch){
+    patch->ranges --;
+    if (patch->ranges > 0){
+        patch->state = EWFS_PATCH_STATE_RANGE;
+        return;
+    }
+    patch->state = EWFS_PATCH_STATE_BLOCK;
+    if (patch->patched == false){
+        return;
+    }
+    if (EWFS_PatchHash(patch->block, EWFSPatchSpan(patch, patch->image_length)) != patch->image_hash){
+        patch->result = EWFS_PATCH_CHECK_ERR;
+        return;
+    }
+    if (patch->write(patch->context, patch->address, patch->block, patch->block_size) == false){
+        patch->result = EWFS_PATCH_DISK_ERR;
+        return;
+    }
+    patch->blocks_written ++;
+}
@@ -0,0 +1,94 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_patch.h
+ *
+ * FILE DESCRIPTION:
+ * Streaming applier of the image deltas written by the generator.
+ *
+ * FILE NOTES:
+ * The delta is given in pieces of any size as it is received, e.g. over the
+ * network, and each changed block of the image is read, patched and written
+ * back through callbacks, so the update only needs one block of memory and
+ * only the changed blocks are erased and written.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _EWFS_PATCH_H    /* Guard against multiple inclusion */
+#define _EWFS_PATCH_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define EWFS_PATCH_FIELD_MAX    17      //longest header of the delta, the delta header
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+typedef enum{
+    EWFS_PATCH_MORE = 0,    //the data was used, more of the delta is expected
+    EWFS_PATCH_DONE,        //the end of the delta was reached, the image is patched
+    EWFS_PATCH_FORMAT_ERR,  //the data isn't a delta, or its block is larger than the buffer
+    EWFS_PATCH_BASE_ERR,    //a block is neither the block of the base image nor of the new image
+    EWFS_PATCH_CHECK_ERR,   //a patched block doesn't have the hash of the new image
+    EWFS_PATCH_DISK_ERR     //the read or write callback failed
+}ewfs_patch_result_e;
+
+//read length bytes of the image at address, the bytes the image doesn't
+//have (past its end) can be anything
+typedef bool (*ewfs_patch_read_t)(void *context, uint32_t address, uint8_t *buffer, uint32_t length);
+//erase and write a block of the image
+typedef bool (*ewfs_patch_write_t)(void *context, uint32_t address, const uint8_t *buffer, uint32_t length);
+
+//applier of one delta
+typedef struct{
+    ewfs_patch_read_t read;
+    ewfs_patch_write_t write;
+    void *context;              //passed to the callbacks
+    uint8_t *block;             //buffer of the block being patched
+    uint32_t buffer_size;
+    uint32_t block_size;        //from the delta header
+    uint32_t base_length;       //length of the image before and after the patch
+    uint32_t image_length;
+    uint32_t address;           //address of the block being patched
+    uint32_t image_hash;        //hash of the block in the new image
+    uint32_t ranges;            //ranges of the block not received yet
+    uint32_t offset;            //position in the block of the next byte of the range
+    uint32_t remaining;         //bytes of the range not received yet
+    uint32_t blocks_written;
+    uint32_t blocks_skipped;    //blocks that already were the blocks of the new image
+    uint8_t field[EWFS_PATCH_FIELD_MAX];    //header being received
+    uint8_t field_length;
+    uint8_t state;
+    bool patched;               //the block is the block of the base image, it is written
+    ewfs_patch_result_e result;
+}ewfs_patch_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void EWFS_PatchStart(ewfs_patch_t *patch, uint8_t *buffer, uint32_t buffer_size,
+        ewfs_patch_read_t read, ewfs_patch_write_t write, void *context);
+ewfs_patch_result_e EWFS_PatchPut(ewfs_patch_t *patch, const uint8_t *data, uint32_t length);
+uint32_t EWFS_PatchHash(const uint8_t *data, uint32_t length);
+
+#endif /* _EWFS_PATCH_H */
@@ -0,0 +1,181 @@
+/******************************************************************************
+ * FILE NAME:  host_command.c
+ *
+ * FILE DESCRIPTION:
+ * Host (Linux) stand-in for the MPLAB Harmony command processor.  Command
+ * groups are registered the same way as on the target and run from the
+ * host tools with HOST_CommandExecute().
+ *
+ * FILE NOTES:
+ * Command output goes to stderr so it doesn't mix with file data written to
+ * stdout by the tools.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "system/command/sys_command.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define HOST_COMMAND_GROUPS     8
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//registered command group
+typedef struct{
+    const SYS_CMD_DESCRIPTOR *table;
+    int count;
+    const char *name;
+}host_command_group_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static void HostCommandMessage(const void *cmdIoParam, const char *str);
+static void HostCommandPrint(const void *cmdIoParam, const char *format, ...);
+
+/******************************************************************************
+ *                              VARIABLES
+ *****************************************************************************/
+static host_command_group_t host_command_groups[HOST_COMMAND_GROUPS];
+static const SYS_CMD_API host_command_api = {HostCommandMessage, HostCommandPrint};
+static SYS_CMD_DEVICE_NODE host_command_device = {&host_command_api, NULL};
+
+/******************************************************************************
+ * FUNCTION:  SYS_CMD_ADDGRP
+ *
+ * DESCRIPTION:
+ * Add a group of commands.
+ *
+ * PARAMETERS:
+ * pCmdTbl      const SYS_CMD_DESCRIPTOR *  table of commands
+ * nCmds        int                         number of commands in the table
+ * groupName    const char *                name of the group
+ * menuStr      const char *                description of the group (unused)
+ *
+ * RETURN VALUE:
+ * bool     true if the group was added, false if there is no room
+ *
+ * NOTES:
+ * Adding the same table again is not an error and doesn't add it twice.
+ *
+ *****************************************************************************/
+bool SYS_CMD_ADDGRP(const SYS_CMD_DESCRIPTOR *pCmdTbl, int nCmds, const char *groupName,
+        const char *menuStr){
+    uint32_t group;
+
+    (void) menuStr;
+    for (group = 0; group < HOST_COMMAND_GROUPS; group ++){
+        if (host_command_groups[group].table == pCmdTbl){
+            return true;
+        }
+        if (host_command_groups[group].table == NULL){
+            host_command_groups[group].table = pCmdTbl;
+            host_command_groups[group].count = nCmds;
+            host_command_groups[group].name = groupName;
+            return true;
+        }
+    }
+    return false;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_CommandExecute
+ *
+ * DESCRIPTION:
+ * Run a registered command.
+ *
+ * PARAMETERS:
+ * argc         int         number of arguments, including the command
+ * argv[]       char *      the command followed by its arguments
+ *
+ * RETURN VALUE:
+ * int      result of the command function, -1 if the command is not known
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+int HOST_CommandExecute(int argc, char *argv[]){
+    const SYS_CMD_DESCRIPTOR *command;
+    uint32_t group;
+    int index;
+
+    if (argc < 1){
+        return -1;
+    }
+    for (group = 0; (group < HOST_COMMAND_GROUPS) && (host_command_groups[group].table != NULL); group ++){
+        for (index = 0; index < host_command_groups[group].count; index ++){
+            command = &host_command_groups[group].table[index];
+            if (strcmp(command->cmdStr, argv[0]) == 0){
+                return command->cmdFnc(&host_command_device, argc, argv);
+            }
+        }
+    }
+    return -1;
+}
+
+/******************************************************************************
+ * FUNCTION:  HostCommandMessage
+ *
+ * DESCRIPTION:
+ * Write a string from a command.
+ *
+ * PARAMETERS:
+ * cmdIoParam   const void *    I/O device parameter (unused)
+ * str          const char *    string to write
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void HostCommandMessage(const void *cmdIoParam, const char *str){
+    (void) cmdIoParam;
+    fputs(str, stderr);
+}
+
+/******************************************************************************
+ * FUNCTION:  HostCommandPrint
+ *
+ * DESCRIPTION:
+ * Write formatted output from a command.
+ *
+ * PARAMETERS:
+ * cmdIoParam   const void *    I/O device parameter (unused)
+ * format       const char *    printf style format
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void HostCommandPrint(const void *cmdIoParam, const char *format, ...){
+    va_list args;
+
+    (void) cmdIoParam;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
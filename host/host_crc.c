@@ -0,0 +1,181 @@
+/******************************************************************************
+ * FILE NAME:  host_crc.c
+ *
+ * FILE DESCRIPTION:
+ * Host (Linux) hardware CRC32C used by the EWFS runtime in place of the CRC
+ * unit of the MCU.
+ *
+ * FILE NOTES:
+ * x86 uses the SSE4.2 crc32 instruction when the CPU has it, ARMv8 the CRC32
+ * extension when the compiler targets it.  Otherwise the runtime computes
+ * the CRC in software, as it does on an MCU without a CRC unit.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "host_port.h"
+#include <string.h>
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#if defined(__x86_64__) || defined(__i386__) || \
+        (defined(__aarch64__) && defined(__ARM_FEATURE_CRC32))
+#define HOST_CRC_HW                 //the host can have a CRC32C instruction
+#endif
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+#if defined(HOST_CRC_HW)
+static uint32_t HostCrc32cHw(uint32_t crc, const uint8_t *bytes, uint32_t length);
+#endif
+
+/******************************************************************************
+ *                              VARIABLES
+ *****************************************************************************/
+static bool host_crc_enabled = true;
+
+/******************************************************************************
+ * FUNCTION:  HOST_Crc32cEnable
+ *
+ * DESCRIPTION:
+ * Allow or stop the use of the CRC32C instruction.
+ *
+ * PARAMETERS:
+ * enable       bool        false to make the runtime compute the CRC in
+ *                          software
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Used by the benchmarks to measure the software CRC of an MCU without a
+ * CRC unit.
+ *
+ *****************************************************************************/
+void HOST_Crc32cEnable(bool enable){
+    host_crc_enabled = enable;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_Crc32c
+ *
+ * DESCRIPTION:
+ * Continue a CRC32C with the CRC32C instruction of the host.
+ *
+ * PARAMETERS:
+ * crc          uint32_t *      CRC of the data before, updated with the data
+ * data         const void *    data to add
+ * length       uint32_t        bytes of data
+ *
+ * RETURN VALUE:
+ * bool     true if the CRC was updated, false if the host has no CRC32C
+ *          instruction or it is disabled
+ *
+ * NOTES:
+ * This is EWFS_CRC32C_HW of the host, see ewfs_crc.c.
+ *
+ *****************************************************************************/
+bool HOST_Crc32c(uint32_t *crc, const void *data, uint32_t length){
+#if defined(HOST_CRC_HW)
+#if defined(__x86_64__) || defined(__i386__)
+    static int supported = -1;
+
+    if (supported < 0){
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+    }
+    if (supported == 0){
+        return false;
+    }
+#endif
+    if (host_crc_enabled){
+        *crc = ~HostCrc32cHw(~*crc, (const uint8_t *) data, length);
+        return true;
+    }
+#else
+    (void) crc;
+    (void) data;
+    (void) length;
+#endif
+    return false;
+}
+
+#if defined(HOST_CRC_HW)
+/******************************************************************************
+ * FUNCTION:  HostCrc32cHw
+ *
+ * DESCRIPTION:
+ * Add data to a CRC32C register with the CRC32C instruction.
+ *
+ * PARAMETERS:
+ * crc          uint32_t        CRC register (inverted CRC)
+ * bytes        const uint8_t * data to add
+ * length       uint32_t        bytes of data
+ *
+ * RETURN VALUE:
+ * uint32_t     CRC register after the data
+ *
+ * NOTES:
+ * Takes 8 bytes per instruction (4 on 32 bit x86), the words are copied so
+ * the data can have any alignment.
+ *
+ *****************************************************************************/
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t HostCrc32cHw(uint32_t crc, const uint8_t *bytes, uint32_t length){
+#if defined(__x86_64__) || defined(__aarch64__)
+    uint64_t word;
+
+    while (length >= sizeof(word)){
+        memcpy(&word, bytes, sizeof(word));
+#if defined(__x86_64__)
+        crc = (uint32_t) __builtin_ia32_crc32di(crc, word);
+#else
+        crc = __crc32cd(crc, word);
+#endif
+        bytes += sizeof(word);
+        length -= sizeof(word);
+    }
+#else
+    uint32_t word;
+
+    while (length >= sizeof(word)){
+        memcpy(&word, bytes, sizeof(word));
+        crc = __builtin_ia32_crc32si(crc, word);
+        bytes += sizeof(word);
+        length -= sizeof(word);
+    }
+#endif
+    while (length > 0){
+#if defined(__aarch64__)
+        crc = __crc32cb(crc, *bytes ++);
+#else
+        crc = __builtin_ia32_crc32qi(crc, *bytes ++);
+#endif
+        length --;
+    }
+    return crc;
+}
+#endif
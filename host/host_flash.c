@@ -0,0 +1,171 @@
+/******************************************************************************
+ * FILE NAME:  host_flash.c
+ *
+ * FILE DESCRIPTION:
+ * Timing model of serial (SQI) NOR flash devices and presets for common
+ * parts.
+ *
+ * FILE NOTES:
+ * The preset values are approximations from the data sheets at the maximum
+ * quad I/O clock plus an allowance of 2us per command for the PIC32 SQI
+ * driver and DMA descriptor setup.  Measure the target and adjust them when
+ * absolute numbers matter, relative comparisons don't depend on them.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "host_flash.h"
+#include <stddef.h>
+#include <string.h>
+
+/******************************************************************************
+ *                              VARIABLES
+ *****************************************************************************/
+static const host_flash_t host_flash_presets[] = {
+    //SST26VF032B, 104MHz SQI: 14 clock command/address/dummy, 4 bits per clock,
+    //18ms 4KB sector erase, 1.5ms page program
+    {"sst26vf032b", 2135, 52000000, 256, 0, 4096, 18000, 1500},
+    //W25Q64JV, 133MHz fast read quad I/O: 20 clock command/address/dummy,
+    //45ms 4KB sector erase, 0.4ms page program
+    {"w25q64jv", 2150, 66500000, 256, 0, 4096, 45000, 400},
+    //MX25L6433F, 133MHz QPI 4READ: 14 clock command/address/dummy, 40ms 4KB
+    //sector erase, 0.5ms page program
+    {"mx25l6433f", 2105, 66500000, 256, 0, 4096, 40000, 500},
+    //SST26VF032B behind a controller that splits transfers at the 256 byte
+    //page, each extra page costs a new command
+    {"sst26vf032b_paged", 2135, 52000000, 256, 2135, 4096, 18000, 1500},
+};
+
+/******************************************************************************
+ * FUNCTION:  HOST_FLASH_PresetGet
+ *
+ * DESCRIPTION:
+ * Return a flash preset by index, used to list the presets.
+ *
+ * PARAMETERS:
+ * index        uint32_t    index of the preset
+ *
+ * RETURN VALUE:
+ * const host_flash_t *     the preset, NULL past the last one
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+const host_flash_t *HOST_FLASH_PresetGet(uint32_t index){
+    if (index >= (sizeof(host_flash_presets) / sizeof(host_flash_presets[0]))){
+        return NULL;
+    }
+    return &host_flash_presets[index];
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_FLASH_PresetFind
+ *
+ * DESCRIPTION:
+ * Return a flash preset by name.
+ *
+ * PARAMETERS:
+ * name         const char *    name of the preset (part number)
+ *
+ * RETURN VALUE:
+ * const host_flash_t *     the preset, NULL if there is none with the name
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+const host_flash_t *HOST_FLASH_PresetFind(const char *name){
+    const host_flash_t *flash;
+    uint32_t index;
+
+    for (index = 0; (flash = HOST_FLASH_PresetGet(index)) != NULL; index ++){
+        if (strcmp(flash->name, name) == 0){
+            return flash;
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_FLASH_ReadTime
+ *
+ * DESCRIPTION:
+ * Return the time a read command takes on the flash device.
+ *
+ * PARAMETERS:
+ * flash        const host_flash_t *    flash timing
+ * address      uint32_t                start address of the read
+ * length       uint32_t                number of bytes read
+ *
+ * RETURN VALUE:
+ * uint64_t     read time in nanoseconds
+ *
+ * NOTES:
+ * time = setup + length / bandwidth + page boundaries crossed * penalty
+ *
+ *****************************************************************************/
+uint64_t HOST_FLASH_ReadTime(const host_flash_t *flash, uint32_t address, uint32_t length){
+    uint64_t time = flash->setup_ns;
+    uint64_t last;
+
+    if (length == 0){
+        return time;
+    }
+    time += (((uint64_t) length * 1000000000u) + flash->bytes_per_second - 1) / flash->bytes_per_second;
+    if (flash->page_size > 0){
+        last = (uint64_t) address + length - 1;
+        time += ((last / flash->page_size) - (address / flash->page_size)) * flash->page_cross_ns;
+    }
+    return time;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_FLASH_WriteTime
+ *
+ * DESCRIPTION:
+ * Return the time erasing and programming a part of the flash takes.
+ *
+ * PARAMETERS:
+ * flash        const host_flash_t *    flash timing
+ * address      uint32_t                start address of the write
+ * length       uint32_t                number of bytes written
+ *
+ * RETURN VALUE:
+ * uint64_t     write time in nanoseconds
+ *
+ * NOTES:
+ * time = sectors touched * erase + pages touched * program, the time to
+ * send the data is left out, the erase and program times are much longer.
+ *
+ *****************************************************************************/
+uint64_t HOST_FLASH_WriteTime(const host_flash_t *flash, uint32_t address, uint32_t length){
+    uint64_t last = (uint64_t) address + length - 1;
+    uint64_t time = 0;
+
+    if (length == 0){
+        return 0;
+    }
+    if (flash->sector_size > 0){
+        time += ((last / flash->sector_size) - (address / flash->sector_size) + 1) * flash->erase_us * 1000u;
+    }
+    if (flash->page_size > 0){
+        time += ((last / flash->page_size) - (address / flash->page_size) + 1) * flash->program_us * 1000u;
+    }
+    return time;
+}
@@ -0,0 +1,1047 @@
+/******************************************************************************
+ * FILE NAME:  host_media.c
+ *
+ * FILE DESCRIPTION:
+ * Host (Linux) stand-in for the Harmony media manager backed by an EWFS
+ * image file.
+ *
+ * FILE NOTES:
+ * With the HOST_MEDIA_PREAD backend the media address space starts at 0 so
+ * SYS_FS_MEDIA_MANAGER_AddressGet() returns 0 and the source pointers passed
+ * to SYS_FS_MEDIA_MANAGER_Read() are byte offsets into the image file.  With
+ * the HOST_MEDIA_MMAP backend the address space starts at the mapping.
+ *
+ * With the HOST_MEDIA_URING backends every SYS_FS_MEDIA_MANAGER_TransferTask()
+ * call submits all the queued commands with one io_uring_enter() and
+ * completes the commands whose reads have finished, in any order.  Reads go
+ * into registered (fixed) buffers, one per queue slot, which are aligned for
+ * O_DIRECT.
+ *
+ * HOST_MEDIA_CacheSet() puts a model of a read cache between the commands
+ * and the flash device: the commands still read the image, but only the
+ * blocks missing from the cache count as flash reads and device time, so
+ * the runtime can be measured with a cache it doesn't have.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#define _GNU_SOURCE     //O_DIRECT
+#include "host_media.h"
+#include "host_uring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define HOST_MEDIA_DISK_COUNT   SYS_FS_VOLUME_NUMBER
+#define HOST_MEDIA_MAKE_HANDLE(sequence, slot) \
+    ((SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE) (((uint32_t) (sequence) << 8) | (slot)))
+#define HOST_MEDIA_HANDLE_SLOT(handle)      ((handle) & 0xFF)
+#define HOST_MEDIA_HANDLE_SEQUENCE(handle)  (((handle) >> 8) & 0xFFFF)
+#define HOST_MEDIA_URING_BUFFER_SIZE    (64 * 1024)     //fixed buffer per slot
+#define HOST_MEDIA_URING_ALIGN          4096            //O_DIRECT alignment
+#define HOST_MEDIA_URING_DIRECT_FILE    0   //registered file of aligned reads
+#define HOST_MEDIA_URING_BUFFERED_FILE  1   //registered file of other reads
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//queued media command
+typedef struct{
+    SYS_FS_MEDIA_COMMAND_STATUS status;
+    uint16_t sequence;          //sequence number used to detect stale handles
+    bool busy;                  //slot holds a command that has not completed
+    uint32_t skip;              //bytes read ahead of address (O_DIRECT)
+    uint32_t done;              //bytes of the command read by earlier parts
+    uint32_t part;              //bytes of the command in the read in flight
+    bool fixed;                 //read into the slot's registered buffer
+    uint8_t *destination;       //buffer to read into
+    uint32_t address;           //media address to read from
+    uint32_t length;            //number of bytes to read
+}host_media_command_t;
+
+//io_uring state of a disk
+typedef struct{
+    host_uring_t ring;
+    int direct_fd;              //image opened with O_DIRECT, -1 if not used
+    uint8_t *buffers;           //registered buffers, one per queue slot
+    uint32_t in_flight;         //commands submitted and not completed
+}host_media_uring_t;
+
+//read cache model of a disk, LRU of whole blocks
+typedef struct{
+    uint32_t block_size;        //0 without a cache
+    uint32_t block_count;       //blocks in the cache
+    uint32_t use;               //LRU clock
+    uint32_t *blocks;           //block held by each entry, UINT32_MAX if none
+    uint32_t *last_use;         //LRU clock of the last use of each entry
+}host_media_cache_t;
+
+//attached disk
+typedef struct{
+    int fd;                     //image file descriptor, -1 when not attached
+    host_media_backend_e backend;
+    uint32_t size;              //size of the image in bytes
+    uint8_t *map;               //image mapping, NULL unless HOST_MEDIA_MMAP
+    host_media_uring_t *uring;  //NULL unless a HOST_MEDIA_URING backend
+    const host_flash_t *flash;  //flash timing model, NULL if not simulated
+    host_media_cache_t cache;   //read cache model
+    SYS_FS_MEDIA_REGION_GEOMETRY region;    //single read region of the image
+    SYS_FS_MEDIA_GEOMETRY geometry;
+    uint16_t sequence;          //next command sequence number
+    uint8_t next_slot;          //where to start looking for a free slot
+    uint8_t head;               //oldest command not passed to the backend
+    uint8_t count;              //number of commands not passed to the backend
+    uint8_t order[HOST_MEDIA_QUEUE_DEPTH];  //slots in the order they were queued
+    host_media_command_t queue[HOST_MEDIA_QUEUE_DEPTH];
+    host_media_stats_t stats;
+}host_media_t;
+
+/******************************************************************************
+ *                              VARIABLES
+ *****************************************************************************/
+static host_media_t host_media[HOST_MEDIA_DISK_COUNT] = {
+    [0 ... HOST_MEDIA_DISK_COUNT - 1] = {.fd = -1}
+};
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static host_media_t *HOSTMediaGet(uint16_t diskNo);
+static bool HOSTMediaTransfer(host_media_t *media, host_media_command_t *command);
+static void HOSTMediaCompleted(host_media_t *media, host_media_command_t *command);
+static void HOSTMediaFlashRead(host_media_t *media, uint32_t address, uint32_t length);
+static bool HOSTMediaCacheLookup(host_media_cache_t *cache, uint32_t block);
+static bool HOSTMediaUringOpen(host_media_t *media, const char *image_path);
+static void HOSTMediaUringClose(host_media_t *media);
+static void HOSTMediaUringTransfer(host_media_t *media);
+static bool HOSTMediaUringPrepare(host_media_t *media, uint8_t slot);
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_Attach
+ *
+ * DESCRIPTION:
+ * Attach an EWFS image file to a disk number.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t        disk number the image is mounted as
+ * image_path   const char *    path to the image file
+ * backend      host_media_backend_e    how the image is accessed
+ *
+ * RETURN VALUE:
+ * bool     true if the image was opened, otherwise false
+ *
+ * NOTES:
+ * Any image already attached to the disk is detached first.
+ *
+ *****************************************************************************/
+bool HOST_MEDIA_Attach(uint16_t diskNo, const char *image_path, host_media_backend_e backend){
+    host_media_t *media;
+    struct stat image_info;
+    uint8_t *map = NULL;
+    int fd;
+
+    if (diskNo >= HOST_MEDIA_DISK_COUNT){
+        return false;
+    }
+    HOST_MEDIA_Detach(diskNo);
+    fd = open(image_path, O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+    if ((fstat(fd, &image_info) != 0) || (image_info.st_size > UINT32_MAX)){
+        close(fd);
+        return false;   //EWFS addresses are 32 bits
+    }
+    if ((backend == HOST_MEDIA_MMAP) && (image_info.st_size > 0)){
+        map = mmap(NULL, (size_t) image_info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED){
+            close(fd);
+            return false;
+        }
+    }
+    media = &host_media[diskNo];
+    memset(media, 0, sizeof(host_media_t));
+    media->fd = fd;
+    media->backend = backend;
+    media->size = (uint32_t) image_info.st_size;
+    media->map = map;
+    media->sequence = 1;
+    if ((backend == HOST_MEDIA_URING) || (backend == HOST_MEDIA_URING_DIRECT)){
+        if (HOSTMediaUringOpen(media, image_path) == false){
+            close(fd);
+            media->fd = -1;
+            return false;
+        }
+    }
+    //the image is one read region of byte sized blocks
+    media->region.blockSize = 1;
+    media->region.numBlocks = media->size;
+    media->geometry.numReadRegions = 1;
+    media->geometry.geometryTable = &media->region;
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_Detach
+ *
+ * DESCRIPTION:
+ * Detach the image file from a disk number.  Commands still queued are lost.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+void HOST_MEDIA_Detach(uint16_t diskNo){
+    host_media_t *media = HOSTMediaGet(diskNo);
+
+    if (media == NULL){
+        return;
+    }
+    if (media->map != NULL){
+        munmap(media->map, media->size);
+    }
+    if (media->uring != NULL){
+        HOSTMediaUringClose(media);
+    }
+    HOST_MEDIA_CacheSet(diskNo, 0, 0);
+    close(media->fd);
+    memset(media, 0, sizeof(host_media_t));
+    media->fd = -1;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_SizeGet
+ *
+ * DESCRIPTION:
+ * Return the size of the image attached to a disk number.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ *
+ * RETURN VALUE:
+ * uint32_t     size of the image in bytes, 0 if not attached
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+uint32_t HOST_MEDIA_SizeGet(uint16_t diskNo){
+    host_media_t *media = HOSTMediaGet(diskNo);
+
+    return (media == NULL) ? 0 : media->size;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_StatsGet
+ *
+ * DESCRIPTION:
+ * Copy the media command counters of a disk.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t                disk number
+ * stats        host_media_stats_t *    destination of the counters
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+void HOST_MEDIA_StatsGet(uint16_t diskNo, host_media_stats_t *stats){
+    host_media_t *media = HOSTMediaGet(diskNo);
+
+    if (media == NULL){
+        memset(stats, 0, sizeof(host_media_stats_t));
+        return;
+    }
+    *stats = media->stats;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_StatsClear
+ *
+ * DESCRIPTION:
+ * Reset the media command counters of a disk.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+void HOST_MEDIA_StatsClear(uint16_t diskNo){
+    host_media_t *media = HOSTMediaGet(diskNo);
+
+    if (media != NULL){
+        memset(&media->stats, 0, sizeof(host_media_stats_t));
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_FlashSet
+ *
+ * DESCRIPTION:
+ * Set the flash timing model used to add up the simulated device time of
+ * the commands of a disk.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t                disk number
+ * flash        const host_flash_t *    flash timing, NULL to stop simulating
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The model is not copied and must stay valid while it is set.
+ *
+ *****************************************************************************/
+void HOST_MEDIA_FlashSet(uint16_t diskNo, const host_flash_t *flash){
+    host_media_t *media = HOSTMediaGet(diskNo);
+
+    if (media != NULL){
+        media->flash = flash;
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_CacheSet
+ *
+ * DESCRIPTION:
+ * Set the read cache model between the commands of a disk and the flash
+ * device.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ * cache_size   uint32_t    bytes of the cache, 0 to remove it
+ * block_size   uint32_t    bytes of the blocks read from the flash
+ *
+ * RETURN VALUE:
+ * bool     true if the cache is set, otherwise false
+ *
+ * NOTES:
+ * The cache starts empty.  A command reads the blocks it needs that aren't in
+ * the cache, consecutive missing blocks with one flash command, and the least
+ * recently used blocks are replaced.
+ *
+ *****************************************************************************/
+bool HOST_MEDIA_CacheSet(uint16_t diskNo, uint32_t cache_size, uint32_t block_size){
+    host_media_t *media = HOSTMediaGet(diskNo);
+    host_media_cache_t *cache;
+    uint32_t index;
+
+    if (media == NULL){
+        return false;
+    }
+    cache = &media->cache;
+    free(cache->blocks);
+    free(cache->last_use);
+    memset(cache, 0, sizeof(host_media_cache_t));
+    if (cache_size == 0){
+        return true;
+    }
+    if ((block_size == 0) || (block_size > cache_size)){
+        return false;
+    }
+    cache->block_count = cache_size / block_size;
+    cache->blocks = malloc(cache->block_count * sizeof(uint32_t));
+    cache->last_use = calloc(cache->block_count, sizeof(uint32_t));
+    if ((cache->blocks == NULL) || (cache->last_use == NULL)){
+        free(cache->blocks);
+        free(cache->last_use);
+        memset(cache, 0, sizeof(host_media_cache_t));
+        return false;
+    }
+    for (index = 0; index < cache->block_count; index ++){
+        cache->blocks[index] = UINT32_MAX;
+    }
+    cache->block_size = block_size;
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_IsMapped
+ *
+ * DESCRIPTION:
+ * Return if the image of a disk is mapped into memory and can be read
+ * directly from the address returned by SYS_FS_MEDIA_MANAGER_AddressGet().
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ *
+ * RETURN VALUE:
+ * bool     true if the image is mapped, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+bool HOST_MEDIA_IsMapped(uint16_t diskNo){
+    host_media_t *media = HOSTMediaGet(diskNo);
+
+    return (media != NULL) && (media->map != NULL);
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_MEDIA_AccessHint
+ *
+ * DESCRIPTION:
+ * Tell the kernel how a range of the image is about to be read so the page
+ * cache can read ahead for sequential access or avoid it for random access.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ * address      uint32_t    media address of the range (offset in the image)
+ * length       uint32_t    length of the range in bytes
+ * sequential   bool        true if the range is read from start to end,
+ *                          false if it is read at random positions
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Uses madvise() for a mapped image and posix_fadvise() otherwise.  Hints
+ * are advisory, failures are ignored.
+ *
+ *****************************************************************************/
+void HOST_MEDIA_AccessHint(uint16_t diskNo, uint32_t address, uint32_t length, bool sequential){
+    host_media_t *media = HOSTMediaGet(diskNo);
+    uintptr_t page_mask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t start;
+    uintptr_t end;
+
+    if ((media == NULL) || (address >= media->size) || (length == 0)){
+        return;
+    }
+    if (length > (media->size - address)){
+        length = media->size - address;
+    }
+    if (media->map == NULL){
+        posix_fadvise(media->fd, address, length,
+                sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+        if (sequential){
+            posix_fadvise(media->fd, address, length, POSIX_FADV_WILLNEED);
+        }
+        return;
+    }
+    //madvise() works on whole pages
+    start = ((uintptr_t) media->map + address) & ~page_mask;
+    end = (uintptr_t) media->map + address + length;
+    madvise((void *) start, end - start, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    if (sequential){
+        madvise((void *) start, end - start, MADV_WILLNEED);
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  SYS_FS_MEDIA_MANAGER_AddressGet
+ *
+ * DESCRIPTION:
+ * Return the start address of the media.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ *
+ * RETURN VALUE:
+ * uintptr_t    the address of the image mapping, 0 if the image is not
+ *              mapped and media addresses are offsets into the image file
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+uintptr_t SYS_FS_MEDIA_MANAGER_AddressGet(uint16_t diskNo){
+    host_media_t *media = HOSTMediaGet(diskNo);
+
+    return (media == NULL) ? 0 : (uintptr_t) media->map;
+}
+
+/******************************************************************************
+ * FUNCTION:  SYS_FS_MEDIA_MANAGER_GetMediaGeometry
+ *
+ * DESCRIPTION:
+ * Return the geometry of the media.
+ *
+ * PARAMETERS:
+ * diskNum      uint16_t    disk number
+ *
+ * RETURN VALUE:
+ * SYS_FS_MEDIA_GEOMETRY *  geometry of the image, NULL if not attached
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+SYS_FS_MEDIA_GEOMETRY *SYS_FS_MEDIA_MANAGER_GetMediaGeometry(uint16_t diskNum){
+    host_media_t *media = HOSTMediaGet(diskNum);
+
+    return (media == NULL) ? NULL : &media->geometry;
+}
+
+/******************************************************************************
+ * FUNCTION:  SYS_FS_MEDIA_MANAGER_Read
+ *
+ * DESCRIPTION:
+ * Queue a read command.  The data is transferred by later calls to
+ * SYS_FS_MEDIA_MANAGER_TransferTask().
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ * destination  uint8_t *   buffer to read the data into
+ * source       uint8_t *   media address to read from
+ * nBytes       uint32_t    number of bytes to read
+ *
+ * RETURN VALUE:
+ * SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE    handle of the queued command or
+ *                      SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID if the disk
+ *                      is not attached or the queue is full
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE SYS_FS_MEDIA_MANAGER_Read(uint16_t diskNo,
+        uint8_t *destination, uint8_t *source, const uint32_t nBytes){
+    host_media_t *media = HOSTMediaGet(diskNo);
+    host_media_command_t *command;
+    uint32_t count;
+    uint8_t slot = 0;
+
+    if (media == NULL){
+        return SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+    }
+    //find a free slot, starting after the last one used so the status of a
+    //completed command stays available as long as possible
+    for (count = 0; count < HOST_MEDIA_QUEUE_DEPTH; count ++){
+        slot = (media->next_slot + count) % HOST_MEDIA_QUEUE_DEPTH;
+        if (media->queue[slot].busy == false){
+            break;
+        }
+    }
+    if (count == HOST_MEDIA_QUEUE_DEPTH){
+        media->stats.rejected ++;
+        return SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID;
+    }
+    media->next_slot = (slot + 1) % HOST_MEDIA_QUEUE_DEPTH;
+    media->order[(media->head + media->count) % HOST_MEDIA_QUEUE_DEPTH] = slot;
+    command = &media->queue[slot];
+    command->status = SYS_FS_MEDIA_COMMAND_QUEUED;
+    command->busy = true;
+    command->sequence = media->sequence;
+    command->destination = destination;
+    command->address = (uint32_t) ((uintptr_t) source - (uintptr_t) media->map);
+    command->length = nBytes;
+    command->done = 0;
+    media->count ++;
+    media->stats.commands ++;
+    //skip 0 so a handle is never 0
+    media->sequence = (media->sequence == 0xFFFF) ? 1 : (media->sequence + 1);
+    return HOST_MEDIA_MAKE_HANDLE(command->sequence, slot);
+}
+
+/******************************************************************************
+ * FUNCTION:  SYS_FS_MEDIA_MANAGER_CommandStatusGet
+ *
+ * DESCRIPTION:
+ * Return the status of a queued command.
+ *
+ * PARAMETERS:
+ * diskNo           uint16_t    disk number
+ * commandHandle    SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE   command handle
+ *
+ * RETURN VALUE:
+ * SYS_FS_MEDIA_COMMAND_STATUS  status of the command, _UNKNOWN if the handle
+ *                              is not valid or the command failed
+ *
+ * NOTES:
+ * A completed command keeps its status until its queue slot is reused.
+ *
+ *****************************************************************************/
+SYS_FS_MEDIA_COMMAND_STATUS SYS_FS_MEDIA_MANAGER_CommandStatusGet(uint16_t diskNo,
+        SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE commandHandle){
+    host_media_t *media = HOSTMediaGet(diskNo);
+    host_media_command_t *command;
+    uint32_t slot = HOST_MEDIA_HANDLE_SLOT(commandHandle);
+
+    if ((media == NULL) || (commandHandle == SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID) ||
+            (slot >= HOST_MEDIA_QUEUE_DEPTH)){
+        return SYS_FS_MEDIA_COMMAND_UNKNOWN;
+    }
+    command = &media->queue[slot];
+    if (command->sequence != HOST_MEDIA_HANDLE_SEQUENCE(commandHandle)){
+        return SYS_FS_MEDIA_COMMAND_UNKNOWN;    //stale handle
+    }
+    return command->status;
+}
+
+/******************************************************************************
+ * FUNCTION:  SYS_FS_MEDIA_MANAGER_TransferTask
+ *
+ * DESCRIPTION:
+ * Advance the oldest command by one state: a queued command is started and a
+ * command in progress transfers its data and completes.
+ *
+ * PARAMETERS:
+ * mediaIndex   uint8_t     media index (same as the disk number)
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The io_uring backends submit every queued command and complete every
+ * finished read instead.
+ *
+ *****************************************************************************/
+void SYS_FS_MEDIA_MANAGER_TransferTask(uint8_t mediaIndex){
+    host_media_t *media = HOSTMediaGet(mediaIndex);
+    host_media_command_t *command;
+
+    if (media == NULL){
+        return;
+    }
+    if (media->uring != NULL){
+        HOSTMediaUringTransfer(media);
+        return;
+    }
+    if (media->count == 0){
+        return;
+    }
+    command = &media->queue[media->order[media->head]];
+    if (command->status == SYS_FS_MEDIA_COMMAND_QUEUED){
+        command->status = SYS_FS_MEDIA_COMMAND_IN_PROGRESS;
+        return;
+    }
+    if (HOSTMediaTransfer(media, command) == true){
+        HOSTMediaCompleted(media, command);
+    }else{
+        command->status = SYS_FS_MEDIA_COMMAND_UNKNOWN;
+        media->stats.errors ++;
+    }
+    command->busy = false;
+    media->head = (media->head + 1) % HOST_MEDIA_QUEUE_DEPTH;
+    media->count --;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaGet
+ *
+ * DESCRIPTION:
+ * Return the attached disk for a disk number.
+ *
+ * PARAMETERS:
+ * diskNo       uint16_t    disk number
+ *
+ * RETURN VALUE:
+ * host_media_t *   the disk, NULL if the number is invalid or not attached
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static host_media_t *HOSTMediaGet(uint16_t diskNo){
+    if ((diskNo >= HOST_MEDIA_DISK_COUNT) || (host_media[diskNo].fd < 0)){
+        return NULL;
+    }
+    return &host_media[diskNo];
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaTransfer
+ *
+ * DESCRIPTION:
+ * Read the data of a command from the image file.
+ *
+ * PARAMETERS:
+ * media        host_media_t *          attached disk
+ * command      host_media_command_t *  command to transfer
+ *
+ * RETURN VALUE:
+ * bool     true if all the data was read, otherwise false
+ *
+ * NOTES:
+ * Reading past the end of the image fails like a read past the end of the
+ * flash device.
+ *
+ *****************************************************************************/
+static bool HOSTMediaTransfer(host_media_t *media, host_media_command_t *command){
+    uint32_t done = 0;
+    ssize_t result;
+
+    if ((command->address > media->size) || (command->length > (media->size - command->address))){
+        return false;
+    }
+    if (media->map != NULL){
+        memcpy(command->destination, media->map + command->address, command->length);
+        return true;
+    }
+    while (done < command->length){
+        result = pread(media->fd, command->destination + done, command->length - done,
+                (off_t) command->address + done);
+        if (result <= 0){
+            return false;
+        }
+        done += (uint32_t) result;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaCompleted
+ *
+ * DESCRIPTION:
+ * Mark a command completed and count its bytes and simulated device time.
+ *
+ * PARAMETERS:
+ * media        host_media_t *          disk
+ * command      host_media_command_t *  command whose data was transferred
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void HOSTMediaCompleted(host_media_t *media, host_media_command_t *command){
+    command->status = SYS_FS_MEDIA_COMMAND_COMPLETED;
+    media->stats.bytes += command->length;
+    HOSTMediaFlashRead(media, command->address, command->length);
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaFlashRead
+ *
+ * DESCRIPTION:
+ * Count the flash reads of a command and their simulated device time.
+ *
+ * PARAMETERS:
+ * media        host_media_t *  disk
+ * address      uint32_t        media address of the command
+ * length       uint32_t        bytes of the command
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Without a read cache the command is one flash read.
+ *
+ *****************************************************************************/
+static void HOSTMediaFlashRead(host_media_t *media, uint32_t address, uint32_t length){
+    host_media_cache_t *cache = &media->cache;
+    uint32_t first_miss = UINT32_MAX;
+    uint32_t block;
+    uint32_t last;
+
+    if (length == 0){
+        return;
+    }
+    if (cache->block_size == 0){
+        media->stats.flash_commands ++;
+        media->stats.flash_bytes += length;
+        if (media->flash != NULL){
+            media->stats.device_ns += HOST_FLASH_ReadTime(media->flash, address, length);
+        }
+        return;
+    }
+    last = (uint32_t) (((uint64_t) address + length - 1) / cache->block_size);
+    for (block = address / cache->block_size; block <= last + 1; block ++){
+        if ((block <= last) && (HOSTMediaCacheLookup(cache, block) == false)){
+            media->stats.cache_misses ++;
+            if (first_miss == UINT32_MAX){
+                first_miss = block;
+            }
+            continue;
+        }
+        if (block <= last){
+            media->stats.cache_hits ++;
+        }
+        //read the run of missing blocks before this one
+        if (first_miss != UINT32_MAX){
+            media->stats.flash_commands ++;
+            media->stats.flash_bytes += (uint64_t) (block - first_miss) * cache->block_size;
+            if (media->flash != NULL){
+                media->stats.device_ns += HOST_FLASH_ReadTime(media->flash, first_miss * cache->block_size,
+                        (block - first_miss) * cache->block_size);
+            }
+            first_miss = UINT32_MAX;
+        }
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaCacheLookup
+ *
+ * DESCRIPTION:
+ * Look a block up in the read cache and add it when it is missing.
+ *
+ * PARAMETERS:
+ * cache        host_media_cache_t *    read cache model
+ * block        uint32_t                block number
+ *
+ * RETURN VALUE:
+ * bool     true if the block was in the cache, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static bool HOSTMediaCacheLookup(host_media_cache_t *cache, uint32_t block){
+    uint32_t oldest = 0;
+    uint32_t index;
+
+    cache->use ++;
+    for (index = 0; index < cache->block_count; index ++){
+        if (cache->blocks[index] == block){
+            cache->last_use[index] = cache->use;
+            return true;
+        }
+        if (cache->last_use[index] < cache->last_use[oldest]){
+            oldest = index;
+        }
+    }
+    cache->blocks[oldest] = block;
+    cache->last_use[oldest] = cache->use;
+    return false;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaUringOpen
+ *
+ * DESCRIPTION:
+ * Set up the io_uring backend of a disk: the ring, one registered buffer per
+ * queue slot and the registered image files.
+ *
+ * PARAMETERS:
+ * media        host_media_t *  disk being attached (fd, size and backend set)
+ * image_path   const char *    path to the image file, reopened for O_DIRECT
+ *
+ * RETURN VALUE:
+ * bool     true if the backend is ready, otherwise false
+ *
+ * NOTES:
+ * Without HOST_MEDIA_URING_DIRECT both registered files are the buffered
+ * image file.
+ *
+ *****************************************************************************/
+static bool HOSTMediaUringOpen(host_media_t *media, const char *image_path){
+    host_media_uring_t *uring;
+    struct iovec buffers[HOST_MEDIA_QUEUE_DEPTH];
+    int fds[2];
+    uint32_t slot;
+
+    uring = calloc(1, sizeof(host_media_uring_t));
+    if (uring == NULL){
+        return false;
+    }
+    media->uring = uring;
+    uring->ring.ring_fd = -1;
+    uring->direct_fd = -1;
+    if (media->backend == HOST_MEDIA_URING_DIRECT){
+        uring->direct_fd = open(image_path, O_RDONLY | O_DIRECT);
+        if (uring->direct_fd < 0){
+            HOSTMediaUringClose(media);
+            return false;   //the file system doesn't support O_DIRECT
+        }
+    }
+    uring->buffers = aligned_alloc(HOST_MEDIA_URING_ALIGN,
+            (size_t) HOST_MEDIA_URING_BUFFER_SIZE * HOST_MEDIA_QUEUE_DEPTH);
+    if ((uring->buffers == NULL) || (HOST_URING_Init(&uring->ring, HOST_MEDIA_QUEUE_DEPTH) == false)){
+        HOSTMediaUringClose(media);
+        return false;
+    }
+    for (slot = 0; slot < HOST_MEDIA_QUEUE_DEPTH; slot ++){
+        buffers[slot].iov_base = uring->buffers + ((size_t) slot * HOST_MEDIA_URING_BUFFER_SIZE);
+        buffers[slot].iov_len = HOST_MEDIA_URING_BUFFER_SIZE;
+    }
+    fds[HOST_MEDIA_URING_DIRECT_FILE] = (uring->direct_fd >= 0) ? uring->direct_fd : media->fd;
+    fds[HOST_MEDIA_URING_BUFFERED_FILE] = media->fd;
+    if ((HOST_URING_RegisterBuffers(&uring->ring, buffers, HOST_MEDIA_QUEUE_DEPTH) == false) ||
+            (HOST_URING_RegisterFiles(&uring->ring, fds, 2) == false)){
+        HOSTMediaUringClose(media);
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaUringClose
+ *
+ * DESCRIPTION:
+ * Release the io_uring backend of a disk.
+ *
+ * PARAMETERS:
+ * media        host_media_t *  disk
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Closing the ring cancels the reads still in flight.
+ *
+ *****************************************************************************/
+static void HOSTMediaUringClose(host_media_t *media){
+    host_media_uring_t *uring = media->uring;
+
+    if (uring->ring.ring_fd >= 0){
+        HOST_URING_Exit(&uring->ring);
+    }
+    if (uring->direct_fd >= 0){
+        close(uring->direct_fd);
+    }
+    free(uring->buffers);
+    free(uring);
+    media->uring = NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaUringPrepare
+ *
+ * DESCRIPTION:
+ * Prepare the submission queue entry of a queued command, or of the next part
+ * of a command split into several reads.
+ *
+ * PARAMETERS:
+ * media        host_media_t *  disk
+ * slot         uint8_t         queue slot of the command
+ *
+ * RETURN VALUE:
+ * bool     true if the read was prepared, false if the command fails
+ *
+ * NOTES:
+ * A read that fits its registered buffer uses IORING_OP_READ_FIXED, rounded
+ * out to the O_DIRECT alignment for HOST_MEDIA_URING_DIRECT.  A larger read
+ * goes straight into the destination through the buffered image file, with
+ * HOST_MEDIA_URING_DIRECT it is split into reads of the registered buffer
+ * size instead so it stays O_DIRECT.
+ *
+ *****************************************************************************/
+static bool HOSTMediaUringPrepare(host_media_t *media, uint8_t slot){
+    host_media_uring_t *uring = media->uring;
+    host_media_command_t *command = &media->queue[slot];
+    struct io_uring_sqe *sqe;
+    uint64_t start = (uint64_t) command->address + command->done;
+    uint64_t end = (uint64_t) command->address + command->length;
+
+    if ((command->address > media->size) || (command->length > (media->size - command->address))){
+        return false;
+    }
+    if (uring->direct_fd >= 0){
+        start &= ~((uint64_t) HOST_MEDIA_URING_ALIGN - 1);
+        end = (end + HOST_MEDIA_URING_ALIGN - 1) & ~((uint64_t) HOST_MEDIA_URING_ALIGN - 1);
+        if ((end - start) > HOST_MEDIA_URING_BUFFER_SIZE){
+            end = start + HOST_MEDIA_URING_BUFFER_SIZE;     //aligned, the buffer size is
+        }
+    }
+    sqe = HOST_URING_GetSqe(&uring->ring);
+    if (sqe == NULL){
+        return false;   //can't happen, the ring has a entry per slot
+    }
+    command->skip = (uint32_t) ((uint64_t) command->address + command->done - start);
+    command->fixed = (end - start) <= HOST_MEDIA_URING_BUFFER_SIZE;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->user_data = slot;
+    if (command->fixed){
+        command->part = (uint32_t) (end - start) - command->skip;
+        if (command->part > (command->length - command->done)){
+            command->part = command->length - command->done;
+        }
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->fd = HOST_MEDIA_URING_DIRECT_FILE;
+        sqe->addr = (uintptr_t) (uring->buffers + ((size_t) slot * HOST_MEDIA_URING_BUFFER_SIZE));
+        sqe->len = (uint32_t) (end - start);
+        sqe->off = start;
+        sqe->buf_index = slot;
+    }else{
+        command->skip = 0;
+        command->part = command->length;
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = HOST_MEDIA_URING_BUFFERED_FILE;
+        sqe->addr = (uintptr_t) command->destination;
+        sqe->len = command->length;
+        sqe->off = command->address;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOSTMediaUringTransfer
+ *
+ * DESCRIPTION:
+ * Submit all the queued commands of a disk in one batch and complete the
+ * commands whose reads have finished.
+ *
+ * PARAMETERS:
+ * media        host_media_t *  disk
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * Never waits: commands still in flight stay SYS_FS_MEDIA_COMMAND_IN_PROGRESS
+ * until a later call finds their completion.  The next part of a split read
+ * is submitted by the next call.
+ *
+ *****************************************************************************/
+static void HOSTMediaUringTransfer(host_media_t *media){
+    host_media_uring_t *uring = media->uring;
+    host_media_command_t *command;
+    struct io_uring_cqe *cqe;
+    bool read_ok;
+    uint8_t slot;
+
+    while (media->count > 0){
+        slot = media->order[media->head];
+        command = &media->queue[slot];
+        media->head = (media->head + 1) % HOST_MEDIA_QUEUE_DEPTH;
+        media->count --;
+        if (HOSTMediaUringPrepare(media, slot) == true){
+            command->status = SYS_FS_MEDIA_COMMAND_IN_PROGRESS;
+            uring->in_flight ++;
+        }else{
+            command->status = SYS_FS_MEDIA_COMMAND_UNKNOWN;
+            command->busy = false;
+            media->stats.errors ++;
+        }
+    }
+    if (HOST_URING_Submit(&uring->ring, 0) < 0){
+        return;     //entries stay in the ring and are submitted next time
+    }
+    while ((cqe = HOST_URING_PeekCqe(&uring->ring)) != NULL){
+        slot = (uint8_t) cqe->user_data;
+        command = &media->queue[slot];
+        read_ok = (cqe->res >= 0) && ((uint32_t) cqe->res >= (command->skip + command->part));
+        HOST_URING_CqeSeen(&uring->ring);
+        if (read_ok){
+            if (command->fixed){
+                memcpy(command->destination + command->done, uring->buffers +
+                        ((size_t) slot * HOST_MEDIA_URING_BUFFER_SIZE) + command->skip,
+                        command->part);
+            }
+            command->done += command->part;
+            if ((command->done < command->length) && (HOSTMediaUringPrepare(media, slot) == true)){
+                continue;   //the next part of a split read is in flight
+            }
+        }
+        if (read_ok && (command->done == command->length)){
+            HOSTMediaCompleted(media, command);
+        }else{
+            command->status = SYS_FS_MEDIA_COMMAND_UNKNOWN;
+            media->stats.errors ++;
+        }
+        command->busy = false;
+        uring->in_flight --;
+    }
+}
@@ -0,0 +1,150 @@
+/******************************************************************************
+ * FILE NAME:  host_port.c
+ *
+ * FILE DESCRIPTION:
+ * Host (Linux) implementation of the console and core timer services used by
+ * the EWFS runtime.
+ *
+ * FILE NOTES:  None.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "host_port.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define HOST_NS_PER_CORE_TICK   (1000000000u / HOST_CORE_TIMER_FREQUENCY)
+
+/******************************************************************************
+ *                              VARIABLES
+ *****************************************************************************/
+static bool host_console_enabled = false;
+static uint64_t host_core_timer_start = 0;
+
+/******************************************************************************
+ * FUNCTION:  HOST_ConsoleEnable
+ *
+ * DESCRIPTION:
+ * Enable or disable the console output of the runtime.
+ *
+ * PARAMETERS:
+ * enable       bool        true to print console messages to stdout
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The console is disabled by default so mounting large images doesn't print
+ * the whole file index.
+ *
+ *****************************************************************************/
+void HOST_ConsoleEnable(bool enable){
+    host_console_enabled = enable;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_ConsolePrint
+ *
+ * DESCRIPTION:
+ * Print a formatted message to the console (stdout) when enabled.
+ *
+ * PARAMETERS:
+ * format       const char *    printf style format string
+ * ...                          format arguments
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+void HOST_ConsolePrint(const char *format, ...){
+    va_list args;
+
+    if (!host_console_enabled){
+        return;
+    }
+    va_start(args, format);
+    vfprintf(stdout, format, args);
+    va_end(args);
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_TimeNanoseconds
+ *
+ * DESCRIPTION:
+ * Return a monotonic time stamp in nanoseconds.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:
+ * uint64_t     monotonic time in nanoseconds
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+uint64_t HOST_TimeNanoseconds(void){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000u) + (uint64_t) now.tv_nsec;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_CoreTimerRead
+ *
+ * DESCRIPTION:
+ * Return the core timer count, equivalent to reading CP0 register 9.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:
+ * uint32_t     ticks since the last HOST_CoreTimerStart()
+ *
+ * NOTES:
+ * Like the hardware counter the value wraps at 32 bits.
+ *
+ *****************************************************************************/
+uint32_t HOST_CoreTimerRead(void){
+    return (uint32_t) ((HOST_TimeNanoseconds() - host_core_timer_start) / HOST_NS_PER_CORE_TICK);
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_CoreTimerStart
+ *
+ * DESCRIPTION:
+ * Reset the core timer count to 0, equivalent to writing CP0 registers 9 and
+ * 11.
+ *
+ * PARAMETERS:
+ * period       uint32_t    compare period (unused, there is no interrupt)
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+void HOST_CoreTimerStart(uint32_t period){
+    (void) period;
+    host_core_timer_start = HOST_TimeNanoseconds();
+}
@@ -0,0 +1,273 @@
+/******************************************************************************
+ * FILE NAME:  host_uring.c
+ *
+ * FILE DESCRIPTION:
+ * Minimal io_uring wrapper used by the host media stand-in.
+ *
+ * FILE NOTES:
+ * Single threaded use only: one caller prepares entries, submits and reaps
+ * completions.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "host_uring.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define HOST_URING_LOAD(ptr)            __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define HOST_URING_STORE(ptr, value)    __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_Init
+ *
+ * DESCRIPTION:
+ * Create an io_uring instance and map its rings.
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *  ring to initialize
+ * entries      unsigned        number of submission queue entries
+ *
+ * RETURN VALUE:
+ * bool     true if the ring was created, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+bool HOST_URING_Init(host_uring_t *ring, unsigned entries){
+    struct io_uring_params params;
+    uint8_t *sq;
+    uint8_t *cq;
+
+    memset(ring, 0, sizeof(host_uring_t));
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->ring_fd < 0){
+        return false;
+    }
+    ring->sq_length = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+    ring->cq_length = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    ring->sqes_length = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sq_ptr = mmap(NULL, ring->sq_length, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    ring->cq_ptr = mmap(NULL, ring->cq_length, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_length, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+    if ((ring->sq_ptr == MAP_FAILED) || (ring->cq_ptr == MAP_FAILED) || (ring->sqes == MAP_FAILED)){
+        HOST_URING_Exit(ring);
+        return false;
+    }
+    sq = ring->sq_ptr;
+    ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+    cq = ring->cq_ptr;
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_Exit
+ *
+ * DESCRIPTION:
+ * Unmap the rings and close the io_uring instance.
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *  ring to release
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+void HOST_URING_Exit(host_uring_t *ring){
+    if ((ring->sqes != NULL) && (ring->sqes != MAP_FAILED)){
+        munmap(ring->sqes, ring->sqes_length);
+    }
+    if ((ring->cq_ptr != NULL) && (ring->cq_ptr != MAP_FAILED)){
+        munmap(ring->cq_ptr, ring->cq_length);
+    }
+    if ((ring->sq_ptr != NULL) && (ring->sq_ptr != MAP_FAILED)){
+        munmap(ring->sq_ptr, ring->sq_length);
+    }
+    if (ring->ring_fd >= 0){
+        close(ring->ring_fd);
+    }
+    memset(ring, 0, sizeof(host_uring_t));
+    ring->ring_fd = -1;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_RegisterBuffers
+ *
+ * DESCRIPTION:
+ * Register buffers for IORING_OP_READ_FIXED so the kernel pins them once
+ * instead of mapping them for every read.
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *          ring
+ * buffers      const struct iovec *    buffers to register
+ * count        unsigned                number of buffers
+ *
+ * RETURN VALUE:
+ * bool     true if the buffers were registered, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+bool HOST_URING_RegisterBuffers(host_uring_t *ring, const struct iovec *buffers, unsigned count){
+    return syscall(__NR_io_uring_register, ring->ring_fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_RegisterFiles
+ *
+ * DESCRIPTION:
+ * Register file descriptors used with IOSQE_FIXED_FILE.
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *  ring
+ * fds          const int *     file descriptors to register
+ * count        unsigned        number of file descriptors
+ *
+ * RETURN VALUE:
+ * bool     true if the files were registered, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+bool HOST_URING_RegisterFiles(host_uring_t *ring, const int *fds, unsigned count){
+    return syscall(__NR_io_uring_register, ring->ring_fd, IORING_REGISTER_FILES, fds, count) == 0;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_GetSqe
+ *
+ * DESCRIPTION:
+ * Return the next free submission queue entry, cleared.
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *  ring
+ *
+ * RETURN VALUE:
+ * struct io_uring_sqe *    entry to fill in, NULL if the queue is full
+ *
+ * NOTES:
+ * The entry is passed to the kernel by the next HOST_URING_Submit().
+ *
+ *****************************************************************************/
+struct io_uring_sqe *HOST_URING_GetSqe(host_uring_t *ring){
+    unsigned head = HOST_URING_LOAD(ring->sq_head);
+    unsigned index;
+    struct io_uring_sqe *sqe;
+
+    if ((ring->sq_local_tail - head) >= ring->sq_entries){
+        return NULL;
+    }
+    index = ring->sq_local_tail & *ring->sq_mask;
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local_tail ++;
+    return sqe;
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_Submit
+ *
+ * DESCRIPTION:
+ * Pass all the prepared entries to the kernel with one system call and
+ * optionally wait for completions.
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *  ring
+ * wait_count   unsigned        number of completions to wait for
+ *
+ * RETURN VALUE:
+ * int      number of entries submitted, negative on error
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+int HOST_URING_Submit(host_uring_t *ring, unsigned wait_count){
+    unsigned submit = ring->sq_local_tail - *ring->sq_tail;
+
+    if ((submit == 0) && (wait_count == 0)){
+        return 0;
+    }
+    HOST_URING_STORE(ring->sq_tail, ring->sq_local_tail);
+    return (int) syscall(__NR_io_uring_enter, ring->ring_fd, submit, wait_count,
+            (wait_count > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_PeekCqe
+ *
+ * DESCRIPTION:
+ * Return the oldest completion without waiting.
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *  ring
+ *
+ * RETURN VALUE:
+ * struct io_uring_cqe *    completion, NULL if there is none
+ *
+ * NOTES:
+ * Call HOST_URING_CqeSeen() once the completion has been handled.
+ *
+ *****************************************************************************/
+struct io_uring_cqe *HOST_URING_PeekCqe(host_uring_t *ring){
+    unsigned head = *ring->cq_head;
+
+    if (head == HOST_URING_LOAD(ring->cq_tail)){
+        return NULL;
+    }
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+/******************************************************************************
+ * FUNCTION:  HOST_URING_CqeSeen
+ *
+ * DESCRIPTION:
+ * Release the completion returned by HOST_URING_PeekCqe().
+ *
+ * PARAMETERS:
+ * ring         host_uring_t *  ring
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+void HOST_URING_CqeSeen(host_uring_t *ring){
+    HOST_URING_STORE(ring->cq_head, *ring->cq_head + 1);
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * FILE NAME:  host_uring.h
+ *
+ * FILE DESCRIPTION:
+ * Minimal io_uring wrapper used by the host media stand-in.
+ *
+ * FILE NOTES:
+ * Uses the io_uring system calls directly so the host build does not depend
+ * on liburing.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _HOST_URING_H    /* Guard against multiple inclusion */
+#define _HOST_URING_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//submission and completion rings shared with the kernel
+typedef struct{
+    int ring_fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned sq_local_tail;     //entries prepared but not submitted yet
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_length;
+    void *cq_ptr;
+    size_t cq_length;
+    size_t sqes_length;
+}host_uring_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+bool HOST_URING_Init(host_uring_t *ring, unsigned entries);
+void HOST_URING_Exit(host_uring_t *ring);
+bool HOST_URING_RegisterBuffers(host_uring_t *ring, const struct iovec *buffers, unsigned count);
+bool HOST_URING_RegisterFiles(host_uring_t *ring, const int *fds, unsigned count);
+struct io_uring_sqe *HOST_URING_GetSqe(host_uring_t *ring);
+int HOST_URING_Submit(host_uring_t *ring, unsigned wait_count);
+struct io_uring_cqe *HOST_URING_PeekCqe(host_uring_t *ring);
+void HOST_URING_CqeSeen(host_uring_t *ring);
+
+#endif /* _HOST_URING_H */
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * FILE NAME:  host_flash.h
+ *
+ * FILE DESCRIPTION:
+ * Timing model of a serial (SQI) NOR flash device used by the host media
+ * stand-in to report the time reads would take on the target, and by the
+ * host tools for the time writes would take.
+ *
+ * FILE NOTES:
+ * The model is virtual time only, nothing is delayed, so results are the
+ * same on every host.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _HOST_FLASH_H    /* Guard against multiple inclusion */
+#define _HOST_FLASH_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//timing of the flash read, erase and program commands
+typedef struct{
+    const char *name;
+    uint32_t setup_ns;          //per command: driver, opcode, address and dummy cycles
+    uint32_t bytes_per_second;  //data phase bandwidth
+    uint32_t page_size;         //page size in bytes, 0 if reads don't care
+    uint32_t page_cross_ns;     //penalty for each page boundary a read crosses
+    uint32_t sector_size;       //smallest erase in bytes
+    uint32_t erase_us;          //typical sector erase time
+    uint32_t program_us;        //typical page program time
+}host_flash_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+const host_flash_t *HOST_FLASH_PresetGet(uint32_t index);
+const host_flash_t *HOST_FLASH_PresetFind(const char *name);
+uint64_t HOST_FLASH_ReadTime(const host_flash_t *flash, uint32_t address, uint32_t length);
+uint64_t HOST_FLASH_WriteTime(const host_flash_t *flash, uint32_t address, uint32_t length);
+
+#endif /* _HOST_FLASH_H */
@@ -0,0 +1,94 @@
+/******************************************************************************
+ * FILE NAME:  host_media.h
+ *
+ * FILE DESCRIPTION:
+ * Host (Linux) stand-in for the Harmony media manager.  An EWFS image file is
+ * attached to a disk number and read through the same queued command
+ * interface the SQI flash driver provides on the target.
+ *
+ * FILE NOTES:
+ * Commands move through SYS_FS_MEDIA_COMMAND_QUEUED, _IN_PROGRESS and
+ * _COMPLETED, one state per SYS_FS_MEDIA_MANAGER_TransferTask() call, the
+ * same way the block driver state machine advances on the target.
+ *
+ * The HOST_MEDIA_MMAP backend maps the image into memory.  The runtime then
+ * reads it directly like SQI flash in XIP mode (see EWFS_MEDIA_IS_MAPPED).
+ * The HOST_MEDIA_URING backends keep commands queued by many file handles in
+ * flight at the same time and complete them asynchronously.
+ *
+ * A flash timing model can be set on a disk with HOST_MEDIA_FlashSet() to
+ * add up the time every completed command would take on the flash device.
+ * Reads of a mapped image don't go through commands and are not counted.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _HOST_MEDIA_H    /* Guard against multiple inclusion */
+#define _HOST_MEDIA_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "system_config.h"
+#include "system/fs/sys_fs_media_manager.h"
+#include "host_flash.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define HOST_MEDIA_QUEUE_DEPTH      64  //commands that can be queued per disk
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//how the image file is accessed
+typedef enum{
+    HOST_MEDIA_PREAD = 0,       //read with pread() when a command transfers
+    HOST_MEDIA_MMAP,            //map the image, the runtime reads it directly
+    HOST_MEDIA_URING,           //batch the queued reads through io_uring
+    HOST_MEDIA_URING_DIRECT     //as HOST_MEDIA_URING with O_DIRECT aligned reads
+}host_media_backend_e;
+
+//media command counters
+typedef struct{
+    uint32_t commands;          //read commands queued
+    uint32_t rejected;          //read commands rejected (queue full)
+    uint32_t errors;            //read commands that failed
+    uint64_t bytes;             //bytes read from the image
+    uint64_t device_ns;         //simulated flash device time (HOST_MEDIA_FlashSet)
+    uint32_t flash_commands;    //reads of the flash device, one per run of missing
+                                //blocks with a read cache (HOST_MEDIA_CacheSet)
+    uint64_t flash_bytes;       //bytes read from the flash device
+    uint32_t cache_hits;        //blocks found in the read cache
+    uint32_t cache_misses;      //blocks read from the flash into the read cache
+}host_media_stats_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+bool HOST_MEDIA_Attach(uint16_t diskNo, const char *image_path, host_media_backend_e backend);
+void HOST_MEDIA_Detach(uint16_t diskNo);
+uint32_t HOST_MEDIA_SizeGet(uint16_t diskNo);
+void HOST_MEDIA_StatsGet(uint16_t diskNo, host_media_stats_t *stats);
+void HOST_MEDIA_StatsClear(uint16_t diskNo);
+bool HOST_MEDIA_IsMapped(uint16_t diskNo);
+void HOST_MEDIA_FlashSet(uint16_t diskNo, const host_flash_t *flash);
+bool HOST_MEDIA_CacheSet(uint16_t diskNo, uint32_t cache_size, uint32_t block_size);
+void HOST_MEDIA_AccessHint(uint16_t diskNo, uint32_t address, uint32_t length, bool sequential);
+
+#endif /* _HOST_MEDIA_H */
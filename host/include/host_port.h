@@ -0,0 +1,55 @@
+/******************************************************************************
+ * FILE NAME:  host_port.h
+ *
+ * FILE DESCRIPTION:
+ * Host (Linux) replacements for the PIC32 specific services used by the EWFS
+ * runtime: the console and the CP0 core timer.
+ *
+ * FILE NOTES:
+ * The core timer runs at HOST_CORE_TIMER_FREQUENCY to match a PIC32MZ running
+ * at 200MHz (core timer at half the system clock) so tick counts and delay
+ * values have the same meaning on the host and the target.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _HOST_PORT_H    /* Guard against multiple inclusion */
+#define _HOST_PORT_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define HOST_CORE_TIMER_FREQUENCY   100000000u  //ticks per second
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void HOST_ConsoleEnable(bool enable);
+void HOST_ConsolePrint(const char *format, ...) __attribute__((format(printf, 1, 2)));
+int HOST_CommandExecute(int argc, char *argv[]);
+uint32_t HOST_CoreTimerRead(void);
+void HOST_CoreTimerStart(uint32_t period);
+uint64_t HOST_TimeNanoseconds(void);
+bool HOST_Crc32c(uint32_t *crc, const void *data, uint32_t length);
+void HOST_Crc32cEnable(bool enable);
+
+#endif /* _HOST_PORT_H */
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * FILE NAME:  sys_command.h
+ *
+ * FILE DESCRIPTION:
+ * Host stand-in for the MPLAB Harmony command processor header.
+ *
+ * FILE NOTES:
+ * Console output is routed to HOST_ConsolePrint() which is silent unless
+ * enabled with HOST_ConsoleEnable().  Command groups added with
+ * SYS_CMD_ADDGRP() are run with HOST_CommandExecute() and print to stderr.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _SYS_COMMAND_H    /* Guard against multiple inclusion */
+#define _SYS_COMMAND_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "host_port.h"
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define SYS_CONSOLE_PRINT(fmt, ...)     HOST_ConsolePrint(fmt, ##__VA_ARGS__)
+#define SYS_CONSOLE_MESSAGE(message)    HOST_ConsolePrint("%s", message)
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+typedef struct SYS_CMD_DEVICE_NODE SYS_CMD_DEVICE_NODE;
+
+typedef int (*SYS_CMD_FNC)(SYS_CMD_DEVICE_NODE *pCmdIO, int argc, char **argv);
+typedef void (*SYS_CMD_MSG_FNC)(const void *cmdIoParam, const char *str);
+typedef void (*SYS_CMD_PRINT_FNC)(const void *cmdIoParam, const char *format, ...);
+
+//command table entry
+typedef struct{
+    const char *cmdStr;
+    SYS_CMD_FNC cmdFnc;
+    const char *cmdDescr;
+}SYS_CMD_DESCRIPTOR;
+
+//output functions of a command I/O device, only the ones commands print with
+typedef struct{
+    SYS_CMD_MSG_FNC msg;
+    SYS_CMD_PRINT_FNC print;
+}SYS_CMD_API;
+
+struct SYS_CMD_DEVICE_NODE{
+    const SYS_CMD_API *pCmdApi;
+    const void *cmdIoParam;
+};
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+bool SYS_CMD_ADDGRP(const SYS_CMD_DESCRIPTOR *pCmdTbl, int nCmds, const char *groupName,
+        const char *menuStr);
+
+#endif /* _SYS_COMMAND_H */
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * FILE NAME:  sys_fs.h
+ *
+ * FILE DESCRIPTION:
+ * Host stand-in for the MPLAB Harmony file system service header.  Only the
+ * native file system function table used to register EWFS is provided.
+ *
+ * FILE NOTES:
+ * The member names and signatures follow the Harmony SYS_FS_FUNCTIONS table
+ * so the EWFSFunctions initializer in ewfs.c compiles unchanged.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _SYS_FS_H    /* Guard against multiple inclusion */
+#define _SYS_FS_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//native file system function table registered with SYS_FS
+typedef struct{
+    int (*mount)(uint8_t vol);
+    int (*unmount)(uint8_t vol);
+    int (*open)(uintptr_t handle, const char *path, uint8_t mode);
+    int (*read)(uintptr_t fp, void *buff, uint32_t btr, uint32_t *br);
+    int (*write)(uintptr_t fp, const void *buff, uint32_t btw, uint32_t *bw);
+    int (*close)(uintptr_t fp);
+    int (*seek)(uintptr_t handle, uint32_t offset);
+    uint32_t (*tell)(uintptr_t handle);
+    bool (*eof)(uintptr_t handle);
+    uint32_t (*size)(uintptr_t handle);
+    int (*fstat)(const char *path, uintptr_t fno);
+    int (*mkdir)(const char *path);
+    int (*chdir)(const char *path);
+    int (*remove)(const char *path);
+    int (*getlabel)(const char *path, char *buff, uint32_t *sn);
+    int (*setlabel)(const char *label);
+    int (*truncate)(uintptr_t handle);
+    int (*currWD)(char *buff, uint32_t len);
+    int (*chdrive)(uint8_t drive);
+    int (*chmode)(const char *path, uint8_t attr, uint8_t mask);
+    int (*chtime)(const char *path, uintptr_t ptr);
+    int (*rename)(const char *oldName, const char *newName);
+    int (*sync)(uintptr_t fp);
+    char *(*getstrn)(char *buff, int len, uintptr_t handle);
+    int (*putchr)(char c, uintptr_t handle);
+    int (*putstrn)(const char *str, uintptr_t handle);
+    int (*formattedprint)(uintptr_t handle, const char *str, va_list argList);
+    bool (*testerror)(uintptr_t handle);
+    int (*formatDisk)(uint8_t vol, uint8_t sfd, uint32_t au);
+    int (*openDir)(uintptr_t handle, const char *path);
+    int (*readDir)(uintptr_t handle, uintptr_t stat);
+    int (*closeDir)(uintptr_t handle);
+    int (*partitionDisk)(uint8_t pdrv, const uint32_t szt[], void *work);
+    int (*getCluster)(const char *path, uint32_t *tot_sec, uint32_t *free_sec);
+}SYS_FS_FUNCTIONS;
+
+#endif /* _SYS_FS_H */
@@ -0,0 +1,80 @@
+/******************************************************************************
+ * FILE NAME:  sys_fs_media_manager.h
+ *
+ * FILE DESCRIPTION:
+ * Host stand-in for the MPLAB Harmony file system media manager header.
+ *
+ * FILE NOTES:
+ * The media manager functions are implemented by host_media.c using an
+ * image file in place of the SQI flash.  Status values match Harmony.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _SYS_FS_MEDIA_MANAGER_H    /* Guard against multiple inclusion */
+#define _SYS_FS_MEDIA_MANAGER_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE_INVALID   ((SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE) -1)
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+typedef uintptr_t SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE;
+
+//geometry of one region (read, write or erase) of the media
+typedef struct{
+    uint32_t blockSize;         //size of a block in bytes
+    uint32_t numBlocks;         //number of blocks in the region
+}SYS_FS_MEDIA_REGION_GEOMETRY;
+
+//geometry of the media
+typedef struct{
+    uint32_t mediaProperty;
+    uint32_t numReadRegions;
+    uint32_t numWriteRegions;
+    uint32_t numEraseRegions;
+    SYS_FS_MEDIA_REGION_GEOMETRY *geometryTable;    //read regions first
+}SYS_FS_MEDIA_GEOMETRY;
+
+//status of a media command
+typedef enum{
+    SYS_FS_MEDIA_COMMAND_UNKNOWN = -1,  //command handle is not valid or failed
+    SYS_FS_MEDIA_COMMAND_COMPLETED = 0, //command is completed
+    SYS_FS_MEDIA_COMMAND_QUEUED = 1,    //command is queued but not started
+    SYS_FS_MEDIA_COMMAND_IN_PROGRESS = 2    //command is being processed
+}SYS_FS_MEDIA_COMMAND_STATUS;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+uintptr_t SYS_FS_MEDIA_MANAGER_AddressGet(uint16_t diskNo);
+SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE SYS_FS_MEDIA_MANAGER_Read(uint16_t diskNo,
+        uint8_t *destination, uint8_t *source, const uint32_t nBytes);
+SYS_FS_MEDIA_COMMAND_STATUS SYS_FS_MEDIA_MANAGER_CommandStatusGet(uint16_t diskNo,
+        SYS_FS_MEDIA_BLOCK_COMMAND_HANDLE commandHandle);
+void SYS_FS_MEDIA_MANAGER_TransferTask(uint8_t mediaIndex);
+SYS_FS_MEDIA_GEOMETRY *SYS_FS_MEDIA_MANAGER_GetMediaGeometry(uint16_t diskNum);
+
+#endif /* _SYS_FS_MEDIA_MANAGER_H */
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * FILE NAME:  system_config.h
+ *
+ * FILE DESCRIPTION:
+ * Host (Linux) system configuration used in place of the MPLAB Harmony
+ * generated system_config.h so the EWFS runtime can be built on a
+ * workstation.
+ *
+ * FILE NOTES:
+ * Only the configuration values referenced by the EWFS runtime are defined.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#ifndef _SYSTEM_CONFIG_H    /* Guard against multiple inclusion */
+#define _SYSTEM_CONFIG_H
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "host_port.h"
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+//file system service configuration
+#ifndef SYS_FS_MAX_FILES
+#define SYS_FS_MAX_FILES            10
+#endif
+#ifndef SYS_FS_VOLUME_NUMBER
+#define SYS_FS_VOLUME_NUMBER        1
+#endif
+#define SYS_FS_MEDIA_NUMBER         1
+#define SYS_FS_MEDIA_MAX_BLOCK_SIZE 4096
+
+//EWFS media options, the host media stand-in can map the image into memory
+#define EWFS_MEDIA_IS_MAPPED(disk)  HOST_MEDIA_IsMapped(disk)
+#define EWFS_MEDIA_ACCESS_HINT(disk, address, length, sequential) \
+    HOST_MEDIA_AccessHint(disk, address, length, sequential)
+//page of the simulated flash presets, see host_flash.c
+#ifndef EWFS_MEDIA_PAGE_SIZE
+#define EWFS_MEDIA_PAGE_SIZE        256
+#endif
+//CRC32C instruction of the host in place of the CRC unit of the MCU
+#define EWFS_CRC32C_HW(crc, data, length)   HOST_Crc32c(crc, data, length)
+//EWFS_STATS_ENABLE (runtime statistics), EWFS_TRACE_ENABLE (event tracer) and
+//EWFS_CHECKSUM_ENABLE (file checksums) are set by the EWFS_STATS, EWFS_TRACE
+//and EWFS_CHECKSUM CMake options, the host keeps a longer trace for the
+//replay tool
+#define EWFS_TRACE_ENTRIES          16384
+//RAM for memoized generated file output, see EWFS_SetGeneratedFileCache()
+#ifndef EWFS_GEN_CACHE_SIZE
+#define EWFS_GEN_CACHE_SIZE         65536
+#endif
+//seek checkpoints of each generated file, see EWFS_GeneratedCheckpoint()
+#ifndef EWFS_GEN_CHECKPOINTS
+#define EWFS_GEN_CHECKPOINTS        16
+#endif
+//snapshot buffers of generated files, see EWFS_SetGeneratedFileSnapshot()
+#ifndef EWFS_GEN_SNAPSHOTS
+#define EWFS_GEN_SNAPSHOTS          4
+#endif
+#ifndef EWFS_GEN_SNAPSHOT_SIZE
+#define EWFS_GEN_SNAPSHOT_SIZE      1024
+#endif
+
+#include "host_media.h"
+
+#endif /* _SYSTEM_CONFIG_H */
@@ -0,0 +1,69 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - delta to ewfs_patch round trip
+#
+# Builds a base image, changes the tree (an edit, a growth, an addition and a
+# removal) and builds the new image on the base with a delta.  ewfs_patch
+# must turn a copy of the base image into the new image, also when the delta
+# is given again after a transfer cut in the middle and when the image is
+# already patched.  A delta given to an image that isn't its base must be
+# rejected.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+ewfs_test_start()
+foreach(index RANGE 1 40)
+    math(EXPR size "${index} * 700")
+    ewfs_test_file("${WORK_DIR}/tree/file${index}.htm" ${size} ${index})
+endforeach()
+ewfs_test_run("generator base" COMMAND "${EWFS_GENERATOR}" -f -c -i tree -o base.bin)
+
+# the update: an edit of the same length, a growth, an addition and a removal
+ewfs_test_file("${WORK_DIR}/tree/file5.htm" 3500 100)
+ewfs_test_file("${WORK_DIR}/tree/file20.htm" 20000 20)
+ewfs_test_file("${WORK_DIR}/tree/added.htm" 5000 41)
+file(REMOVE "${WORK_DIR}/tree/file33.htm")
+ewfs_test_run("generator delta" COMMAND "${EWFS_GENERATOR}" -f -c -b base.bin -d update.delta
+    -i tree -o new.bin)
+
+# a copy of the base image becomes the new image
+ewfs_test_copy(base.bin patched.bin)
+ewfs_test_run("ewfs_patch" COMMAND "${EWFS_PATCH}" -c 100 patched.bin update.delta)
+ewfs_test_same("patched image" "${WORK_DIR}/patched.bin" "${WORK_DIR}/new.bin")
+ewfs_test_run("ewfs_cat -c patched" COMMAND "${EWFS_CAT}" -c patched.bin)
+
+# the delta again on the patched image changes nothing
+ewfs_test_run("ewfs_patch again" COMMAND "${EWFS_PATCH}" patched.bin update.delta)
+ewfs_test_same("patched twice" "${WORK_DIR}/patched.bin" "${WORK_DIR}/new.bin")
+
+# a transfer cut in the middle, then the whole delta from the start
+file(SIZE "${WORK_DIR}/update.delta" delta_size)
+math(EXPR cut "${delta_size} / 2")
+ewfs_test_copy(update.delta cut.delta)
+ewfs_test_run("cut delta" COMMAND "${EWFS_TEST_EDIT}" cut.delta truncate ${cut})
+ewfs_test_copy(base.bin restarted.bin)
+ewfs_test_run("ewfs_patch cut delta" FAIL COMMAND "${EWFS_PATCH}" restarted.bin cut.delta)
+if(NOT RUN_ERROR MATCHES "ends early")
+    message(FATAL_ERROR "ewfs_patch cut delta: ${RUN_ERROR}")
+endif()
+file(SHA256 "${WORK_DIR}/restarted.bin" cut_hash)
+file(SHA256 "${WORK_DIR}/base.bin" base_hash)
+if(cut_hash STREQUAL base_hash)
+    message(FATAL_ERROR "ewfs_patch cut delta: no block was patched before the cut")
+endif()
+ewfs_test_run("ewfs_patch restart" COMMAND "${EWFS_PATCH}" restarted.bin update.delta)
+ewfs_test_same("restarted image" "${WORK_DIR}/restarted.bin" "${WORK_DIR}/new.bin")
+
+# an image that isn't the base, one file of the base tree has other data
+foreach(index RANGE 1 40)
+    math(EXPR size "${index} * 700")
+    ewfs_test_file("${WORK_DIR}/other/file${index}.htm" ${size} ${index})
+endforeach()
+ewfs_test_file("${WORK_DIR}/other/file5.htm" 3500 200)
+ewfs_test_run("generator other base" COMMAND "${EWFS_GENERATOR}" -f -c -i other -o other.bin)
+ewfs_test_copy(other.bin other_patched.bin)
+ewfs_test_run("ewfs_patch other base" FAIL COMMAND "${EWFS_PATCH}" other_patched.bin update.delta)
+if(NOT RUN_ERROR MATCHES "isn't the base image")
+    message(FATAL_ERROR "ewfs_patch other base: ${RUN_ERROR}")
+endif()
+# its first block already differs, so nothing was written
+ewfs_test_same("rejected image" "${WORK_DIR}/other_patched.bin" "${WORK_DIR}/other.bin")
@@ -0,0 +1,71 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - host test helpers
+#
+# Included by the round trip tests in this directory.  CMakeLists.txt runs
+# each test with cmake -P and passes the tools (EWFS_GENERATOR, EWFS_CAT, ...)
+# and WORK_DIR, the directory under the build tree the test works in.
+###############################################################################
+
+# ewfs_test_start()
+# Empty the directory of the test and make it the place the inputs are
+# written to.
+macro(ewfs_test_start)
+    file(REMOVE_RECURSE "${WORK_DIR}")
+    file(MAKE_DIRECTORY "${WORK_DIR}")
+endmacro()
+
+# ewfs_test_file(<path> <size> <seed>)
+# Write a text file of size bytes, the seed makes the data of each file
+# different.
+function(ewfs_test_file path size seed)
+    set(text "${seed}:abcdefghijklmnopqrstuvwxyz0123456789\n")
+    string(LENGTH "${text}" length)
+    while(length LESS size)
+        string(APPEND text "${text}")
+        string(LENGTH "${text}" length)
+    endwhile()
+    string(SUBSTRING "${text}" 0 ${size} text)
+    file(WRITE "${path}" "${text}")
+endfunction()
+
+# ewfs_test_run(<name> [FAIL] [OUTPUT <file>] COMMAND <command>...)
+# Run a tool, the test fails if it fails, or with FAIL if it succeeds.  The
+# stdout goes to OUTPUT or is returned in RUN_STDOUT, the stderr is returned
+# in RUN_ERROR.
+function(ewfs_test_run name)
+    cmake_parse_arguments(RUN "FAIL" "OUTPUT" "COMMAND" ${ARGN})
+    if(RUN_OUTPUT)
+        execute_process(COMMAND ${RUN_COMMAND} WORKING_DIRECTORY "${WORK_DIR}"
+            RESULT_VARIABLE result OUTPUT_FILE "${RUN_OUTPUT}" ERROR_VARIABLE error)
+    else()
+        execute_process(COMMAND ${RUN_COMMAND} WORKING_DIRECTORY "${WORK_DIR}"
+            RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE error)
+    endif()
+    if(RUN_FAIL AND (result EQUAL 0))
+        message(FATAL_ERROR "${name}: succeeded, a failure was expected\n${output}${error}")
+    elseif(NOT RUN_FAIL AND NOT (result EQUAL 0))
+        message(FATAL_ERROR "${name}: failed (${result})\n${output}${error}")
+    endif()
+    set(RUN_STDOUT "${output}" PARENT_SCOPE)
+    set(RUN_ERROR "${error}" PARENT_SCOPE)
+endfunction()
+
+# ewfs_test_copy(<from> <to>)
+# Copy a file of the test, e.g. an image before it is patched.
+function(ewfs_test_copy from to)
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E copy "${WORK_DIR}/${from}" "${WORK_DIR}/${to}"
+        RESULT_VARIABLE result)
+    if(NOT (result EQUAL 0))
+        message(FATAL_ERROR "can't copy ${from} to ${to}")
+    endif()
+endfunction()
+
+# ewfs_test_same(<name> <file> <expected>)
+# Fail the test if the files aren't the same byte for byte.
+function(ewfs_test_same name file expected)
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E compare_files "${file}" "${expected}"
+        RESULT_VARIABLE result)
+    if(NOT (result EQUAL 0))
+        message(FATAL_ERROR "${name}: ${file} differs from ${expected}")
+    endif()
+endfunction()
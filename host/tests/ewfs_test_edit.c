@@ -0,0 +1,147 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_test_edit.c
+ *
+ * FILE DESCRIPTION:
+ * Helper of the host round trip tests that edits a binary file in place, the
+ * test scripts can't write binary data themselves.
+ *
+ * FILE NOTES:
+ * Usage: ewfs_test_edit FILE truncate LENGTH
+ *        ewfs_test_edit FILE flip OFFSET
+ *
+ * truncate cuts the file to LENGTH bytes, e.g. a delta whose transfer was
+ * interrupted.  flip inverts the bits of the byte at OFFSET, e.g. a flash
+ * cell that went bad.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static int FlipByte(const char *path, unsigned long long offset);
+static void CmdLineUsage(void);
+
+/******************************************************************************
+ * FUNCTION:  main
+ *
+ * DESCRIPTION:
+ * Apply the edit to the file.
+ *
+ * PARAMETERS:
+ * argc         int         number of command line arguments
+ * argv[]       char *      array of command line arguments
+ *
+ * RETURN VALUE:
+ * int      0 if the file was edited, otherwise 1
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[]){
+    unsigned long long value;
+    char *end;
+
+    if (argc != 4){
+        CmdLineUsage();
+        return 1;
+    }
+    value = strtoull(argv[3], &end, 0);
+    if (*end != '\0'){
+        CmdLineUsage();
+        return 1;
+    }
+    if (strcmp(argv[2], "truncate") == 0){
+        if (truncate(argv[1], (off_t) value) != 0){
+            fprintf(stderr, "Can't truncate '%s'.\n", argv[1]);
+            return 1;
+        }
+        return 0;
+    }
+    if (strcmp(argv[2], "flip") == 0){
+        return FlipByte(argv[1], value);
+    }
+    CmdLineUsage();
+    return 1;
+}
+
+/******************************************************************************
+ * FUNCTION:  FlipByte
+ *
+ * DESCRIPTION:
+ * Invert the bits of one byte of the file.
+ *
+ * PARAMETERS:
+ * path         const char *            file to edit
+ * offset       unsigned long long      offset of the byte in the file
+ *
+ * RETURN VALUE:
+ * int      0 if the byte was flipped, otherwise 1
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static int FlipByte(const char *path, unsigned long long offset){
+    FILE *file;
+    int byte;
+    int result = 1;
+
+    file = fopen(path, "r+b");
+    if (file == NULL){
+        fprintf(stderr, "Can't open '%s'.\n", path);
+        return 1;
+    }
+    if ((fseek(file, (long) offset, SEEK_SET) == 0) && ((byte = fgetc(file)) != EOF) &&
+        (fseek(file, (long) offset, SEEK_SET) == 0) && (fputc(byte ^ 0xff, file) != EOF)){
+        result = 0;
+    }
+    else{
+        fprintf(stderr, "Can't flip byte %llu of '%s'.\n", offset, path);
+    }
+    if (fclose(file) != 0){
+        result = 1;
+    }
+    return result;
+}
+
+/******************************************************************************
+ * FUNCTION:  CmdLineUsage
+ *
+ * DESCRIPTION:
+ * Display the command line usage for this application.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void CmdLineUsage(void){
+    fprintf(stderr, "Usage: ewfs_test_edit FILE truncate LENGTH\n");
+    fprintf(stderr, "       ewfs_test_edit FILE flip OFFSET\n");
+    fprintf(stderr, "    truncate    Cut the file to LENGTH bytes.\n");
+    fprintf(stderr, "    flip        Invert the bits of the byte at OFFSET.\n");
+}
@@ -0,0 +1,66 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - seeks and cache of generated files
+#
+# Reads largefile.json of custom_file_app.c with ewfs_cat from several
+# offsets, in a new open and in opens after a full read that published the
+# seek checkpoints, and compares each with the end of a full read.  Then
+# reads it again from the generated file cache, also at an offset, and after
+# the cache was invalidated, the statistics show the cache hits.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+# ewfs_test_tail(<file> <offset>...)
+# Write the data of the full read from each offset in turn to file.
+function(ewfs_test_tail file)
+    file(WRITE "${file}" "")
+    foreach(offset ${ARGN})
+        file(READ "${WORK_DIR}/full.json" tail OFFSET ${offset})
+        file(APPEND "${file}" "${tail}")
+    endforeach()
+endfunction()
+
+ewfs_test_start()
+file(WRITE "${WORK_DIR}/tree/ewfslist.txt" "largefile.json\r\n")
+file(WRITE "${WORK_DIR}/tree/largefile.json" "")
+ewfs_test_file("${WORK_DIR}/tree/index.htm" 100 0)
+ewfs_test_run("generator" COMMAND "${EWFS_GENERATOR}" -f -i tree -o json.bin)
+ewfs_test_run("ewfs_cat" OUTPUT "${WORK_DIR}/full.json"
+    COMMAND "${EWFS_CAT}" json.bin largefile.json)
+file(READ "${WORK_DIR}/full.json" json)
+string(LENGTH "${json}" size)
+math(EXPR last "${size} - 1")
+
+# seeks in a new open, the data before the offset is generated again
+foreach(offset 1 2 100 487 4000 ${last} ${size})
+    ewfs_test_run("ewfs_cat -o ${offset}" OUTPUT "${WORK_DIR}/out.json"
+        COMMAND "${EWFS_CAT}" -o ${offset} json.bin largefile.json)
+    ewfs_test_tail("${WORK_DIR}/expected.json" ${offset})
+    ewfs_test_same("ewfs_cat -o ${offset}" "${WORK_DIR}/out.json" "${WORK_DIR}/expected.json")
+endforeach()
+
+# seeks after a full read start from its checkpoints, forward and back
+foreach(buffer 7 4096)
+    ewfs_test_run("ewfs_cat checkpoints -b ${buffer}" OUTPUT "${WORK_DIR}/out.json"
+        COMMAND "${EWFS_CAT}" -b ${buffer} json.bin largefile.json -o 11000 largefile.json
+        -o 5 largefile.json -o 6000 largefile.json)
+    ewfs_test_tail("${WORK_DIR}/expected.json" 0 11000 5 6000)
+    ewfs_test_same("ewfs_cat checkpoints -b ${buffer}" "${WORK_DIR}/out.json"
+        "${WORK_DIR}/expected.json")
+endforeach()
+
+# the reads after the first come from the cache, also after a seek
+ewfs_test_run("ewfs_cat -g" OUTPUT "${WORK_DIR}/out.json"
+    COMMAND "${EWFS_CAT}" -s -g -b 7 json.bin largefile.json largefile.json -o 3000 largefile.json)
+if(NOT RUN_ERROR MATCHES "generated cache hits: 2\tmisses: 1")
+    message(FATAL_ERROR "ewfs_cat -g: 2 cache hits expected\n${RUN_ERROR}")
+endif()
+ewfs_test_tail("${WORK_DIR}/expected.json" 0 0 3000)
+ewfs_test_same("ewfs_cat -g" "${WORK_DIR}/out.json" "${WORK_DIR}/expected.json")
+
+# invalidated after each read, every read generates the file again
+ewfs_test_run("ewfs_cat -g -i" OUTPUT "${WORK_DIR}/out.json"
+    COMMAND "${EWFS_CAT}" -s -g -i json.bin largefile.json largefile.json -o 3000 largefile.json)
+if(NOT RUN_ERROR MATCHES "generated cache hits: 0\tmisses: 3")
+    message(FATAL_ERROR "ewfs_cat -g -i: no cache hits expected\n${RUN_ERROR}")
+endif()
+ewfs_test_same("ewfs_cat -g -i" "${WORK_DIR}/out.json" "${WORK_DIR}/expected.json")
@@ -0,0 +1,87 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - generator to ewfs_cat round trip
+#
+# Builds images of a small tree with the generator, packed, aligned to flash
+# pages and with checksums, and reads every file back through the runtime
+# with ewfs_cat for read buffers of 1 byte to 64 KB, mapped and with the
+# io_uring backends, where reads over the 64 KB registered buffers are split
+# for O_DIRECT.  The output must be the input byte for byte.  The image must
+# not depend on the number of threads.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+ewfs_test_start()
+# sizes around the 256 byte pages of the host and the 4096 byte sectors
+set(files
+    "index.htm 1000"
+    "index_copy.htm 1000"
+    "empty.txt 0"
+    "one.txt 1"
+    "css/site.css 255"
+    "css/print.css 256"
+    "js/app.js 257"
+    "js/lib/vendor.js 4095"
+    "docs/a/b/deep.txt 4096"
+    "docs/page.htm 4097"
+    "data/large.bin 70000"
+    "data/huge.bin 200000"
+)
+set(names "")
+set(seed 0)
+file(WRITE "${WORK_DIR}/expected" "")
+foreach(entry IN LISTS files)
+    string(REPLACE " " ";" entry "${entry}")
+    list(GET entry 0 name)
+    list(GET entry 1 size)
+    if(name STREQUAL "index_copy.htm")
+        ewfs_test_file("${WORK_DIR}/tree/${name}" ${size} 0)    #same data as index.htm
+    else()
+        ewfs_test_file("${WORK_DIR}/tree/${name}" ${size} ${seed})
+    endif()
+    file(READ "${WORK_DIR}/tree/${name}" data)
+    file(APPEND "${WORK_DIR}/expected" "${data}")
+    list(APPEND names "${name}")
+    math(EXPR seed "${seed} + 1")
+endforeach()
+
+foreach(layout packed aligned checksums)
+    if(layout STREQUAL "aligned")
+        set(options -a 256)
+    elseif(layout STREQUAL "checksums")
+        set(options -c)
+    else()
+        set(options "")
+    endif()
+    ewfs_test_run("generator ${layout}" COMMAND "${EWFS_GENERATOR}" -f -j 4 ${options}
+        -i tree -o ${layout}.bin)
+    foreach(buffer 1 7 256 4096 65536)
+        ewfs_test_run("ewfs_cat ${layout} -b ${buffer}" OUTPUT "${WORK_DIR}/out"
+            COMMAND "${EWFS_CAT}" -b ${buffer} ${layout}.bin ${names})
+        ewfs_test_same("${layout} image, ${buffer} byte reads" "${WORK_DIR}/out" "${WORK_DIR}/expected")
+    endforeach()
+    ewfs_test_run("ewfs_cat ${layout} -m" OUTPUT "${WORK_DIR}/out"
+        COMMAND "${EWFS_CAT}" -m ${layout}.bin ${names})
+    ewfs_test_same("${layout} image, mapped" "${WORK_DIR}/out" "${WORK_DIR}/expected")
+endforeach()
+
+# io_uring and O_DIRECT aren't available everywhere, the image can't be opened then
+foreach(backend -u -d)
+    execute_process(COMMAND "${EWFS_CAT}" ${backend} packed.bin index.htm WORKING_DIRECTORY "${WORK_DIR}"
+        RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+    if(NOT (result EQUAL 0) AND (error MATCHES "Can't open image"))
+        message(STATUS "ewfs_cat ${backend} skipped, the backend can't be used here")
+        continue()
+    endif()
+    foreach(buffer 4096 262144)
+        ewfs_test_run("ewfs_cat ${backend} -b ${buffer}" OUTPUT "${WORK_DIR}/out"
+            COMMAND "${EWFS_CAT}" ${backend} -b ${buffer} checksums.bin ${names})
+        ewfs_test_same("${backend}, ${buffer} byte reads" "${WORK_DIR}/out" "${WORK_DIR}/expected")
+    endforeach()
+endforeach()
+
+# the threads don't change the image
+ewfs_test_run("generator 1 thread" COMMAND "${EWFS_GENERATOR}" -f -j 1 -i tree -o one_thread.bin)
+ewfs_test_same("image of 1 thread" "${WORK_DIR}/one_thread.bin" "${WORK_DIR}/packed.bin")
+
+# a file that isn't in the image can't be read
+ewfs_test_run("ewfs_cat missing file" FAIL COMMAND "${EWFS_CAT}" packed.bin missing.htm)
@@ -0,0 +1,38 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - colliding path hashes
+#
+# 2000 paths can't have unique 16 bit hashes with any hash seed, so the
+# generator writes a version 4 image with 32 bit path hashes.  Every file
+# must read back with its own data, a path that isn't in the image must not
+# be found, and the image must scrub clean.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+ewfs_test_start()
+set(paths)
+set(expected "")
+foreach(index RANGE 1 2000)
+    math(EXPR size "20 + (${index} % 50)")
+    ewfs_test_file("${WORK_DIR}/tree/dir${index}/page${index}.htm" ${size} ${index})
+    file(READ "${WORK_DIR}/tree/dir${index}/page${index}.htm" text)
+    string(APPEND expected "${text}")
+    list(APPEND paths "dir${index}/page${index}.htm")
+endforeach()
+file(WRITE "${WORK_DIR}/expected.htm" "${expected}")
+ewfs_test_file("${WORK_DIR}/tree/index.htm" 100 0)
+
+ewfs_test_run("generator" COMMAND "${EWFS_GENERATOR}" -f -c -i tree -o collide.bin)
+# the version follows the 4 byte magic
+file(READ "${WORK_DIR}/collide.bin" version LIMIT 1 OFFSET 4 HEX)
+if(NOT version STREQUAL "04")
+    message(FATAL_ERROR "collide.bin is version ${version}, version 04 expected")
+endif()
+
+ewfs_test_run("ewfs_cat" OUTPUT "${WORK_DIR}/all.htm"
+    COMMAND "${EWFS_CAT}" -c collide.bin ${paths})
+ewfs_test_same("ewfs_cat" "${WORK_DIR}/all.htm" "${WORK_DIR}/expected.htm")
+ewfs_test_run("ewfs_cat -m" OUTPUT "${WORK_DIR}/all.htm"
+    COMMAND "${EWFS_CAT}" -m collide.bin ${paths})
+ewfs_test_same("ewfs_cat -m" "${WORK_DIR}/all.htm" "${WORK_DIR}/expected.htm")
+ewfs_test_run("ewfs_cat missing" FAIL OUTPUT "${WORK_DIR}/missing.htm"
+    COMMAND "${EWFS_CAT}" collide.bin dir1/page2.htm dir2001/page2001.htm)
@@ -0,0 +1,75 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - incremental image updates
+#
+# Changes the input tree step by step and updates the image with -u after
+# each step, the updated image must be the same byte for byte as a full build
+# of the tree.  The steps cover both ways -u writes: a same-length edit is
+# written over in place, a change of length, a new duplicate or an added or
+# removed file writes a new image from the old one.  Runs with and without
+# checksums.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+# ewfs_test_update(<name> <options> <expected>)
+# Update inc.bin with -u and compare it with a full build of the tree.  The
+# generator output must match expected, an update in place prints "updated N
+# files in the image", a new image doesn't.
+function(ewfs_test_update name options expected)
+    ewfs_test_run("${name} -u" COMMAND "${EWFS_GENERATOR}" -f -u ${options} -i tree -o inc.bin)
+    if(NOT RUN_STDOUT MATCHES "${expected}" OR
+            (NOT expected MATCHES "^updated" AND RUN_STDOUT MATCHES "updated [0-9]+ files"))
+        message(FATAL_ERROR "${name}: \"${expected}\" expected\n${RUN_STDOUT}")
+    endif()
+    ewfs_test_run("${name}" COMMAND "${EWFS_GENERATOR}" -f ${options} -i tree -o full.bin)
+    ewfs_test_same("${name}" "${WORK_DIR}/inc.bin" "${WORK_DIR}/full.bin")
+    if(options STREQUAL "-c")
+        ewfs_test_run("${name} ewfs_cat -c" COMMAND "${EWFS_CAT}" -c inc.bin)
+    endif()
+endfunction()
+
+foreach(options "" "-c")
+    ewfs_test_start()
+    file(WRITE "${WORK_DIR}/tree/ewfslist.txt" "largefile.json\r\n")
+    file(WRITE "${WORK_DIR}/tree/largefile.json" "")
+    ewfs_test_file("${WORK_DIR}/tree/index.htm" 500 0)
+    foreach(index RANGE 1 20)
+        math(EXPR size "${index} * 300")
+        ewfs_test_file("${WORK_DIR}/tree/pages/file${index}.htm" ${size} ${index})
+    endforeach()
+    # file4 is a duplicate of file3, they have the same length
+    ewfs_test_file("${WORK_DIR}/tree/pages/file3.htm" 1200 3)
+    ewfs_test_file("${WORK_DIR}/tree/pages/file4.htm" 1200 3)
+    ewfs_test_update("first build ${options}" "${options}"
+        "No cache of the image")
+
+    ewfs_test_file("${WORK_DIR}/tree/pages/file5.htm" 1500 105)
+    ewfs_test_update("same length edit ${options}" "${options}"
+        "updated 1 files in the image")
+
+    ewfs_test_file("${WORK_DIR}/tree/pages/file10.htm" 5000 10)
+    ewfs_test_file("${WORK_DIR}/tree/pages/file11.htm" 100 11)
+    ewfs_test_update("length change ${options}" "${options}"
+        "19 of 21 files unchanged")
+
+    ewfs_test_run("touch" COMMAND "${CMAKE_COMMAND}" -E touch "${WORK_DIR}/tree/pages/file12.htm")
+    ewfs_test_update("touch ${options}" "${options}"
+        "updated 0 files in the image")
+
+    # file3 is no longer a duplicate of file4, at the same length
+    ewfs_test_file("${WORK_DIR}/tree/pages/file3.htm" 1200 103)
+    ewfs_test_update("duplicate split ${options}" "${options}"
+        "20 of 21 files unchanged")
+
+    # file7 becomes a duplicate of file6
+    ewfs_test_file("${WORK_DIR}/tree/pages/file7.htm" 1800 6)
+    ewfs_test_update("new duplicate ${options}" "${options}"
+        "20 of 21 files unchanged")
+
+    ewfs_test_file("${WORK_DIR}/tree/pages/added.htm" 700 21)
+    file(REMOVE "${WORK_DIR}/tree/pages/file15.htm")
+    ewfs_test_update("add and remove ${options}" "${options}"
+        "20 of 21 files unchanged")
+
+    ewfs_test_update("unchanged ${options}" "${options}"
+        "updated 0 files in the image")
+endforeach()
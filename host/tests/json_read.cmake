@@ -0,0 +1,55 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - JSON across small reads
+#
+# Reads largefile.json, generated by the streaming JSON writer of
+# custom_file_app.c, through ewfs_cat with read buffers of 1 byte up, so the
+# numbers, strings and objects are split across reads everywhere.  Every read
+# size must give the same output, and it must be valid JSON with the lines
+# and the fractions custom_file_app.c writes.  Needs string(JSON) of
+# CMake 3.19.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+ewfs_test_start()
+# the generated file is listed in ewfslist.txt and has a placeholder in the tree
+file(WRITE "${WORK_DIR}/tree/ewfslist.txt" "largefile.json\r\n")
+file(WRITE "${WORK_DIR}/tree/largefile.json" "")
+ewfs_test_file("${WORK_DIR}/tree/index.htm" 100 0)
+ewfs_test_run("generator" COMMAND "${EWFS_GENERATOR}" -f -i tree -o json.bin)
+
+ewfs_test_run("ewfs_cat" OUTPUT "${WORK_DIR}/expected.json"
+    COMMAND "${EWFS_CAT}" -b 4096 json.bin largefile.json)
+foreach(buffer 1 2 3 5 7 16 100)
+    ewfs_test_run("ewfs_cat -b ${buffer}" OUTPUT "${WORK_DIR}/out.json"
+        COMMAND "${EWFS_CAT}" -b ${buffer} json.bin largefile.json)
+    ewfs_test_same("${buffer} byte reads" "${WORK_DIR}/out.json" "${WORK_DIR}/expected.json")
+endforeach()
+
+file(READ "${WORK_DIR}/expected.json" json)
+string(JSON lines ERROR_VARIABLE error LENGTH "${json}")
+if(error)
+    message(FATAL_ERROR "largefile.json isn't valid JSON: ${error}")
+endif()
+if(NOT (lines EQUAL 26))
+    message(FATAL_ERROR "largefile.json has ${lines} lines, 26 expected")
+endif()
+set(letters "abcdefghijklmnopqrstuvwxyz")
+foreach(index RANGE 0 25)
+    string(JSON line GET "${json}" ${index} line)
+    string(JSON text GET "${json}" ${index} text)
+    math(EXPR expected "${index} + 1")
+    string(SUBSTRING "${letters}" ${index} 1 letter)
+    string(LENGTH "${text}" length)
+    string(REGEX MATCH "^${letter}+$" same "${text}")
+    if(NOT (line EQUAL expected) OR NOT (length EQUAL 448) OR NOT same)
+        message(FATAL_ERROR "line ${index} of largefile.json is wrong")
+    endif()
+endforeach()
+# the fractions are written with 4 decimals, rounded
+foreach(fraction "\"line\":1,\"fraction\":0.0385," "\"line\":13,\"fraction\":0.5000,"
+        "\"line\":26,\"fraction\":1.0000,")
+    string(FIND "${json}" "${fraction}" found)
+    if(found LESS 0)
+        message(FATAL_ERROR "largefile.json doesn't have ${fraction}")
+    endif()
+endforeach()
@@ -0,0 +1,44 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - scrub of a flipped byte
+#
+# Builds an image with checksums, checks it scrubs clean with ewfs_cat -c,
+# then inverts one byte with ewfs_test_edit.  A byte of file data must be
+# found by the scrub and fail the read of the file, a byte of the index must
+# fail the mount.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+ewfs_test_start()
+# a single stored file, its data ends the image
+ewfs_test_file("${WORK_DIR}/tree/index.htm" 6000 0)
+ewfs_test_run("generator" COMMAND "${EWFS_GENERATOR}" -f -c -i tree -o good.bin)
+ewfs_test_run("ewfs_cat -c good" COMMAND "${EWFS_CAT}" -c good.bin)
+if(NOT RUN_ERROR MATCHES " 0 checksum errors")
+    message(FATAL_ERROR "ewfs_cat -c good: ${RUN_ERROR}")
+endif()
+ewfs_test_run("ewfs_cat good" OUTPUT "${WORK_DIR}/index.htm"
+    COMMAND "${EWFS_CAT}" good.bin index.htm)
+ewfs_test_same("ewfs_cat good" "${WORK_DIR}/index.htm" "${WORK_DIR}/tree/index.htm")
+
+# the image ends with the trailing 0 of the file, flip a byte before it
+file(READ "${WORK_DIR}/good.bin" image HEX)
+string(LENGTH "${image}" size)
+math(EXPR offset "${size} / 2 - 100")
+ewfs_test_copy(good.bin data.bin)
+ewfs_test_run("flip data" COMMAND "${EWFS_TEST_EDIT}" data.bin flip ${offset})
+ewfs_test_run("ewfs_cat -c data" FAIL COMMAND "${EWFS_CAT}" -c data.bin)
+if(NOT RUN_ERROR MATCHES " 1 checksum errors")
+    message(FATAL_ERROR "ewfs_cat -c data: ${RUN_ERROR}")
+endif()
+foreach(mode "" -m)
+    ewfs_test_run("ewfs_cat ${mode} data" FAIL OUTPUT "${WORK_DIR}/index.htm"
+        COMMAND "${EWFS_CAT}" ${mode} data.bin index.htm)
+endforeach()
+
+# the index follows the 7 byte header and the 2 byte hash seed
+ewfs_test_copy(good.bin index.bin)
+ewfs_test_run("flip index" COMMAND "${EWFS_TEST_EDIT}" index.bin flip 10)
+ewfs_test_run("ewfs_cat -c index" FAIL COMMAND "${EWFS_CAT}" -c index.bin)
+if(NOT RUN_ERROR MATCHES "Can't mount")
+    message(FATAL_ERROR "ewfs_cat -c index: ${RUN_ERROR}")
+endif()
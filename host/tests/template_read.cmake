@@ -0,0 +1,67 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - template round trip
+#
+# Builds an image with a template using the ~counter~ variable of
+# custom_file_app.c, variables that aren't registered (one of them had the
+# hash of counter) and markers that aren't variables, and reads it with
+# ewfs_cat: with read buffers of 1 byte up, mapped, twice in a row, from
+# offsets and ten times at the same time a byte of each in turn, where each
+# open file must keep its own counter values.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+# ewfs_test_page(<variable> <first> <second>)
+# Set variable to the data of page.htm with the counter values first and second.
+function(ewfs_test_page variable first second)
+    set(${variable} "${prefix}a=${first} b= c= d=${second} ~~ ~no var~ ~counter" PARENT_SCOPE)
+endfunction()
+
+ewfs_test_start()
+file(WRITE "${WORK_DIR}/tree/ewfstemplate.txt" "page.htm\r\n")
+ewfs_test_file("${WORK_DIR}/tree/index.htm" 100 0)
+# static data longer than the read buffers before the variables
+ewfs_test_file("${WORK_DIR}/prefix.txt" 1000 1)
+file(READ "${WORK_DIR}/prefix.txt" prefix)
+file(WRITE "${WORK_DIR}/tree/page.htm"
+    "${prefix}a=~counter~ b=~countfp~ c=~nothing~ d=~counter~ ~~ ~no var~ ~counter")
+ewfs_test_run("generator" COMMAND "${EWFS_GENERATOR}" -f -i tree -o template.bin)
+
+ewfs_test_page(page 1 2)
+file(WRITE "${WORK_DIR}/expected.htm" "${page}")
+foreach(buffer 1 3 7 4096)
+    ewfs_test_run("ewfs_cat -b ${buffer}" OUTPUT "${WORK_DIR}/out.htm"
+        COMMAND "${EWFS_CAT}" -b ${buffer} template.bin page.htm)
+    ewfs_test_same("ewfs_cat -b ${buffer}" "${WORK_DIR}/out.htm" "${WORK_DIR}/expected.htm")
+endforeach()
+ewfs_test_run("ewfs_cat -m" OUTPUT "${WORK_DIR}/out.htm" COMMAND "${EWFS_CAT}" -m template.bin page.htm)
+ewfs_test_same("ewfs_cat -m" "${WORK_DIR}/out.htm" "${WORK_DIR}/expected.htm")
+
+# the counter goes on in the next read
+ewfs_test_page(again 3 4)
+file(WRITE "${WORK_DIR}/expected.htm" "${page}${again}")
+ewfs_test_run("ewfs_cat twice" OUTPUT "${WORK_DIR}/out.htm"
+    COMMAND "${EWFS_CAT}" -b 7 template.bin page.htm page.htm)
+ewfs_test_same("ewfs_cat twice" "${WORK_DIR}/out.htm" "${WORK_DIR}/expected.htm")
+
+# a seek reads the template again up to the offset, the values included
+foreach(offset 500 1003 1010 1020)
+    string(SUBSTRING "${page}" ${offset} -1 tail)
+    file(WRITE "${WORK_DIR}/expected.htm" "${tail}")
+    ewfs_test_run("ewfs_cat -o ${offset}" OUTPUT "${WORK_DIR}/out.htm"
+        COMMAND "${EWFS_CAT}" -b 3 -o ${offset} template.bin page.htm)
+    ewfs_test_same("ewfs_cat -o ${offset}" "${WORK_DIR}/out.htm" "${WORK_DIR}/expected.htm")
+endforeach()
+
+# ten files read a byte at a time in turn reach a=~counter~ together and
+# d=~counter~ together, the 10 of the last file must not end up in the others
+set(files "")
+file(WRITE "${WORK_DIR}/expected.htm" "")
+foreach(index RANGE 1 10)
+    math(EXPR second "${index} + 10")
+    ewfs_test_page(page ${index} ${second})
+    file(APPEND "${WORK_DIR}/expected.htm" "${page}")
+    list(APPEND files page.htm)
+endforeach()
+ewfs_test_run("ewfs_cat -p" OUTPUT "${WORK_DIR}/out.htm"
+    COMMAND "${EWFS_CAT}" -p -b 1 template.bin ${files})
+ewfs_test_same("ewfs_cat -p" "${WORK_DIR}/out.htm" "${WORK_DIR}/expected.htm")
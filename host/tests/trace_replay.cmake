@@ -0,0 +1,78 @@
+###############################################################################
+# Electronic Wilderness File System (EWFS) - trace replay through the runtime
+#
+# Reads files of a version 4 image, where paths share 16 bit hashes, with
+# ewfs_cat -t and replays the trace with ewfs_replay.  Without a cache the
+# replay must issue the media commands and read the bytes ewfs_cat -s
+# counted, which it only does when every open is the file of the trace.  The
+# profile of -p must list the stored files in first open order, and the
+# image built from it with ewfs_generator -l must replay the same reads with
+# -i, with fewer flash commands through a cache.
+###############################################################################
+include("${CMAKE_CURRENT_LIST_DIR}/ewfs_test.cmake")
+
+ewfs_test_start()
+# 2000 paths can't have unique 16 bit hashes
+foreach(index RANGE 1 2000)
+    math(EXPR size "20 + (${index} % 50)")
+    ewfs_test_file("${WORK_DIR}/tree/dir${index}/page${index}.htm" ${size} ${index})
+endforeach()
+ewfs_test_file("${WORK_DIR}/tree/index.htm" 3000 0)
+ewfs_test_file("${WORK_DIR}/tree/copy.htm" 3000 0)     #shares the data of index.htm
+ewfs_test_file("${WORK_DIR}/tree/js/app.js" 70000 1)
+file(WRITE "${WORK_DIR}/tree/ewfslist.txt" "largefile.json\r\n")
+file(WRITE "${WORK_DIR}/tree/largefile.json" "")
+ewfs_test_run("generator" COMMAND "${EWFS_GENERATOR}" -f -i tree -o replay.bin)
+file(READ "${WORK_DIR}/replay.bin" version LIMIT 1 OFFSET 4 HEX)
+if(NOT version STREQUAL "04")
+    message(FATAL_ERROR "replay.bin is version ${version}, version 04 expected")
+endif()
+
+# a seek, a generated file, a shared copy and 40 small files, within the
+# 256 events of the trace
+set(files index.htm -o 100 js/app.js -o 0 largefile.json copy.htm)
+# index.htm is found by its data, which copy.htm shares and comes first in path order
+set(profile "copy.htm\njs/app.js\n")
+foreach(index RANGE 1 2000 50)
+    list(APPEND files "dir${index}/page${index}.htm")
+    string(APPEND profile "dir${index}/page${index}.htm\n")
+endforeach()
+ewfs_test_run("ewfs_cat -t" OUTPUT "${WORK_DIR}/out"
+    COMMAND "${EWFS_CAT}" -s -b 1000 -t trace.txt replay.bin ${files})
+string(REGEX MATCH "media commands: ([0-9]+)[^\n]*bytes: ([0-9]+)" stats "${RUN_ERROR}")
+if(NOT stats)
+    message(FATAL_ERROR "ewfs_cat -s printed no media statistics\n${RUN_ERROR}")
+endif()
+set(commands ${CMAKE_MATCH_1})
+# flash KB with one decimal
+math(EXPR kb "${CMAKE_MATCH_2} / 1024")
+math(EXPR tenths "((${CMAKE_MATCH_2} * 10 + 512) / 1024) % 10")
+
+ewfs_test_run("ewfs_replay" COMMAND "${EWFS_REPLAY}" -c 0 -p profile.txt replay.bin tree trace.txt)
+if(NOT RUN_STDOUT MATCHES "\n0\t0\t[0-9]+\t${commands}\t\t${kb}\\.${tenths}\t")
+    message(FATAL_ERROR "ewfs_replay: ${commands} commands and ${kb}.${tenths} KB expected\n${RUN_STDOUT}")
+endif()
+if(RUN_STDOUT MATCHES "skipped")
+    message(FATAL_ERROR "ewfs_replay: opens were skipped\n${RUN_STDOUT}")
+endif()
+file(READ "${WORK_DIR}/profile.txt" written)
+if(NOT written STREQUAL profile)
+    message(FATAL_ERROR "ewfs_replay -p wrote\n${written}\ninstead of\n${profile}")
+endif()
+
+ewfs_test_run("generator -l" COMMAND "${EWFS_GENERATOR}" -f -l profile.txt -i tree -o profile.bin)
+ewfs_test_run("ewfs_replay profile" COMMAND "${EWFS_REPLAY}" -c 4096 -k 4096 -i profile.bin
+    replay.bin tree trace.txt)
+string(REGEX MATCH "\n4096\t4096\t([0-9]+)\t([0-9]+)\t" row "${RUN_STDOUT}")
+set(profile_reads ${CMAKE_MATCH_1})
+set(profile_commands ${CMAKE_MATCH_2})
+if((NOT row) OR (RUN_STDOUT MATCHES "skipped"))
+    message(FATAL_ERROR "ewfs_replay -i: no result or opens were skipped\n${RUN_STDOUT}")
+endif()
+ewfs_test_run("ewfs_replay image" COMMAND "${EWFS_REPLAY}" -c 4096 -k 4096 replay.bin tree trace.txt)
+string(REGEX MATCH "\n4096\t4096\t([0-9]+)\t([0-9]+)\t" row "${RUN_STDOUT}")
+# the files read together share the cache blocks
+if(NOT (profile_reads EQUAL CMAKE_MATCH_1) OR NOT (profile_commands LESS CMAKE_MATCH_2))
+    message(FATAL_ERROR "ewfs_replay: ${profile_reads} reads and ${profile_commands} commands of the "
+        "profile image, ${CMAKE_MATCH_1} reads and ${CMAKE_MATCH_2} commands of the image")
+endif()
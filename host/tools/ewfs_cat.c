@@ -0,0 +1,480 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_cat.c
+ *
+ * FILE DESCRIPTION:
+ * Host tool that mounts an EWFS image through the runtime and writes the
+ * requested files to stdout.
+ *
+ * FILE NOTES:
+ * Usage: ewfs_cat [-v] [-s] [-c] [-t TRACE] [-g] [-i] [-p] [-o OFFSET] [-m | -u | -d]
+ *        [-b BUFFER SIZE] IMAGE [FILE ...]
+ *
+ * The files are read in the order given, a file can be given more than once,
+ * e.g. to read a generated file again from the cache (-g) or after it was
+ * invalidated (-i).  -o OFFSET can also be given between the files, it
+ * applies to the files after it.  With -p the files are open at the same time
+ * and read a buffer of each in turn, then written to stdout in order.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "ewfs.h"
+#include "host_media.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define EWFS_CAT_DISK           0
+#define EWFS_CAT_BUFFER_SIZE    512
+#define EWFS_CAT_PATH_MAX       256
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//file read at the same time as the others (-p)
+typedef struct{
+    uintptr_t handle;
+    uint8_t *data;              //data read so far
+    uint32_t size;              //bytes of data
+    int result;                 //result of the open or the last read
+    bool named;                 //the argument is a file, not -o OFFSET
+    bool reading;               //open and not at the end yet
+}ewfs_cat_file_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static void CmdLineUsage(void);
+static int CatFile(const char *file_name, uint32_t offset, uint8_t *buffer, uint32_t buffer_size);
+static int CatParallel(char *names[], int count, uint32_t offset, uint32_t buffer_size);
+#if defined(EWFS_CHECKSUM_ENABLE)
+static int ScrubImage(void);
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+static bool WriteTrace(const char *trace_path);
+#endif
+
+/******************************************************************************
+ * FUNCTION:  main
+ *
+ * DESCRIPTION:
+ * Mount the image, check it with -c and write each requested file to stdout.
+ *
+ * PARAMETERS:
+ * argc         int         number of command line arguments
+ * argv[]       char *      array of command line arguments
+ *
+ * RETURN VALUE:
+ * int      0 if all the files were read (and the image matched its checksums),
+ *          otherwise 1
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[]){
+    uint32_t buffer_size = EWFS_CAT_BUFFER_SIZE;
+    host_media_backend_e backend = HOST_MEDIA_PREAD;
+    bool stats = false;
+    bool scrub = false;
+    bool cache = false;
+    bool invalidate = false;
+    bool parallel = false;
+    const char *trace_path = NULL;
+    uint32_t offset = 0;
+    uint8_t *buffer;
+    int arg = 1;
+    int file;
+    int result = 0;
+
+    while ((arg < argc) && (argv[arg][0] == '-')){
+        if (strcmp(argv[arg], "-v") == 0){
+            HOST_ConsoleEnable(true);
+        }else if (strcmp(argv[arg], "-m") == 0){
+            backend = HOST_MEDIA_MMAP;
+        }else if (strcmp(argv[arg], "-u") == 0){
+            backend = HOST_MEDIA_URING;
+        }else if (strcmp(argv[arg], "-d") == 0){
+            backend = HOST_MEDIA_URING_DIRECT;
+#if defined(EWFS_STATS_ENABLE)
+        }else if (strcmp(argv[arg], "-s") == 0){
+            stats = true;
+#endif
+#if defined(EWFS_CHECKSUM_ENABLE)
+        }else if (strcmp(argv[arg], "-c") == 0){
+            scrub = true;
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+        }else if ((strcmp(argv[arg], "-t") == 0) && (arg + 1 < argc)){
+            trace_path = argv[++arg];
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE)
+        }else if (strcmp(argv[arg], "-g") == 0){
+            cache = true;
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE) || defined(EWFS_GEN_CHECKPOINT_ENABLE)
+        }else if (strcmp(argv[arg], "-i") == 0){
+            invalidate = true;
+#endif
+        }else if (strcmp(argv[arg], "-p") == 0){
+            parallel = true;
+        }else if ((strcmp(argv[arg], "-o") == 0) && (arg + 1 < argc)){
+            offset = (uint32_t) strtoul(argv[++arg], NULL, 0);
+        }else if ((strcmp(argv[arg], "-b") == 0) && (arg + 1 < argc)){
+            buffer_size = (uint32_t) strtoul(argv[++arg], NULL, 0);
+        }else{
+            CmdLineUsage();
+            return 1;
+        }
+        arg ++;
+    }
+    if ((argc - arg < (scrub ? 1 : 2)) || (buffer_size == 0)){
+        CmdLineUsage();
+        return 1;
+    }
+    if (HOST_MEDIA_Attach(EWFS_CAT_DISK, argv[arg], backend) == false){
+        fprintf(stderr, "Can't open image '%s'.\n", argv[arg]);
+        return 1;
+    }
+    if (EWFS_Mount(EWFS_CAT_DISK) != EWFS_OK){
+        fprintf(stderr, "Can't mount image '%s'.\n", argv[arg]);
+        HOST_MEDIA_Detach(EWFS_CAT_DISK);
+        return 1;
+    }
+#if defined(EWFS_CHECKSUM_ENABLE)
+    if (scrub && (ScrubImage() != EWFS_OK)){
+        result = 1;
+    }
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    //the generators are registered by the mount, stored files aren't cached
+    for (file = arg + 1; cache && (file < argc); file ++){
+        EWFS_SetGeneratedFileCache(argv[file], EWFS_INVALID);
+    }
+#endif
+    if (parallel && (CatParallel(&argv[arg + 1], argc - arg - 1, offset, buffer_size) != 0)){
+        result = 1;
+    }
+    buffer = malloc(buffer_size);
+    for (file = arg + 1; !parallel && (file < argc); file ++){
+        if ((strcmp(argv[file], "-o") == 0) && (file + 1 < argc)){
+            offset = (uint32_t) strtoul(argv[++file], NULL, 0);
+            continue;
+        }
+        if (CatFile(argv[file], offset, buffer, buffer_size) != EWFS_OK){
+            fprintf(stderr, "Can't read '%s'.\n", argv[file]);
+            result = 1;
+        }
+#if defined(EWFS_GEN_CACHE_ENABLE) || defined(EWFS_GEN_CHECKPOINT_ENABLE)
+        if (invalidate){
+            EWFS_InvalidateGeneratedFile(NULL);
+        }
+#endif
+    }
+    free(buffer);
+#if defined(EWFS_STATS_ENABLE)
+    if (stats){
+        char *command[] = {"ewfsstats"};
+
+        EWFS_CommandInit();
+        HOST_CommandExecute(1, command);
+    }
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+    if ((trace_path != NULL) && (WriteTrace(trace_path) == false)){
+        fprintf(stderr, "Can't write the trace '%s'.\n", trace_path);
+        result = 1;
+    }
+#endif
+    (void) stats;
+    (void) scrub;
+    (void) cache;
+    (void) invalidate;
+    (void) trace_path;
+    EWFS_Unmount(EWFS_CAT_DISK);
+    HOST_MEDIA_Detach(EWFS_CAT_DISK);
+    return result;
+}
+
+/******************************************************************************
+ * FUNCTION:  CmdLineUsage
+ *
+ * DESCRIPTION:
+ * Display the command line usage for this application.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void CmdLineUsage(void){
+    fprintf(stderr, "Usage: ewfs_cat [-v] [-s] [-c] [-t TRACE] [-g] [-i] [-p] [-o OFFSET] [-m | -u | -d]\n");
+    fprintf(stderr, "           [-b BUFFER SIZE] IMAGE [FILE ...]\n");
+    fprintf(stderr, "    -v    Print the runtime console output.\n");
+#if defined(EWFS_STATS_ENABLE)
+    fprintf(stderr, "    -s    Print the runtime statistics (ewfsstats command) to stderr.\n");
+#endif
+#if defined(EWFS_CHECKSUM_ENABLE)
+    fprintf(stderr, "    -c    Check the whole image against its checksums first (no FILE needed).\n");
+#endif
+#if defined(EWFS_TRACE_ENABLE)
+    fprintf(stderr, "    -t    Write the runtime trace to a file for ewfs_replay.\n");
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE)
+    fprintf(stderr, "    -g    Cache the output of the generated files read.\n");
+#endif
+#if defined(EWFS_GEN_CACHE_ENABLE) || defined(EWFS_GEN_CHECKPOINT_ENABLE)
+    fprintf(stderr, "    -i    Invalidate the generated files after each file is read.\n");
+#endif
+    fprintf(stderr, "    -p    Read the files at the same time, a buffer of each in turn.\n");
+    fprintf(stderr, "    -o    Seek to OFFSET in each file before reading it, between the files it\n");
+    fprintf(stderr, "          applies to the files after it.\n");
+    fprintf(stderr, "    -m    Map the image into memory and read stored files without copying.\n");
+    fprintf(stderr, "    -u    Read the image with io_uring.\n");
+    fprintf(stderr, "    -d    Read the image with io_uring and O_DIRECT.\n");
+    fprintf(stderr, "    -b    Size of the read buffer (default %u).\n", EWFS_CAT_BUFFER_SIZE);
+}
+
+/******************************************************************************
+ * FUNCTION:  CatFile
+ *
+ * DESCRIPTION:
+ * Open a file on the mounted image and copy it to stdout.
+ *
+ * PARAMETERS:
+ * file_name    const char *    file path within the image
+ * offset       uint32_t        position in the file to start at
+ * buffer       uint8_t *       read buffer
+ * buffer_size  uint32_t        size of the read buffer
+ *
+ * RETURN VALUE:
+ * int      EWFS_OK if the file was read, otherwise the EWFS error
+ *
+ * NOTES:
+ * Stored files on a mapped image are written straight from the mapping.
+ *
+ *****************************************************************************/
+static int CatFile(const char *file_name, uint32_t offset, uint8_t *buffer, uint32_t buffer_size){
+    char path[EWFS_CAT_PATH_MAX];
+    const void *data;
+    uintptr_t handle;
+    uint32_t bytes_read;
+    int result;
+
+    //the runtime expects the disk prefix used by SYS_FS
+    snprintf(path, sizeof(path), "%u:/%s", EWFS_CAT_DISK, file_name);
+    result = EWFS_Open((uintptr_t) &handle, path, 0);
+    if (result != EWFS_OK){
+        return result;
+    }
+    if ((offset > 0) && (EWFS_Seek(handle, offset) != 0)){
+        EWFS_Close(handle);
+        return EWFS_INVALID_PARAMETER;
+    }
+    if (HOST_MEDIA_IsMapped(EWFS_CAT_DISK)){
+        do{
+            result = EWFS_ReadPointer(handle, &data, EWFS_INVALID, &bytes_read);
+            fwrite(data, 1, bytes_read, stdout);
+        }while ((result == EWFS_OK) && (bytes_read > 0));
+        if (result != EWFS_INVALID_PARAMETER){
+            EWFS_Close(handle);
+            return result;
+        }
+        //generated files are not in the media
+    }
+    do{
+        result = EWFS_Read(handle, buffer, buffer_size, &bytes_read);
+        fwrite(buffer, 1, bytes_read, stdout);
+    }while ((result == EWFS_OK) && (bytes_read > 0));
+    EWFS_Close(handle);
+    return result;
+}
+
+/******************************************************************************
+ * FUNCTION:  CatParallel
+ *
+ * DESCRIPTION:
+ * Open all the files on the mounted image and read them at the same time, a
+ * buffer of each in turn, then copy them to stdout in order.
+ *
+ * PARAMETERS:
+ * names        char *[]        file paths within the image, -o OFFSET between
+ *                              them applies to the files after it
+ * count        int             number of entries in names
+ * offset       uint32_t        position in the files to start at
+ * buffer_size  uint32_t        size of each read
+ *
+ * RETURN VALUE:
+ * int      0 if all the files were read, otherwise 1
+ *
+ * NOTES:
+ * At most SYS_FS_MAX_FILES files can be open.  Stored files on a mapped image
+ * are read with EWFS_Read too.
+ *
+ *****************************************************************************/
+static int CatParallel(char *names[], int count, uint32_t offset, uint32_t buffer_size){
+    char path[EWFS_CAT_PATH_MAX];
+    ewfs_cat_file_t *files;
+    uint8_t *data;
+    uint32_t bytes_read;
+    bool reading = true;
+    int result = 0;
+    int file;
+
+    files = calloc((size_t) count, sizeof(ewfs_cat_file_t));
+    if (files == NULL){
+        return 1;
+    }
+    for (file = 0; file < count; file ++){
+        if ((strcmp(names[file], "-o") == 0) && (file + 1 < count)){
+            offset = (uint32_t) strtoul(names[++file], NULL, 0);
+            continue;
+        }
+        files[file].named = true;
+        snprintf(path, sizeof(path), "%u:/%s", EWFS_CAT_DISK, names[file]);
+        files[file].result = EWFS_Open((uintptr_t) &files[file].handle, path, 0);
+        if ((files[file].result == EWFS_OK) && (offset > 0) &&
+                (EWFS_Seek(files[file].handle, offset) != 0)){
+            EWFS_Close(files[file].handle);
+            files[file].result = EWFS_INVALID_PARAMETER;
+        }
+        files[file].reading = (files[file].result == EWFS_OK);
+    }
+    while (reading){
+        reading = false;
+        for (file = 0; file < count; file ++){
+            if (files[file].reading == false){
+                continue;
+            }
+            data = realloc(files[file].data, (size_t) files[file].size + buffer_size);
+            if (data == NULL){
+                files[file].result = EWFS_INVALID_PARAMETER;
+                bytes_read = 0;
+            }else{
+                files[file].data = data;
+                files[file].result = EWFS_Read(files[file].handle, data + files[file].size,
+                        buffer_size, &bytes_read);
+                files[file].size += bytes_read;
+            }
+            if ((files[file].result != EWFS_OK) || (bytes_read == 0)){
+                EWFS_Close(files[file].handle);
+                files[file].reading = false;
+            }else{
+                reading = true;
+            }
+        }
+    }
+    for (file = 0; file < count; file ++){
+        if (files[file].named == false){
+            continue;
+        }
+        fwrite(files[file].data, 1, files[file].size, stdout);
+        if (files[file].result != EWFS_OK){
+            fprintf(stderr, "Can't read '%s'.\n", names[file]);
+            result = 1;
+        }
+        free(files[file].data);
+    }
+    free(files);
+    return result;
+}
+
+#if defined(EWFS_CHECKSUM_ENABLE)
+/******************************************************************************
+ * FUNCTION:  ScrubImage
+ *
+ * DESCRIPTION:
+ * Check the header, the index and the data of every file of the mounted image
+ * against its checksums and report the result on stderr.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:
+ * int      EWFS_OK if the image matched, otherwise the error of EWFS_Scrub()
+ *
+ * NOTES:
+ * One full pass of EWFS_Scrub(), the same check the ewfsscrub command runs.
+ *
+ *****************************************************************************/
+static int ScrubImage(void){
+    ewfs_scrub_t status;
+    int result;
+
+    result = EWFS_Scrub(EWFS_INVALID);
+    if (result == EWFS_INVALID_PARAMETER){
+        fprintf(stderr, "The image has no checksums.\n");
+        return result;
+    }else if (result == EWFS_DISK_ERR){
+        fprintf(stderr, "Can't read the image.\n");
+        return result;
+    }
+    EWFS_GetScrubStatus(&status, false);
+    fprintf(stderr, "Checked %llu bytes, %u checksum errors", (unsigned long long) status.bytes,
+        (unsigned) status.errors);
+    if (status.errors == 0){
+        fprintf(stderr, ".\n");
+    }else if (status.last_error == EWFS_SCRUB_INDEX){
+        fprintf(stderr, ", the last in the header or index.\n");
+    }else{
+        fprintf(stderr, ", the last in index entry %u.\n", (unsigned) status.last_error);
+    }
+    return result;
+}
+#endif
+
+#if defined(EWFS_TRACE_ENABLE)
+/******************************************************************************
+ * FUNCTION:  WriteTrace
+ *
+ * DESCRIPTION:
+ * Write the runtime trace in the format of the ewfstrace command.
+ *
+ * PARAMETERS:
+ * trace_path   const char *    path of the trace file
+ *
+ * RETURN VALUE:
+ * bool     true if the trace was written, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static bool WriteTrace(const char *trace_path){
+    static ewfs_trace_event_t events[EWFS_TRACE_ENTRIES];
+    uint32_t count;
+    uint32_t index;
+    FILE *trace_file;
+
+    trace_file = fopen(trace_path, "w");
+    if (trace_file == NULL){
+        return false;
+    }
+    count = EWFS_TraceGet(events, EWFS_TRACE_ENTRIES, false);
+    fprintf(trace_file, "EWFS trace: %u events\r\n", count);
+    for (index = 0; index < count; index ++){
+        fprintf(trace_file, EWFS_TRACE_FORMAT, events[index].timestamp, events[index].type,
+                events[index].file, events[index].hash, events[index].offset, events[index].length);
+    }
+    return fclose(trace_file) == 0;
+}
+#endif
@@ -0,0 +1,237 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_patch.c
+ *
+ * FILE DESCRIPTION:
+ * Host tool that applies an image delta of the generator to an image in
+ * place with the streaming applier of the runtime.
+ *
+ * FILE NOTES:
+ * Usage: ewfs_patch [-f FLASH] [-c CHUNK SIZE] IMAGE DELTA
+ *
+ * The delta is given to the applier in chunks, like packets received over
+ * the network, and the image file stands in for the flash.  The flash
+ * erase and program time of the written blocks is reported with the time a
+ * write of the whole image would take.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#include "ewfs_patch.h"
+#include "host_flash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define PATCH_CHUNK_SIZE    512         //bytes of the delta given at once
+#define PATCH_BLOCK_MAX     0x100000    //largest block of a delta, -e of the generator
+#define PATCH_FLASH         "sst26vf032b"
+#define PATCH_ERASED        0xff        //bytes past the end of the image file
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//image file standing in for the flash
+typedef struct{
+    FILE *file;
+    const host_flash_t *flash;
+    uint64_t write_ns;          //erase and program time of the written blocks
+}patch_image_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static void CmdLineUsage(void);
+static bool ImageRead(void *context, uint32_t address, uint8_t *buffer, uint32_t length);
+static bool ImageWrite(void *context, uint32_t address, const uint8_t *buffer, uint32_t length);
+
+/******************************************************************************
+ * FUNCTION:  main
+ *
+ * DESCRIPTION:
+ * Apply the delta to the image and report the blocks and the flash time.
+ *
+ * PARAMETERS:
+ * argc         int         number of command line arguments
+ * argv[]       char *      array of command line arguments
+ *
+ * RETURN VALUE:
+ * int      0 if the image was patched, otherwise 1
+ *
+ * NOTES:
+ * The image file is cut to the length of the new image at the end.
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[]){
+    static const char *errors[] = {"the delta ends early", "", "not a delta, or its block is too large",
+        "the image isn't the base image of the delta", "a patched block doesn't have the hash of the delta",
+        "the image can't be read or written"};
+    uint32_t chunk_size = PATCH_CHUNK_SIZE;
+    const char *flash_name = PATCH_FLASH;
+    patch_image_t image;
+    ewfs_patch_t patch;
+    ewfs_patch_result_e result = EWFS_PATCH_MORE;
+    uint8_t *block;
+    uint8_t *chunk;
+    uint64_t delta_bytes = 0;
+    size_t count;
+    FILE *delta;
+    int arg = 1;
+
+    while ((arg < argc) && (argv[arg][0] == '-')){
+        if ((strcmp(argv[arg], "-f") == 0) && (arg + 1 < argc)){
+            flash_name = argv[++arg];
+        }else if ((strcmp(argv[arg], "-c") == 0) && (arg + 1 < argc)){
+            chunk_size = (uint32_t) strtoul(argv[++arg], NULL, 0);
+        }else{
+            CmdLineUsage();
+            return 1;
+        }
+        arg ++;
+    }
+    image.flash = HOST_FLASH_PresetFind(flash_name);
+    if ((argc - arg != 2) || (chunk_size == 0) || (image.flash == NULL)){
+        CmdLineUsage();
+        return 1;
+    }
+    image.file = fopen(argv[arg], "r+b");
+    if (image.file == NULL){
+        fprintf(stderr, "Can't open image '%s'.\n", argv[arg]);
+        return 1;
+    }
+    delta = fopen(argv[arg + 1], "rb");
+    if (delta == NULL){
+        fprintf(stderr, "Can't open delta '%s'.\n", argv[arg + 1]);
+        fclose(image.file);
+        return 1;
+    }
+    image.write_ns = 0;
+    block = malloc(PATCH_BLOCK_MAX);
+    chunk = malloc(chunk_size);
+    EWFS_PatchStart(&patch, block, PATCH_BLOCK_MAX, ImageRead, ImageWrite, &image);
+    while ((result == EWFS_PATCH_MORE) && ((count = fread(chunk, 1, chunk_size, delta)) > 0)){
+        delta_bytes += count;
+        result = EWFS_PatchPut(&patch, chunk, (uint32_t) count);
+    }
+    free(chunk);
+    free(block);
+    fclose(delta);
+    if ((result == EWFS_PATCH_DONE) && ((fflush(image.file) != 0) ||
+            (ftruncate(fileno(image.file), patch.image_length) != 0))){
+        result = EWFS_PATCH_DISK_ERR;
+    }
+    fclose(image.file);
+    if (result != EWFS_PATCH_DONE){
+        fprintf(stderr, "Can't patch '%s': %s.\n", argv[arg], errors[result]);
+        return 1;
+    }
+    printf("patched %u blocks of %u bytes, %u already patched, from %llu bytes of delta\n",
+        patch.blocks_written, patch.block_size, patch.blocks_skipped, (unsigned long long) delta_bytes);
+    printf("%s write: %.1f ms, %.1f ms for the whole image\n", image.flash->name, image.write_ns / 1e6,
+        HOST_FLASH_WriteTime(image.flash, 0, patch.image_length) / 1e6);
+    return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:  CmdLineUsage
+ *
+ * DESCRIPTION:
+ * Display the command line usage for this application.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void CmdLineUsage(void){
+    const host_flash_t *flash;
+    uint32_t index;
+
+    fprintf(stderr, "Usage: ewfs_patch [-f FLASH] [-c CHUNK SIZE] IMAGE DELTA\n");
+    fprintf(stderr, "    -f    Flash timing of the write time (default %s):", PATCH_FLASH);
+    for (index = 0; (flash = HOST_FLASH_PresetGet(index)) != NULL; index ++){
+        fprintf(stderr, " %s", flash->name);
+    }
+    fprintf(stderr, "\n    -c    Bytes of the delta given to the applier at once (default %u).\n", PATCH_CHUNK_SIZE);
+}
+
+/******************************************************************************
+ * FUNCTION:  ImageRead
+ *
+ * DESCRIPTION:
+ * Read callback of the applier.
+ *
+ * PARAMETERS:
+ * context      void *          the image
+ * address      uint32_t        address in the image
+ * buffer       uint8_t *       returns the bytes
+ * length       uint32_t        number of bytes
+ *
+ * RETURN VALUE:
+ * bool     true if the bytes were read, otherwise false
+ *
+ * NOTES:
+ * The bytes past the end of the file read as erased flash.
+ *
+ *****************************************************************************/
+static bool ImageRead(void *context, uint32_t address, uint8_t *buffer, uint32_t length){
+    patch_image_t *image = (patch_image_t *) context;
+    size_t count;
+
+    if (fseeko(image->file, address, SEEK_SET) != 0){
+        return false;
+    }
+    count = fread(buffer, 1, length, image->file);
+    if ((count < length) && (ferror(image->file) != 0)){
+        return false;
+    }
+    memset(&buffer[count], PATCH_ERASED, length - count);
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  ImageWrite
+ *
+ * DESCRIPTION:
+ * Write callback of the applier, erases and programs a block.
+ *
+ * PARAMETERS:
+ * context      void *          the image
+ * address      uint32_t        address in the image
+ * buffer       const uint8_t * bytes of the block
+ * length       uint32_t        number of bytes
+ *
+ * RETURN VALUE:
+ * bool     true if the block was written, otherwise false
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static bool ImageWrite(void *context, uint32_t address, const uint8_t *buffer, uint32_t length){
+    patch_image_t *image = (patch_image_t *) context;
+
+    image->write_ns += HOST_FLASH_WriteTime(image->flash, address, length);
+    return (fseeko(image->file, address, SEEK_SET) == 0) && (fwrite(buffer, 1, length, image->file) == length);
+}
@@ -0,0 +1,738 @@
+/******************************************************************************
+ * FILE NAME:  ewfs_replay.c
+ *
+ * FILE DESCRIPTION:
+ * Replay of a runtime trace (ewfstrace command or ewfs_cat -t) through the
+ * runtime on the host, reporting the flash traffic and read latency that
+ * different read caches and file layouts give for the recorded accesses.
+ *
+ * FILE NOTES:
+ * Usage: ewfs_replay [-f FLASH] [-c CACHE SIZE] [-k BLOCK SIZE] [-p PROFILE] [-i IMAGE]
+ *                    IMAGE TREE TRACE
+ *
+ * The image is mounted with the HOST_MEDIA_PREAD backend and the flash
+ * timing model, and the opens, seeks, reads and closes of the trace are
+ * done again with EWFS_Open, EWFS_Seek, EWFS_Read and EWFS_Close, so the
+ * flash commands are the ones the runtime issues.  The image has no paths:
+ * every file of TREE, the input directory of the generator, is opened once
+ * and the media address of its open event is kept, and the opens of the
+ * trace are matched by that address.  A file of the trace is its file
+ * object from the open to the close.  Generated files have no address and
+ * are matched by the hash of the path.
+ *
+ * Without -c every cache size and block size of the sweep is replayed with
+ * the read cache model of HOST_MEDIA_CacheSet, 0 is the runtime as it is:
+ * one flash command per media command.  Another layout is compared by
+ * building an image with the -l option of the generator from the profile
+ * -p writes, the stored files in the order they were first opened, and
+ * replaying the trace on it with -i: the paths are found on the traced
+ * image and opened in the image of -i.
+ *
+ * LICENSE:
+ * Copyright 2018 Eric Roman/ElectronicWilderness
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ *                              FILE INCLUDES
+ *****************************************************************************/
+#define _XOPEN_SOURCE 500   //nftw()
+#include "ewfs.h"
+#include "host_media.h"
+#include "host_flash.h"
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************
+ *                          DEFINITIONS
+ *****************************************************************************/
+#define REPLAY_DISK         0
+#define REPLAY_LINE_MAX     128
+#define REPLAY_FILES        256     //file objects, indexed by the event file
+#define REPLAY_PATH_MAX     256
+#define REPLAY_FLASH        "sst26vf032b"
+
+/******************************************************************************
+ *                              TYPE DEFINES
+ *****************************************************************************/
+//file of the image, found in the input tree
+typedef struct{
+    char *path;                 //path in the image
+    uint32_t address;           //media address of the data, EWFS_INVALID if generated
+    uint16_t hash;              //hash of the path in the image
+    bool profiled;              //written to the profile
+}replay_file_t;
+
+//configuration replayed and its results
+typedef struct{
+    uint32_t cache_size;
+    uint32_t block_size;
+    uint32_t reads;             //reads of files with data in the image
+    uint32_t missing;           //opens of files that aren't in the tree
+    uint64_t read_ns;           //flash time of the reads
+    uint64_t max_read_ns;
+    host_media_stats_t stats;
+}replay_config_t;
+
+/******************************************************************************
+ *                          FUNCTION PROTOTYPES
+ *****************************************************************************/
+static void CmdLineUsage(void);
+static ewfs_trace_event_t *ReplayLoad(const char *trace_path, uint32_t *count);
+static bool ReplayFiles(const char *tree_path);
+static int ReplayFileAdd(const char *path, const struct stat *info, int type, struct FTW *ftw);
+static int ReplayFileCompare(const void *a, const void *b);
+static replay_file_t *ReplayFind(const ewfs_trace_event_t *event);
+static bool ReplayProfile(const char *profile_path, const ewfs_trace_event_t *events, uint32_t count);
+static void ReplayRun(replay_config_t *config, const ewfs_trace_event_t *events, uint32_t count);
+static void ReplayClose(uintptr_t *handles, replay_file_t **files);
+static void ReplaySummary(const ewfs_trace_event_t *events, uint32_t count);
+static void ReplayReport(const replay_config_t *config);
+
+/******************************************************************************
+ *                              VARIABLES
+ *****************************************************************************/
+static replay_file_t *replay_files;     //files of the tree, by address
+static uint32_t replay_file_count;
+static size_t replay_tree_length;       //length of the tree path, ReplayFileAdd
+static uint8_t *replay_buffer;          //read buffer, the longest read of the trace
+
+/******************************************************************************
+ * FUNCTION:  main
+ *
+ * DESCRIPTION:
+ * Load the trace, mount the image and replay the trace for each
+ * configuration.
+ *
+ * PARAMETERS:
+ * argc         int         number of command line arguments
+ * argv[]       char *      array of command line arguments
+ *
+ * RETURN VALUE:
+ * int      0 if successful, otherwise 1
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[]){
+    static const uint32_t cache_sizes[] = {0, 4096, 16384, 65536};
+    static const uint32_t block_sizes[] = {256, 4096};
+    const host_flash_t *flash = HOST_FLASH_PresetFind(REPLAY_FLASH);
+    const char *profile_path = NULL;
+    const char *layout_path = NULL;
+    uint32_t cache_size = EWFS_INVALID;
+    uint32_t block_size = EWFS_INVALID;
+    uint32_t read_max = 1;
+    replay_config_t config;
+    ewfs_trace_event_t *events;
+    uint32_t count;
+    uint32_t cache;
+    uint32_t block;
+    uint32_t index;
+    int result = 0;
+    int arg = 1;
+
+    while ((arg < argc) && (argv[arg][0] == '-')){
+        if ((strcmp(argv[arg], "-f") == 0) && (arg + 1 < argc)){
+            flash = HOST_FLASH_PresetFind(argv[++arg]);
+            if (flash == NULL){
+                fprintf(stderr, "Unknown flash '%s'.\n", argv[arg]);
+                return 1;
+            }
+        }else if ((strcmp(argv[arg], "-c") == 0) && (arg + 1 < argc)){
+            cache_size = (uint32_t) strtoul(argv[++arg], NULL, 0);
+        }else if ((strcmp(argv[arg], "-k") == 0) && (arg + 1 < argc)){
+            block_size = (uint32_t) strtoul(argv[++arg], NULL, 0);
+        }else if ((strcmp(argv[arg], "-p") == 0) && (arg + 1 < argc)){
+            profile_path = argv[++arg];
+        }else if ((strcmp(argv[arg], "-i") == 0) && (arg + 1 < argc)){
+            layout_path = argv[++arg];
+        }else{
+            CmdLineUsage();
+            return 1;
+        }
+        arg ++;
+    }
+    if ((argc - arg != 3) || (block_size == 0)){
+        CmdLineUsage();
+        return 1;
+    }
+    events = ReplayLoad(argv[arg + 2], &count);
+    if (events == NULL){
+        fprintf(stderr, "Can't read the trace '%s'.\n", argv[arg + 2]);
+        return 1;
+    }
+    for (index = 0; index < count; index ++){
+        if ((events[index].type == EWFS_TRACE_READ) && (events[index].length > read_max)){
+            read_max = events[index].length;
+        }
+    }
+    replay_buffer = malloc(read_max);
+    if ((replay_buffer == NULL) || (HOST_MEDIA_Attach(REPLAY_DISK, argv[arg], HOST_MEDIA_PREAD) == false)){
+        fprintf(stderr, "Can't open image '%s'.\n", argv[arg]);
+        free(replay_buffer);
+        free(events);
+        return 1;
+    }
+    if (EWFS_Mount(REPLAY_DISK) != EWFS_OK){
+        fprintf(stderr, "Can't mount image '%s'.\n", argv[arg]);
+        result = 1;
+    }else if (ReplayFiles(argv[arg + 1]) == false){
+        fprintf(stderr, "Can't read the tree '%s'.\n", argv[arg + 1]);
+        result = 1;
+    }else if ((profile_path != NULL) && (ReplayProfile(profile_path, events, count) == false)){
+        fprintf(stderr, "Can't write the profile '%s'.\n", profile_path);
+        result = 1;
+    }else if (layout_path != NULL){
+        //the paths stay, the addresses are the ones of the traced image
+        EWFS_Unmount(REPLAY_DISK);
+        if (HOST_MEDIA_Attach(REPLAY_DISK, layout_path, HOST_MEDIA_PREAD) == false){
+            fprintf(stderr, "Can't open image '%s'.\n", layout_path);
+            result = 1;
+        }else if (EWFS_Mount(REPLAY_DISK) != EWFS_OK){
+            fprintf(stderr, "Can't mount image '%s'.\n", layout_path);
+            result = 1;
+        }
+    }
+    if (result != 0){
+        EWFS_Unmount(REPLAY_DISK);
+        HOST_MEDIA_Detach(REPLAY_DISK);
+        free(replay_buffer);
+        free(events);
+        return result;
+    }
+    ReplaySummary(events, count);
+    HOST_MEDIA_FlashSet(REPLAY_DISK, flash);
+
+    fprintf(stdout, "cache\tblock\treads\tcommands\tflash KB\thit %%\tdevice ms\tavg us\tmax us\n");
+    for (cache = 0; cache < sizeof(cache_sizes) / sizeof(cache_sizes[0]); cache ++){
+        for (block = 0; block < sizeof(block_sizes) / sizeof(block_sizes[0]); block ++){
+            memset(&config, 0, sizeof(config));
+            config.cache_size = (cache_size != EWFS_INVALID) ? cache_size : cache_sizes[cache];
+            config.block_size = (block_size != EWFS_INVALID) ? block_size : block_sizes[block];
+            if ((config.cache_size == 0) && (block > 0)){
+                continue;   //the block size doesn't matter without a cache
+            }
+            if (config.cache_size == 0){
+                config.block_size = 0;
+            }else if (config.block_size > config.cache_size){
+                continue;
+            }
+            if (HOST_MEDIA_CacheSet(REPLAY_DISK, config.cache_size, config.block_size) == false){
+                fprintf(stderr, "Can't set a cache of %u bytes.\n", config.cache_size);
+                result = 1;
+                break;
+            }
+            ReplayRun(&config, events, count);
+            ReplayReport(&config);
+            if (block_size != EWFS_INVALID){
+                break;
+            }
+        }
+        if ((cache_size != EWFS_INVALID) || (result != 0)){
+            break;
+        }
+    }
+    if (config.missing > 0){
+        fprintf(stdout, "%u opens of files that aren't in the tree were skipped.\n", config.missing);
+    }
+    EWFS_Unmount(REPLAY_DISK);
+    HOST_MEDIA_Detach(REPLAY_DISK);
+    for (index = 0; index < replay_file_count; index ++){
+        free(replay_files[index].path);
+    }
+    free(replay_files);
+    free(replay_buffer);
+    free(events);
+    return result;
+}
+
+/******************************************************************************
+ * FUNCTION:  CmdLineUsage
+ *
+ * DESCRIPTION:
+ * Display the command line usage for this application.
+ *
+ * PARAMETERS:  None.
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void CmdLineUsage(void){
+    fprintf(stderr, "Usage: ewfs_replay [-f FLASH] [-c CACHE SIZE] [-k BLOCK SIZE] [-p PROFILE] [-i IMAGE]\n");
+    fprintf(stderr, "                   IMAGE TREE TRACE\n");
+    fprintf(stderr, "    -f    Flash timing preset (default %s).\n", REPLAY_FLASH);
+    fprintf(stderr, "    -c    Replay one read cache size in bytes instead of the sweep.\n");
+    fprintf(stderr, "    -k    Replay one cache block size in bytes instead of the sweep.\n");
+    fprintf(stderr, "    -p    Write the files in first open order, a profile for ewfs_generator -l.\n");
+    fprintf(stderr, "    -i    Replay on another image of the same tree instead of the traced image.\n");
+    fprintf(stderr, "IMAGE is the traced image, TREE the input directory it was built from.\n");
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayLoad
+ *
+ * DESCRIPTION:
+ * Read the events of a trace file.
+ *
+ * PARAMETERS:
+ * trace_path   const char *    path of the trace
+ * count        uint32_t *      returns the number of events
+ *
+ * RETURN VALUE:
+ * ewfs_trace_event_t *     the events (free when done), NULL on error
+ *
+ * NOTES:
+ * Lines that are not events are skipped so a console capture with other
+ * output can be used as it is.
+ *
+ *****************************************************************************/
+static ewfs_trace_event_t *ReplayLoad(const char *trace_path, uint32_t *count){
+    char line[REPLAY_LINE_MAX];
+    ewfs_trace_event_t *events = NULL;
+    ewfs_trace_event_t *resized;
+    uint32_t allocated = 0;
+    unsigned int timestamp, type, file, hash, offset, length;
+    FILE *trace_file;
+
+    *count = 0;
+    trace_file = fopen(trace_path, "r");
+    if (trace_file == NULL){
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), trace_file) != NULL){
+        if (sscanf(line, "T %x %x %x %x %x %x", &timestamp, &type, &file, &hash, &offset,
+                &length) != 6){
+            continue;
+        }
+        if (*count == allocated){
+            allocated = (allocated == 0) ? 1024 : allocated * 2;
+            resized = realloc(events, allocated * sizeof(ewfs_trace_event_t));
+            if (resized == NULL){
+                free(events);
+                fclose(trace_file);
+                return NULL;
+            }
+            events = resized;
+        }
+        events[*count].timestamp = timestamp;
+        events[*count].type = (uint8_t) type;
+        events[*count].file = (uint8_t) file;
+        events[*count].hash = (uint16_t) hash;
+        events[*count].offset = offset;
+        events[*count].length = length;
+        (*count) ++;
+    }
+    fclose(trace_file);
+    if (events == NULL){
+        events = malloc(sizeof(ewfs_trace_event_t));
+    }
+    return events;
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayFiles
+ *
+ * DESCRIPTION:
+ * Find the media address of every file of the input tree in the mounted
+ * image.
+ *
+ * PARAMETERS:
+ * tree_path    const char *    input directory the image was built from
+ *
+ * RETURN VALUE:
+ * bool     true if the tree was read, otherwise false
+ *
+ * NOTES:
+ * Files that can't be opened, such as the lists of the generator and
+ * generated files without a generator, are left out.
+ *
+ *****************************************************************************/
+static bool ReplayFiles(const char *tree_path){
+    replay_tree_length = strlen(tree_path);
+    while ((replay_tree_length > 1) && (tree_path[replay_tree_length - 1] == '/')){
+        replay_tree_length --;
+    }
+    if (nftw(tree_path, ReplayFileAdd, 16, FTW_PHYS) != 0){
+        return false;
+    }
+    qsort(replay_files, replay_file_count, sizeof(replay_file_t), ReplayFileCompare);
+    EWFS_TraceGet(NULL, 0, true);
+    return true;
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayFileAdd
+ *
+ * DESCRIPTION:
+ * nftw() callback, open a file of the tree in the image and keep the
+ * address and hash its open event records.
+ *
+ * PARAMETERS:
+ * path         const char *            host path of the file
+ * info         const struct stat *     file information (not used)
+ * type         int                     FTW_F for files
+ * ftw          struct FTW *            walk position (not used)
+ *
+ * RETURN VALUE:
+ * int      0 to continue the walk, -1 if out of memory
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static int ReplayFileAdd(const char *path, const struct stat *info, int type, struct FTW *ftw){
+    ewfs_trace_event_t event;
+    replay_file_t *resized;
+    char image_path[REPLAY_PATH_MAX];
+    uintptr_t handle;
+
+    (void) info;
+    (void) ftw;
+    if ((type != FTW_F) || (strlen(path) <= replay_tree_length + 1)){
+        return 0;
+    }
+    snprintf(image_path, sizeof(image_path), "%u:/%s", REPLAY_DISK, path + replay_tree_length + 1);
+    EWFS_TraceGet(NULL, 0, true);
+    if (EWFS_Open((uintptr_t) &handle, image_path, 0) != EWFS_OK){
+        return 0;
+    }
+    //the open event is the last one
+    if ((EWFS_TraceGet(&event, 1, true) != 1) || (event.type != EWFS_TRACE_OPEN)){
+        EWFS_Close(handle);
+        return 0;
+    }
+    EWFS_Close(handle);
+    if ((replay_file_count % 1024) == 0){
+        resized = realloc(replay_files, (replay_file_count + 1024) * sizeof(replay_file_t));
+        if (resized == NULL){
+            return -1;
+        }
+        replay_files = resized;
+    }
+    replay_files[replay_file_count].path = strdup(path + replay_tree_length + 1);
+    if (replay_files[replay_file_count].path == NULL){
+        return -1;
+    }
+    replay_files[replay_file_count].address = event.offset;
+    replay_files[replay_file_count].hash = event.hash;
+    replay_files[replay_file_count].profiled = false;
+    replay_file_count ++;
+    return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayFileCompare
+ *
+ * DESCRIPTION:
+ * qsort() and bsearch() compare of files by media address.
+ *
+ * PARAMETERS:
+ * a            const void *    first file
+ * b            const void *    second file
+ *
+ * RETURN VALUE:
+ * int      <0, 0 or >0 as the address of a is lower, the same or higher
+ *
+ * NOTES:
+ * Files with the same address (copies sharing their data) are ordered by
+ * path, so the same one is found on every run.
+ *
+ *****************************************************************************/
+static int ReplayFileCompare(const void *a, const void *b){
+    const replay_file_t *file_a = a;
+    const replay_file_t *file_b = b;
+
+    if (file_a->address != file_b->address){
+        return (file_a->address < file_b->address) ? -1 : 1;
+    }
+    if ((file_a->path == NULL) || (file_b->path == NULL)){
+        return 0;   //bsearch() key
+    }
+    return strcmp(file_a->path, file_b->path);
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayFind
+ *
+ * DESCRIPTION:
+ * Return the file of an open event.
+ *
+ * PARAMETERS:
+ * event        const ewfs_trace_event_t *  open event
+ *
+ * RETURN VALUE:
+ * replay_file_t *      the file, NULL if it isn't in the tree
+ *
+ * NOTES:
+ * Stored files and templates are found by their media address, generated
+ * files by the hash of their path.
+ *
+ *****************************************************************************/
+static replay_file_t *ReplayFind(const ewfs_trace_event_t *event){
+    replay_file_t key = {NULL, event->offset, 0, false};
+    replay_file_t *file;
+    uint32_t index;
+
+    if (event->offset == EWFS_INVALID){
+        for (index = 0; index < replay_file_count; index ++){
+            if ((replay_files[index].address == EWFS_INVALID) && (replay_files[index].hash == event->hash)){
+                return &replay_files[index];
+            }
+        }
+        return NULL;
+    }
+    file = bsearch(&key, replay_files, replay_file_count, sizeof(replay_file_t), ReplayFileCompare);
+    //the first of the files sharing the address
+    while ((file != NULL) && (file > replay_files) && (file[-1].address == event->offset)){
+        file --;
+    }
+    return file;
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayProfile
+ *
+ * DESCRIPTION:
+ * Write the stored files of the trace in the order they are first opened.
+ *
+ * PARAMETERS:
+ * profile_path const char *                path of the profile
+ * events       const ewfs_trace_event_t *  trace events
+ * count        uint32_t                    number of events
+ *
+ * RETURN VALUE:
+ * bool     true if the profile was written, otherwise false
+ *
+ * NOTES:
+ * Each line is a path without a count, so ewfs_generator -l places the files
+ * in the order of the lines.
+ *
+ *****************************************************************************/
+static bool ReplayProfile(const char *profile_path, const ewfs_trace_event_t *events, uint32_t count){
+    replay_file_t *file;
+    FILE *profile_file;
+    uint32_t index;
+    bool result = true;
+
+    profile_file = fopen(profile_path, "w");
+    if (profile_file == NULL){
+        return false;
+    }
+    for (index = 0; result && (index < count); index ++){
+        if (events[index].type != EWFS_TRACE_OPEN){
+            continue;
+        }
+        file = ReplayFind(&events[index]);
+        if ((file != NULL) && (file->address != EWFS_INVALID) && (file->profiled == false)){
+            file->profiled = true;
+            result = fprintf(profile_file, "%s\n", file->path) > 0;
+        }
+    }
+    return (fclose(profile_file) == 0) && result;
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplaySummary
+ *
+ * DESCRIPTION:
+ * Print what the trace contains.
+ *
+ * PARAMETERS:
+ * events       const ewfs_trace_event_t *  trace events
+ * count        uint32_t                    number of events
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void ReplaySummary(const ewfs_trace_event_t *events, uint32_t count){
+    uint32_t types[EWFS_TRACE_CLOSE + 1] = {0};
+    uint64_t read_bytes = 0;
+    uint32_t index;
+
+    for (index = 0; index < count; index ++){
+        if (events[index].type <= EWFS_TRACE_CLOSE){
+            types[events[index].type] ++;
+        }
+        if (events[index].type == EWFS_TRACE_READ){
+            read_bytes += events[index].length;
+        }
+    }
+    fprintf(stdout, "events %u: mounts %u opens %u misses %u reads %u (%llu bytes) seeks %u closes %u\n",
+            count, types[EWFS_TRACE_MOUNT], types[EWFS_TRACE_OPEN], types[EWFS_TRACE_OPEN_MISS],
+            types[EWFS_TRACE_READ], (unsigned long long) read_bytes, types[EWFS_TRACE_SEEK],
+            types[EWFS_TRACE_CLOSE]);
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayRun
+ *
+ * DESCRIPTION:
+ * Replay the trace through the runtime for one configuration.
+ *
+ * PARAMETERS:
+ * config       replay_config_t *           configuration, updated with the results
+ * events       const ewfs_trace_event_t *  trace events
+ * count        uint32_t                    number of events
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * A mount event mounts the image again.  Events of files opened before the
+ * trace starts are skipped.  Seeks are relative like EWFS_Seek, and a read
+ * of a stored file starts at the position the trace recorded, so reads the
+ * trace lost to the ring buffer don't move the later ones.
+ *
+ *****************************************************************************/
+static void ReplayRun(replay_config_t *config, const ewfs_trace_event_t *events, uint32_t count){
+    const ewfs_trace_event_t *event;
+    replay_file_t *files[REPLAY_FILES] = {NULL};
+    uintptr_t handles[REPLAY_FILES];
+    host_media_stats_t before;
+    host_media_stats_t after;
+    char path[REPLAY_PATH_MAX];
+    uint32_t bytes_read;
+    uint32_t position;
+    uint32_t index;
+    uint64_t read_ns;
+
+    HOST_MEDIA_StatsClear(REPLAY_DISK);
+    for (index = 0; index < count; index ++){
+        event = &events[index];
+        if ((event->type != EWFS_TRACE_MOUNT) && (event->type != EWFS_TRACE_OPEN) &&
+                ((event->file >= REPLAY_FILES) || (files[event->file] == NULL))){
+            continue;
+        }
+        switch (event->type){
+            case EWFS_TRACE_MOUNT:
+                ReplayClose(handles, files);
+                EWFS_Unmount(REPLAY_DISK);
+                EWFS_Mount(REPLAY_DISK);
+                break;
+            case EWFS_TRACE_OPEN:
+                if (event->file >= REPLAY_FILES){
+                    break;
+                }
+                if (files[event->file] != NULL){
+                    EWFS_Close(handles[event->file]);
+                }
+                files[event->file] = ReplayFind(event);
+                if (files[event->file] == NULL){
+                    config->missing ++;
+                    break;
+                }
+                snprintf(path, sizeof(path), "%u:/%s", REPLAY_DISK, files[event->file]->path);
+                if (EWFS_Open((uintptr_t) &handles[event->file], path, 0) != EWFS_OK){
+                    files[event->file] = NULL;
+                    config->missing ++;
+                }
+                break;
+            case EWFS_TRACE_SEEK:
+                EWFS_Seek(handles[event->file], event->length);
+                break;
+            case EWFS_TRACE_READ:
+                if (event->length == 0){
+                    break;  //end of file
+                }
+                //the position of a stored file is its media address
+                position = EWFS_GetPosition(handles[event->file]) - files[event->file]->address;
+                if ((files[event->file]->address != EWFS_INVALID) &&
+                        (EWFS_GetSize(handles[event->file]) != EWFS_SIZE_UNKNOWN) &&
+                        (position != event->offset)){
+                    EWFS_Seek(handles[event->file], event->offset - position);
+                }
+                HOST_MEDIA_StatsGet(REPLAY_DISK, &before);
+                EWFS_Read(handles[event->file], replay_buffer, event->length, &bytes_read);
+                HOST_MEDIA_StatsGet(REPLAY_DISK, &after);
+                if (files[event->file]->address == EWFS_INVALID){
+                    break;  //generated file
+                }
+                read_ns = after.device_ns - before.device_ns;
+                config->reads ++;
+                config->read_ns += read_ns;
+                if (read_ns > config->max_read_ns){
+                    config->max_read_ns = read_ns;
+                }
+                break;
+            case EWFS_TRACE_CLOSE:
+                EWFS_Close(handles[event->file]);
+                files[event->file] = NULL;
+                break;
+            default:
+                break;
+        }
+    }
+    ReplayClose(handles, files);
+    HOST_MEDIA_StatsGet(REPLAY_DISK, &config->stats);
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayClose
+ *
+ * DESCRIPTION:
+ * Close the files the replay has open.
+ *
+ * PARAMETERS:
+ * handles      uintptr_t *         handles, by file object of the trace
+ * files        replay_file_t **    files, NULL if not open
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:  None.
+ *
+ *****************************************************************************/
+static void ReplayClose(uintptr_t *handles, replay_file_t **files){
+    uint32_t index;
+
+    for (index = 0; index < REPLAY_FILES; index ++){
+        if (files[index] != NULL){
+            EWFS_Close(handles[index]);
+            files[index] = NULL;
+        }
+    }
+}
+
+/******************************************************************************
+ * FUNCTION:  ReplayReport
+ *
+ * DESCRIPTION:
+ * Print the results of one configuration.
+ *
+ * PARAMETERS:
+ * config       const replay_config_t *     configuration and results
+ *
+ * RETURN VALUE:  None.
+ *
+ * NOTES:
+ * The latency columns are the flash time of the reads of stored files and
+ * templates, the device time also has the mount reads.
+ *
+ *****************************************************************************/
+static void ReplayReport(const replay_config_t *config){
+    uint32_t blocks = config->stats.cache_hits + config->stats.cache_misses;
+
+    fprintf(stdout, "%u\t%u\t%u\t%u\t\t%.1f\t\t%.1f\t%.3f\t\t%.1f\t%.1f\n",
+            config->cache_size, config->block_size, config->reads, config->stats.flash_commands,
+            (double) config->stats.flash_bytes / 1024.0,
+            (blocks > 0) ? ((double) config->stats.cache_hits * 100.0) / blocks : 0.0,
+            (double) config->stats.device_ns / 1000000.0,
+            (config->reads > 0) ? ((double) config->read_ns / config->reads) / 1000.0 : 0.0,
+            (double) config->max_read_ns / 1000.0);
+}